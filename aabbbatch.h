@@ -0,0 +1,373 @@
+#include "splashkit.h"
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// SSE2 is always there on x86-64, AVX2 is picked at run time when the processor has it
+#if defined(__SSE2__) && defined(__GNUC__)
+#define AABB_BATCH_SSE2
+#define AABB_BATCH_AVX2
+#include <immintrin.h>
+#endif
+
+#pragma once
+
+using namespace std;
+
+// Rectangles are padded out to a multiple of this so the widest kernel never reads past the end
+#define AABB_BATCH_LANES 8
+
+enum aabb_kernel
+{
+    AABB_SCALAR,
+    AABB_SSE2,
+    AABB_AVX2
+};
+
+// Which side of a rectangle something overlapping it should be pushed out of, same names as
+// the block collision tests: Top means it is sitting on top of the rectangle.
+enum overlap_side
+{
+    SIDE_NONE,
+    SIDE_TOP,
+    SIDE_BOTTOM,
+    SIDE_LEFT,
+    SIDE_RIGHT
+};
+
+// Bounds of many rectangles, one array per edge so several can be tested at once
+class RectBatch
+{
+    private:
+        vector<float> left;
+        vector<float> top;
+        vector<float> right;
+        vector<float> bottom;
+        int count = 0;
+
+        // Padding lanes are NaN, every comparison against them is false
+        void pad()
+        {
+            int padded = (count + AABB_BATCH_LANES - 1) / AABB_BATCH_LANES * AABB_BATCH_LANES;
+            float empty = numeric_limits<float>::quiet_NaN();
+            left.resize(padded, empty);
+            top.resize(padded, empty);
+            right.resize(padded, empty);
+            bottom.resize(padded, empty);
+        };
+
+    public:
+        RectBatch(){};
+
+        ~RectBatch(){};
+
+        void push(rectangle area)
+        {
+            left.resize(count);
+            top.resize(count);
+            right.resize(count);
+            bottom.resize(count);
+
+            left.push_back(area.x);
+            top.push_back(area.y);
+            right.push_back(area.x + area.width);
+            bottom.push_back(area.y + area.height);
+            count += 1;
+            pad();
+        };
+
+        void clear()
+        {
+            left.clear();
+            top.clear();
+            right.clear();
+            bottom.clear();
+            count = 0;
+        };
+
+        int size()
+        {
+            return this->count;
+        };
+
+        // Padded length of the arrays
+        int lanes()
+        {
+            return this->left.size();
+        };
+
+        const float *get_left() { return left.data(); };
+        const float *get_top() { return top.data(); };
+        const float *get_right() { return right.data(); };
+        const float *get_bottom() { return bottom.data(); };
+};
+
+// Bit i of the mask is set when the box overlaps rectangle i
+bool aabb_mask_test(const vector<uint64_t> &mask, int i)
+{
+    return (mask[i >> 6] >> (i & 63)) & 1;
+}
+
+// Index of the next overlapping rectangle from `from` onwards, -1 when there are no more
+int aabb_next_overlap(const vector<uint64_t> &mask, int from)
+{
+    int word = from >> 6;
+    if (word >= mask.size())
+        return -1;
+
+    uint64_t bits = mask[word] & (~(uint64_t)0 << (from & 63));
+    while (true)
+    {
+        if (bits != 0)
+        {
+#if defined(__GNUC__)
+            return word * 64 + __builtin_ctzll(bits);
+#else
+            int bit = 0;
+            while (((bits >> bit) & 1) == 0)
+                bit += 1;
+            return word * 64 + bit;
+#endif
+        }
+
+        word += 1;
+        if (word >= mask.size())
+            return -1;
+        bits = mask[word];
+    }
+}
+
+// Side of rectangle i the box is least far into, only meaningful when they overlap
+overlap_side aabb_min_penetration_side(rectangle box, RectBatch &batch, int i)
+{
+    float box_left = box.x;
+    float box_top = box.y;
+    float box_right = box.x + box.width;
+    float box_bottom = box.y + box.height;
+
+    overlap_side side = SIDE_TOP;
+    float least = box_bottom - batch.get_top()[i];
+
+    float into_bottom = batch.get_bottom()[i] - box_top;
+    if (into_bottom < least)
+    {
+        least = into_bottom;
+        side = SIDE_BOTTOM;
+    }
+
+    float into_left = box_right - batch.get_left()[i];
+    if (into_left < least)
+    {
+        least = into_left;
+        side = SIDE_LEFT;
+    }
+
+    float into_right = batch.get_right()[i] - box_left;
+    if (into_right < least)
+        side = SIDE_RIGHT;
+
+    return side;
+}
+
+// Same strict overlap as test_rectangle_collision, touching edges don't count. When sides is
+// given it gets the side of each rectangle the box is least far into, SIDE_NONE where they don't
+// overlap, the padding lanes included.
+int aabb_overlap_scalar(rectangle box, RectBatch &batch, vector<uint64_t> &mask, vector<unsigned char> *sides = nullptr)
+{
+    float box_left = box.x;
+    float box_top = box.y;
+    float box_right = box.x + box.width;
+    float box_bottom = box.y + box.height;
+    const float *left = batch.get_left();
+    const float *top = batch.get_top();
+    const float *right = batch.get_right();
+    const float *bottom = batch.get_bottom();
+
+    mask.assign((batch.lanes() + 63) / 64, 0);
+    if (sides != nullptr)
+        sides->assign(batch.lanes(), SIDE_NONE);
+    int hits = 0;
+
+    for (int i = 0; i < batch.size(); i++)
+    {
+        if (box_left < right[i] && box_right > left[i] && box_top < bottom[i] && box_bottom > top[i])
+        {
+            mask[i >> 6] |= (uint64_t)1 << (i & 63);
+            hits += 1;
+            if (sides != nullptr)
+                (*sides)[i] = aabb_min_penetration_side(box, batch, i);
+        }
+    }
+
+    return hits;
+}
+
+#if defined(AABB_BATCH_SSE2)
+// Picks the side where its penetration is less than the least so far, so the first of equal
+// sides wins as in aabb_min_penetration_side
+inline void aabb_least_side_sse2(__m128 &least, __m128 &side, __m128 into, float name)
+{
+    __m128 less = _mm_cmplt_ps(into, least);
+    least = _mm_or_ps(_mm_andnot_ps(less, least), _mm_and_ps(less, into));
+    side = _mm_or_ps(_mm_andnot_ps(less, side), _mm_and_ps(less, _mm_set1_ps(name)));
+}
+
+int aabb_overlap_sse2(rectangle box, RectBatch &batch, vector<uint64_t> &mask, vector<unsigned char> *sides = nullptr)
+{
+    __m128 box_left = _mm_set1_ps((float)box.x);
+    __m128 box_top = _mm_set1_ps((float)box.y);
+    __m128 box_right = _mm_set1_ps((float)(box.x + box.width));
+    __m128 box_bottom = _mm_set1_ps((float)(box.y + box.height));
+    const float *left = batch.get_left();
+    const float *top = batch.get_top();
+    const float *right = batch.get_right();
+    const float *bottom = batch.get_bottom();
+
+    mask.assign((batch.lanes() + 63) / 64, 0);
+    if (sides != nullptr)
+        sides->assign(batch.lanes(), SIDE_NONE);
+    int hits = 0;
+
+    for (int i = 0; i < batch.lanes(); i += 4)
+    {
+        __m128 lefts = _mm_loadu_ps(left + i);
+        __m128 tops = _mm_loadu_ps(top + i);
+        __m128 rights = _mm_loadu_ps(right + i);
+        __m128 bottoms = _mm_loadu_ps(bottom + i);
+        __m128 overlap = _mm_and_ps(
+            _mm_and_ps(_mm_cmplt_ps(box_left, rights), _mm_cmpgt_ps(box_right, lefts)),
+            _mm_and_ps(_mm_cmplt_ps(box_top, bottoms), _mm_cmpgt_ps(box_bottom, tops)));
+
+        uint64_t bits = _mm_movemask_ps(overlap);
+        if (bits == 0)
+            continue;
+        mask[i >> 6] |= bits << (i & 63);
+        hits += __builtin_popcountll(bits);
+
+        if (sides != nullptr)
+        {
+            __m128 least = _mm_sub_ps(box_bottom, tops);
+            __m128 side = _mm_set1_ps(SIDE_TOP);
+            aabb_least_side_sse2(least, side, _mm_sub_ps(bottoms, box_top), SIDE_BOTTOM);
+            aabb_least_side_sse2(least, side, _mm_sub_ps(box_right, lefts), SIDE_LEFT);
+            aabb_least_side_sse2(least, side, _mm_sub_ps(rights, box_left), SIDE_RIGHT);
+
+            // Lanes that don't overlap become 0, SIDE_NONE
+            int32_t found[4];
+            _mm_storeu_si128((__m128i *)found, _mm_cvttps_epi32(_mm_and_ps(side, overlap)));
+            for (int k = 0; k < 4; k++)
+                (*sides)[i + k] = found[k];
+        }
+    }
+
+    return hits;
+}
+#endif
+
+#if defined(AABB_BATCH_AVX2)
+__attribute__((target("avx2"))) inline void aabb_least_side_avx2(__m256 &least, __m256 &side, __m256 into, float name)
+{
+    __m256 less = _mm256_cmp_ps(into, least, _CMP_LT_OQ);
+    least = _mm256_blendv_ps(least, into, less);
+    side = _mm256_blendv_ps(side, _mm256_set1_ps(name), less);
+}
+
+__attribute__((target("avx2"))) int aabb_overlap_avx2(rectangle box, RectBatch &batch, vector<uint64_t> &mask, vector<unsigned char> *sides = nullptr)
+{
+    __m256 box_left = _mm256_set1_ps((float)box.x);
+    __m256 box_top = _mm256_set1_ps((float)box.y);
+    __m256 box_right = _mm256_set1_ps((float)(box.x + box.width));
+    __m256 box_bottom = _mm256_set1_ps((float)(box.y + box.height));
+    const float *left = batch.get_left();
+    const float *top = batch.get_top();
+    const float *right = batch.get_right();
+    const float *bottom = batch.get_bottom();
+
+    mask.assign((batch.lanes() + 63) / 64, 0);
+    if (sides != nullptr)
+        sides->assign(batch.lanes(), SIDE_NONE);
+    int hits = 0;
+
+    for (int i = 0; i < batch.lanes(); i += 8)
+    {
+        __m256 lefts = _mm256_loadu_ps(left + i);
+        __m256 tops = _mm256_loadu_ps(top + i);
+        __m256 rights = _mm256_loadu_ps(right + i);
+        __m256 bottoms = _mm256_loadu_ps(bottom + i);
+        __m256 overlap = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(box_left, rights, _CMP_LT_OQ), _mm256_cmp_ps(box_right, lefts, _CMP_GT_OQ)),
+            _mm256_and_ps(_mm256_cmp_ps(box_top, bottoms, _CMP_LT_OQ), _mm256_cmp_ps(box_bottom, tops, _CMP_GT_OQ)));
+
+        uint64_t bits = _mm256_movemask_ps(overlap);
+        if (bits == 0)
+            continue;
+        mask[i >> 6] |= bits << (i & 63);
+        hits += __builtin_popcountll(bits);
+
+        if (sides != nullptr)
+        {
+            __m256 least = _mm256_sub_ps(box_bottom, tops);
+            __m256 side = _mm256_set1_ps(SIDE_TOP);
+            aabb_least_side_avx2(least, side, _mm256_sub_ps(bottoms, box_top), SIDE_BOTTOM);
+            aabb_least_side_avx2(least, side, _mm256_sub_ps(box_right, lefts), SIDE_LEFT);
+            aabb_least_side_avx2(least, side, _mm256_sub_ps(rights, box_left), SIDE_RIGHT);
+
+            int32_t found[8];
+            _mm256_storeu_si256((__m256i *)found, _mm256_cvttps_epi32(_mm256_and_ps(side, overlap)));
+            for (int k = 0; k < 8; k++)
+                (*sides)[i + k] = found[k];
+        }
+    }
+
+    return hits;
+}
+#endif
+
+// Widest kernel this machine can run, worked out once whichever thread asks first
+aabb_kernel aabb_best_kernel()
+{
+    static const int best = []() {
+        int best = AABB_SCALAR;
+#if defined(AABB_BATCH_SSE2)
+        best = AABB_SSE2;
+#endif
+#if defined(AABB_BATCH_AVX2)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            best = AABB_AVX2;
+#endif
+        return best;
+    }();
+
+    return (aabb_kernel)best;
+}
+
+// Tests the box against every rectangle in the batch and sets a bit in the mask for each one it
+// overlaps. Returns how many it overlaps.
+int aabb_overlap(rectangle box, RectBatch &batch, vector<uint64_t> &mask, aabb_kernel kernel = aabb_best_kernel())
+{
+#if defined(AABB_BATCH_AVX2)
+    if (kernel == AABB_AVX2)
+        return aabb_overlap_avx2(box, batch, mask);
+#endif
+#if defined(AABB_BATCH_SSE2)
+    if (kernel == AABB_SSE2)
+        return aabb_overlap_sse2(box, batch, mask);
+#endif
+    return aabb_overlap_scalar(box, batch, mask);
+}
+
+// Same, also giving the side of each overlapping rectangle to push the box out of, worked out
+// in the same lanes as the overlap
+int aabb_overlap_sides(rectangle box, RectBatch &batch, vector<uint64_t> &mask, vector<unsigned char> &sides, aabb_kernel kernel = aabb_best_kernel())
+{
+#if defined(AABB_BATCH_AVX2)
+    if (kernel == AABB_AVX2)
+        return aabb_overlap_avx2(box, batch, mask, &sides);
+#endif
+#if defined(AABB_BATCH_SSE2)
+    if (kernel == AABB_SSE2)
+        return aabb_overlap_sse2(box, batch, mask, &sides);
+#endif
+    return aabb_overlap_scalar(box, batch, mask, &sides);
+}
@@ -0,0 +1,130 @@
+#include "splashkit.h"
+#include "enemy.h"
+#include "player.h"
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// How long enemy thinking may take each frame, and how often each enemy gets to think
+#define AI_FRAME_BUDGET_US 1000
+#define AI_THINK_PERIOD 10
+// Thinks a frame may run when every machine has to make the same decisions
+#define AI_LOCKSTEP_THINKS 32
+
+// Where the scheduler was at one frame
+struct ai_schedule_snapshot
+{
+    int frame = 0;
+    deque<int> deferred;
+};
+
+// Spreads the expensive part of enemy AI over several frames. Each enemy thinks once every
+// AI_THINK_PERIOD frames, offset by its id so the work doesn't land on the same frame, and
+// anything that doesn't fit in the frame budget is pushed to the front of the next frame.
+class AIScheduler
+{
+    private:
+        int frame = 0;
+        int think_period;
+        long budget_us;
+        // When above 0 the budget is this many thinks instead of a time, so two machines
+        // simulating the same frames always make the same decisions
+        int think_limit = 0;
+        deque<int> deferred;
+        int thinks_run = 0;
+        int thinks_deferred = 0;
+        long last_frame_us = 0;
+
+    public:
+        AIScheduler(int think_period = AI_THINK_PERIOD, long budget_us = AI_FRAME_BUDGET_US)
+        {
+            this->think_period = think_period;
+            this->budget_us = budget_us;
+        };
+
+        ~AIScheduler(){};
+
+        void update(EnemySystem &enemies, vector<int> &active_enemies, vector<shared_ptr<Player>> &level_players)
+        {
+            frame += 1;
+            thinks_run = 0;
+            thinks_deferred = 0;
+
+            auto start = chrono::steady_clock::now();
+
+            // Work left over from the last frame goes first so nobody starves
+            deque<int> queue;
+            queue.swap(deferred);
+
+            for (int i = 0; i < active_enemies.size(); i++)
+            {
+                int enemy = active_enemies[i];
+                if (!enemies.wants_to_think(enemy))
+                    continue;
+
+                if ((frame + enemy) % think_period == 0)
+                    queue.push_back(enemy);
+            }
+
+            while (!queue.empty())
+            {
+                if (think_limit > 0 && thinks_run >= think_limit)
+                    break;
+
+                long elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+                if (think_limit == 0 && elapsed > budget_us)
+                    break;
+
+                int enemy = queue.front();
+                queue.pop_front();
+
+                if (!enemies.alive(enemy))
+                    continue;
+
+                enemies.think(enemy, level_players);
+                thinks_run += 1;
+            }
+
+            thinks_deferred = queue.size();
+            deferred.swap(queue);
+
+            last_frame_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        };
+
+        void set_think_limit(int limit)
+        {
+            this->think_limit = limit;
+        };
+
+        void save_state(ai_schedule_snapshot &snapshot)
+        {
+            snapshot.frame = frame;
+            snapshot.deferred = deferred;
+        };
+
+        void restore_state(const ai_schedule_snapshot &snapshot)
+        {
+            frame = snapshot.frame;
+            deferred = snapshot.deferred;
+        };
+
+        int get_thinks_run()
+        {
+            return this->thinks_run;
+        };
+
+        int get_thinks_deferred()
+        {
+            return this->thinks_deferred;
+        };
+
+        long get_last_frame_us()
+        {
+            return this->last_frame_us;
+        };
+};
@@ -0,0 +1,143 @@
+#include "splashkit.h"
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// Size of each block of memory the arena grabs at once
+#define ARENA_CHUNK_SIZE 65536
+
+// Monotonic memory for everything a level builds. Objects are bump allocated out of large
+// chunks and all freed together when the arena is released, nothing is freed one at a time.
+// Handles given out don't own anything, they are only valid while the arena is alive.
+class LevelArena
+{
+    private:
+        struct destructor_record
+        {
+            void *object;
+            void (*destroy)(void *);
+        };
+
+        vector<char *> chunks;
+        size_t chunk_used = 0;
+        size_t chunk_capacity = 0;
+        vector<destructor_record> destructors;
+        int allocations = 0;
+        size_t bytes = 0;
+        size_t reserved = 0;
+
+        template <typename T>
+        static void destroy(void *object)
+        {
+            static_cast<T *>(object)->~T();
+        };
+
+        void *allocate(size_t size, size_t align)
+        {
+            size_t start = (chunk_used + align - 1) & ~(align - 1);
+
+            if (chunks.empty() || start + size > chunk_capacity)
+            {
+                // Oversized objects get a chunk of their own
+                size_t capacity = size + align > ARENA_CHUNK_SIZE ? size + align : ARENA_CHUNK_SIZE;
+                char *chunk = static_cast<char *>(malloc(capacity));
+                if (chunk == nullptr)
+                    throw bad_alloc();
+
+                chunks.push_back(chunk);
+                chunk_capacity = capacity;
+                reserved += capacity;
+                start = (align - (reinterpret_cast<size_t>(chunk) & (align - 1))) & (align - 1);
+            }
+
+            void *memory = chunks.back() + start;
+            chunk_used = start + size;
+            allocations += 1;
+            bytes += size;
+
+            return memory;
+        };
+
+    public:
+        LevelArena(){};
+
+        ~LevelArena()
+        {
+            release();
+        };
+
+        LevelArena(const LevelArena &) = delete;
+        LevelArena &operator=(const LevelArena &) = delete;
+
+        // Constructs a T in the arena. Its destructor runs when the arena is released.
+        template <typename T, typename... Args>
+        T *create(Args &&...args)
+        {
+            void *memory = allocate(sizeof(T), alignof(T));
+            T *object = new (memory) T(std::forward<Args>(args)...);
+
+            if (!is_trivially_destructible<T>::value)
+                destructors.push_back({object, &LevelArena::destroy<T>});
+
+            return object;
+        };
+
+        // Same as create, wrapped so it can go anywhere a shared_ptr is expected. The pointer
+        // shares no control block so copying it never touches a reference count.
+        template <typename T, typename... Args>
+        shared_ptr<T> make(Args &&...args)
+        {
+            return shared_ptr<T>(shared_ptr<T>(), create<T>(std::forward<Args>(args)...));
+        };
+
+        // Destroys every object newest first and hands the chunks back in one go
+        void release()
+        {
+            for (int i = destructors.size() - 1; i >= 0; i--)
+                destructors[i].destroy(destructors[i].object);
+            destructors.clear();
+
+            for (int i = 0; i < chunks.size(); i++)
+                free(chunks[i]);
+            chunks.clear();
+
+            chunk_used = 0;
+            chunk_capacity = 0;
+            allocations = 0;
+            bytes = 0;
+            reserved = 0;
+        };
+
+        int get_allocations()
+        {
+            return this->allocations;
+        };
+
+        size_t get_bytes()
+        {
+            return this->bytes;
+        };
+
+        size_t get_reserved_bytes()
+        {
+            return this->reserved;
+        };
+
+        int get_chunks()
+        {
+            return this->chunks.size();
+        };
+
+        string report()
+        {
+            return to_string(allocations) + " allocations, " + to_string(bytes) + " bytes used, " + to_string(reserved) + " bytes in " + to_string(chunks.size()) + " chunks";
+        };
+};
@@ -0,0 +1,483 @@
+#include "splashkit.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ASSET_PACK_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#pragma once
+
+using namespace std;
+
+// Written into Resources/bundles by the pack builder
+#define ASSET_PACK_FILE "assets.pack"
+#define ASSET_PACK_MAGIC "BTSPACK1"
+
+enum asset_kind
+{
+    ASSET_BUNDLE,
+    ASSET_BITMAP,
+    ASSET_SOUND,
+    ASSET_MUSIC,
+    ASSET_FONT,
+    ASSET_ANIMATION
+};
+
+// Layout of the pack file: the header, every entry, then the names and file names they point at
+struct asset_pack_header
+{
+    char magic[8];
+    uint32_t entries;
+    uint32_t strings;
+};
+
+struct asset_pack_entry
+{
+    uint32_t kind;
+    uint32_t bundle; // Index of the ASSET_BUNDLE entry this came from
+    uint32_t name;   // Offsets into the strings
+    uint32_t file;
+    int32_t cell_width = 0;
+    int32_t cell_height = 0;
+    int32_t columns = 0;
+    int32_t rows = 0;
+    int32_t count = 0;
+};
+
+// Splits a bundle line into its comma separated parts with the spaces trimmed off
+vector<string> split_bundle_line(string line)
+{
+    vector<string> parts;
+    stringstream ss(line);
+    string part;
+    while (getline(ss, part, ','))
+    {
+        size_t first = part.find_first_not_of(" \t\r");
+        size_t last = part.find_last_not_of(" \t\r");
+        parts.push_back(first == string::npos ? "" : part.substr(first, last - first + 1));
+    }
+    return parts;
+}
+
+// Everything the bundles would load, already parsed, in one file that is mapped straight into
+// memory. Nothing is decoded until the game first asks for it by name.
+class AssetPack
+{
+    private:
+        const char *data = nullptr;
+        size_t size = 0;
+        bool mapped = false;
+        vector<char> copy; // Used where the file can't be mapped
+        const asset_pack_entry *entries = nullptr;
+        const char *strings = nullptr;
+        int entry_count = 0;
+        unordered_map<string, int> index;
+        vector<bool> loaded;
+        int decoded = 0;
+        double decode_ms = 0;
+
+        static string key(asset_kind kind, string name)
+        {
+            return to_string(kind) + ":" + name;
+        };
+
+        bool check()
+        {
+            if (size < sizeof(asset_pack_header))
+                return false;
+
+            const asset_pack_header *header = reinterpret_cast<const asset_pack_header *>(data);
+            if (memcmp(header->magic, ASSET_PACK_MAGIC, 8) != 0)
+                return false;
+            if (sizeof(asset_pack_header) + header->entries * sizeof(asset_pack_entry) + header->strings != size)
+                return false;
+
+            entry_count = header->entries;
+            entries = reinterpret_cast<const asset_pack_entry *>(data + sizeof(asset_pack_header));
+            strings = data + sizeof(asset_pack_header) + entry_count * sizeof(asset_pack_entry);
+            return true;
+        };
+
+        void decode(int i)
+        {
+            const asset_pack_entry &entry = entries[i];
+            string name = get_text(entry.name);
+            string file = get_text(entry.file);
+
+            auto start = chrono::steady_clock::now();
+            switch (entry.kind)
+            {
+                case ASSET_BITMAP:
+                {
+                    bitmap image = load_bitmap(name, file);
+                    if (entry.count > 0)
+                        bitmap_set_cell_details(image, entry.cell_width, entry.cell_height, entry.columns, entry.rows, entry.count);
+                    break;
+                }
+                case ASSET_SOUND:
+                    load_sound_effect(name, file);
+                    break;
+                case ASSET_MUSIC:
+                    load_music(name, file);
+                    break;
+                case ASSET_FONT:
+                    load_font(name, file);
+                    break;
+                case ASSET_ANIMATION:
+                    load_animation_script(name, file);
+                    break;
+            }
+            decode_ms += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+            loaded[i] = true;
+            decoded += 1;
+        };
+
+    public:
+        AssetPack(){};
+
+        ~AssetPack()
+        {
+            close();
+        };
+
+        AssetPack(const AssetPack &) = delete;
+        AssetPack &operator=(const AssetPack &) = delete;
+
+        bool open(string file)
+        {
+            close();
+
+#if defined(ASSET_PACK_MMAP)
+            int fd = ::open(file.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+
+            struct stat info;
+            if (fstat(fd, &info) == 0 && info.st_size > 0)
+            {
+                void *memory = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (memory != MAP_FAILED)
+                {
+                    data = static_cast<const char *>(memory);
+                    size = info.st_size;
+                    mapped = true;
+                }
+            }
+            ::close(fd);
+#endif
+
+            if (!mapped)
+            {
+                ifstream pack(file, ios::binary);
+                if (pack.fail())
+                    return false;
+                copy.assign(istreambuf_iterator<char>(pack), istreambuf_iterator<char>());
+                data = copy.data();
+                size = copy.size();
+            }
+
+            if (!check())
+            {
+                write_line("Asset pack " + file + " is out of date or damaged, rebuild it with -p");
+                close();
+                return false;
+            }
+
+            loaded.assign(entry_count, false);
+            for (int i = 0; i < entry_count; i++)
+                if (entries[i].kind != ASSET_BUNDLE)
+                    index[key((asset_kind)entries[i].kind, get_text(entries[i].name))] = i;
+
+            return true;
+        };
+
+        void close()
+        {
+#if defined(ASSET_PACK_MMAP)
+            if (mapped)
+                munmap(const_cast<char *>(data), size);
+#endif
+            copy.clear();
+            data = nullptr;
+            size = 0;
+            mapped = false;
+            entries = nullptr;
+            strings = nullptr;
+            entry_count = 0;
+            index.clear();
+            loaded.clear();
+            decoded = 0;
+            decode_ms = 0;
+        };
+
+        bool is_open()
+        {
+            return this->data != nullptr;
+        };
+
+        int find(asset_kind kind, string name)
+        {
+            auto found = index.find(key(kind, name));
+            return found == index.end() ? -1 : found->second;
+        };
+
+        // Decodes the asset the first time it is asked for
+        void require(asset_kind kind, string name)
+        {
+            int i = find(kind, name);
+            if (i >= 0 && !loaded[i])
+                decode(i);
+        };
+
+        void require(int i)
+        {
+            if (!loaded[i] && entries[i].kind != ASSET_BUNDLE)
+                decode(i);
+        };
+
+        void free_entry(int i)
+        {
+            if (!loaded[i])
+                return;
+
+            string name = get_text(entries[i].name);
+            switch (entries[i].kind)
+            {
+                case ASSET_BITMAP:
+                    free_bitmap(bitmap_named(name));
+                    break;
+                case ASSET_SOUND:
+                    free_sound_effect(sound_effect_named(name));
+                    break;
+                case ASSET_MUSIC:
+                    free_music(music_named(name));
+                    break;
+                case ASSET_FONT:
+                    free_font(font_named(name));
+                    break;
+                case ASSET_ANIMATION:
+                    free_animation_script(animation_script_named(name));
+                    break;
+            }
+            loaded[i] = false;
+            decoded -= 1;
+        };
+
+        // Frees everything decoded so far, the pack itself stays open
+        void free_decoded()
+        {
+            for (int i = 0; i < entry_count; i++)
+                free_entry(i);
+            decode_ms = 0;
+        };
+
+        // Index of the bundle entry with this name, -1 if the pack doesn't have it
+        int find_bundle(string bundle_name)
+        {
+            for (int i = 0; i < entry_count; i++)
+                if (entries[i].kind == ASSET_BUNDLE && get_text(entries[i].name) == bundle_name)
+                    return i;
+            return -1;
+        };
+
+        // Decodes or frees everything that came from one bundle
+        void require_bundle(uint32_t bundle)
+        {
+            for (int i = 0; i < entry_count; i++)
+                if (entries[i].bundle == bundle)
+                    require(i);
+        };
+
+        void free_bundle(uint32_t bundle)
+        {
+            for (int i = 0; i < entry_count; i++)
+                if (entries[i].bundle == bundle)
+                    free_entry(i);
+        };
+
+        string get_text(uint32_t offset)
+        {
+            return string(strings + offset);
+        };
+
+        const asset_pack_entry &get_entry(int i)
+        {
+            return entries[i];
+        };
+
+        int get_entries()
+        {
+            return this->entry_count;
+        };
+
+        int get_decoded()
+        {
+            return this->decoded;
+        };
+
+        string report()
+        {
+            return to_string(entry_count) + " pack entries, " + to_string(decoded) + " decoded in " + to_string(decode_ms) + "ms";
+        };
+};
+
+// The pack everything is looked up in, closed unless open_asset_pack found one
+AssetPack &asset_pack()
+{
+    static AssetPack pack;
+    return pack;
+}
+
+bool open_asset_pack()
+{
+    return asset_pack().open(path_to_resource(ASSET_PACK_FILE, BUNDLE_RESOURCE));
+}
+
+// Named lookups that decode from the pack on first use, and fall back to whatever the bundles
+// loaded when there is no pack
+bitmap asset_bitmap(string name)
+{
+    asset_pack().require(ASSET_BITMAP, name);
+    return bitmap_named(name);
+}
+
+sound_effect asset_sound(string name)
+{
+    asset_pack().require(ASSET_SOUND, name);
+    return sound_effect_named(name);
+}
+
+// Set while frames are simulated again, their sounds were heard the first time round
+atomic<bool> &sound_effects_muted()
+{
+    static atomic<bool> muted{false};
+    return muted;
+}
+
+void play_asset_sound(string name)
+{
+    if (!sound_effects_muted())
+        play_sound_effect(asset_sound(name));
+}
+
+music asset_music(string name)
+{
+    asset_pack().require(ASSET_MUSIC, name);
+    return music_named(name);
+}
+
+font asset_font(string name)
+{
+    asset_pack().require(ASSET_FONT, name);
+    return font_named(name);
+}
+
+animation_script asset_animation(string name)
+{
+    asset_pack().require(ASSET_ANIMATION, name);
+    return animation_script_named(name);
+}
+
+// Offline step: parses every line of the given bundles into one pack file. Bundle names and files
+// are given in pairs, the same as load_resource_bundle takes them.
+int build_asset_pack(vector<string> bundle_names, vector<string> bundle_files)
+{
+    vector<asset_pack_entry> entries;
+    string strings;
+
+    auto add_text = [&strings](string text) {
+        uint32_t offset = strings.size();
+        strings += text;
+        strings += '\0';
+        return offset;
+    };
+
+    for (int b = 0; b < bundle_files.size(); b++)
+    {
+        ifstream bundle;
+        bundle.open(path_to_resource(bundle_files[b], BUNDLE_RESOURCE));
+        if (bundle.fail())
+        {
+            write_line("Can't open bundle " + bundle_files[b]);
+            return 1;
+        }
+
+        asset_pack_entry group;
+        group.kind = ASSET_BUNDLE;
+        group.bundle = entries.size();
+        group.name = add_text(bundle_names[b]);
+        group.file = add_text(bundle_files[b]);
+        entries.push_back(group);
+
+        string line;
+        while (getline(bundle, line))
+        {
+            if (line.rfind("//", 0) == 0)
+                continue;
+
+            vector<string> parts = split_bundle_line(line);
+            if (parts.size() < 3)
+                continue;
+
+            asset_pack_entry entry;
+            if (parts[0] == "BITMAP")
+                entry.kind = ASSET_BITMAP;
+            else if (parts[0] == "SOUND")
+                entry.kind = ASSET_SOUND;
+            else if (parts[0] == "MUSIC")
+                entry.kind = ASSET_MUSIC;
+            else if (parts[0] == "FONT")
+                entry.kind = ASSET_FONT;
+            else if (parts[0] == "ANIM")
+                entry.kind = ASSET_ANIMATION;
+            else
+                continue;
+
+            entry.bundle = group.bundle;
+            entry.name = add_text(parts[1]);
+            entry.file = add_text(parts[2]);
+
+            if (entry.kind == ASSET_BITMAP && parts.size() >= 8)
+            {
+                entry.cell_width = stoi(parts[3]);
+                entry.cell_height = stoi(parts[4]);
+                entry.columns = stoi(parts[5]);
+                entry.rows = stoi(parts[6]);
+                entry.count = stoi(parts[7]);
+            }
+
+            entries.push_back(entry);
+        }
+    }
+
+    asset_pack_header header;
+    memcpy(header.magic, ASSET_PACK_MAGIC, 8);
+    header.entries = entries.size();
+    header.strings = strings.size();
+
+    ofstream pack(path_to_resources(BUNDLE_RESOURCE) + "/" + ASSET_PACK_FILE, ios::binary);
+    if (pack.fail())
+    {
+        write_line("Can't write " + string(ASSET_PACK_FILE) + " into Resources/bundles");
+        return 1;
+    }
+    pack.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    pack.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(asset_pack_entry));
+    pack.write(strings.data(), strings.size());
+
+    write_line("Packed " + to_string(entries.size() - bundle_files.size()) + " assets from " + to_string(bundle_files.size()) + " bundles into " + ASSET_PACK_FILE);
+    return 0;
+}
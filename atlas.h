@@ -0,0 +1,176 @@
+#include "splashkit.h"
+#include "assetpack.h"
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// Files the atlas packer writes into Resources/bundles
+#define ATLAS_BUNDLE_FILE "atlasbundle.txt"
+#define ATLAS_TABLE_FILE "atlas.txt"
+#define ATLAS_PAGE_NAME "AtlasPage"
+
+// Where one cell of a cell sheet ended up in the atlas
+struct atlas_region
+{
+    int page = 0;
+    rectangle area;
+};
+
+// Remap table from a cell sheet's cells to the atlas pages they were packed into. Lookups go by
+// bitmap so anything holding a cell sheet's bitmap draws from the atlas without knowing about it.
+class TextureAtlas
+{
+    private:
+        vector<bitmap> pages;
+        map<bitmap, vector<atlas_region>> regions;
+        int sheets = 0;
+
+    public:
+        TextureAtlas(){};
+
+        ~TextureAtlas(){};
+
+        // Reads the remap table written by the packer. Lines look like
+        // REGION, <sheet name>, <cell>, <page>, <x>, <y>, <width>, <height>
+        bool load(string table_file)
+        {
+            ifstream table;
+            table.open(table_file);
+            if (table.fail())
+                return false;
+
+            pages.clear();
+            regions.clear();
+            sheets = 0;
+
+            string line;
+            while (getline(table, line))
+            {
+                for (int i = 0; i < line.size(); i++)
+                    if (line[i] == ',')
+                        line[i] = ' ';
+
+                istringstream iss(line);
+                string kind;
+                iss >> kind;
+
+                if (kind == "PAGE")
+                {
+                    string name;
+                    iss >> name;
+                    if (!has_bitmap(name))
+                    {
+                        write_line("Atlas page " + name + " isn't loaded, drawing from the cell sheets");
+                        pages.clear();
+                        regions.clear();
+                        return false;
+                    }
+                    pages.push_back(bitmap_named(name));
+                }
+                else if (kind == "REGION")
+                {
+                    string name;
+                    int cell;
+                    atlas_region region;
+                    if (!(iss >> name >> cell >> region.page >> region.area.x >> region.area.y >> region.area.width >> region.area.height))
+                        continue;
+                    if (region.page >= pages.size() || asset_bitmap(name) == nullptr)
+                        continue;
+
+                    vector<atlas_region> &cells = regions[asset_bitmap(name)];
+                    if (cells.empty())
+                        sheets += 1;
+                    if (cell >= cells.size())
+                        cells.resize(cell + 1);
+                    cells[cell] = region;
+                }
+            }
+
+            return !pages.empty();
+        };
+
+        bool contains(bitmap image)
+        {
+            return regions.count(image) > 0;
+        };
+
+        // Swaps a draw of a cell sheet for the same pixels on its atlas page. Part draws of a single
+        // cell bitmap (the health bars) are moved inside that cell's region.
+        void remap(bitmap &image, drawing_options &opts)
+        {
+            auto found = regions.find(image);
+            if (found == regions.end())
+                return;
+
+            vector<atlas_region> &cells = found->second;
+            atlas_region region;
+
+            if (opts.draw_cell >= 0 && opts.draw_cell < cells.size())
+            {
+                region = cells[opts.draw_cell];
+                opts.is_part = true;
+                opts.part = region.area;
+            }
+            else if (opts.draw_cell < 0 && cells.size() == 1)
+            {
+                region = cells[0];
+                if (opts.is_part)
+                {
+                    rectangle part = opts.part;
+                    part.x += region.area.x;
+                    part.y += region.area.y;
+                    part.width = min(part.width, region.area.x + region.area.width - part.x);
+                    part.height = min(part.height, region.area.y + region.area.height - part.y);
+                    opts.part = part;
+                }
+                else
+                {
+                    opts.is_part = true;
+                    opts.part = region.area;
+                }
+            }
+            else
+                return;
+
+            opts.draw_cell = -1;
+            image = pages[region.page];
+        };
+
+        int get_pages()
+        {
+            return this->pages.size();
+        };
+
+        int get_sheets()
+        {
+            return this->sheets;
+        };
+};
+
+// The atlas every draw is remapped through, empty until load_texture_atlas finds a packed one
+TextureAtlas &texture_atlas()
+{
+    static TextureAtlas atlas;
+    return atlas;
+}
+
+// Loads the atlas pages and remap table if the packer has been run, otherwise the game keeps
+// drawing from the separate cell sheets
+void load_texture_atlas()
+{
+    ifstream bundle;
+    bundle.open(path_to_resource(ATLAS_BUNDLE_FILE, BUNDLE_RESOURCE));
+    if (bundle.fail())
+        return;
+    bundle.close();
+
+    load_resource_bundle("atlas", ATLAS_BUNDLE_FILE);
+    if (texture_atlas().load(path_to_resource(ATLAS_TABLE_FILE, BUNDLE_RESOURCE)))
+        write_line("Drawing " + to_string(texture_atlas().get_sheets()) + " cell sheets from " + to_string(texture_atlas().get_pages()) + " atlas pages");
+}
@@ -0,0 +1,248 @@
+#include "splashkit.h"
+#include "atlas.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// Atlas pages are square, cells are kept this far apart so filtering never picks up a neighbour
+#define ATLAS_PAGE_SIZE 2048
+#define ATLAS_PADDING 2
+
+// A BITMAP line from a bundle that has cell details
+struct atlas_sheet
+{
+    string name;
+    string file;
+    int cell_width;
+    int cell_height;
+    int columns;
+    int rows;
+    int count;
+};
+
+// One cell of an image file and where it goes
+struct atlas_placement
+{
+    int sheet; // First sheet using the image file
+    int cell;
+    atlas_region region;
+};
+
+// Reads every cell sheet out of the given bundle files. Sheets without cell details (backgrounds,
+// logos) are left out, they are drawn whole and would only waste atlas space.
+vector<atlas_sheet> read_atlas_sheets(vector<string> bundle_files)
+{
+    vector<atlas_sheet> sheets;
+
+    for (int i = 0; i < bundle_files.size(); i++)
+    {
+        ifstream bundle;
+        bundle.open(path_to_resource(bundle_files[i], BUNDLE_RESOURCE));
+        if (bundle.fail())
+        {
+            write_line("Can't open bundle " + bundle_files[i]);
+            continue;
+        }
+
+        string line;
+        while (getline(bundle, line))
+        {
+            if (line.rfind("//", 0) == 0)
+                continue;
+
+            for (int j = 0; j < line.size(); j++)
+                if (line[j] == ',')
+                    line[j] = ' ';
+
+            istringstream iss(line);
+            string kind;
+            atlas_sheet sheet;
+            if (!(iss >> kind) || kind != "BITMAP")
+                continue;
+            if (!(iss >> sheet.name >> sheet.file >> sheet.cell_width >> sheet.cell_height >> sheet.columns >> sheet.rows >> sheet.count))
+                continue;
+
+            sheets.push_back(sheet);
+        }
+    }
+
+    return sheets;
+}
+
+// Shelf packs every cell, tallest first, into as many pages as it takes. Sheets that share an
+// image file share their cells. Returns the number of pages used.
+int pack_atlas_cells(vector<atlas_sheet> &sheets, int page_size, vector<atlas_placement> &placements)
+{
+    placements.clear();
+
+    map<string, int> files;
+    for (int i = 0; i < sheets.size(); i++)
+    {
+        if (files.count(sheets[i].file) > 0)
+            continue;
+        files[sheets[i].file] = i;
+
+        if (sheets[i].cell_width + ATLAS_PADDING > page_size || sheets[i].cell_height + ATLAS_PADDING > page_size)
+        {
+            write_line("Cells of " + sheets[i].name + " don't fit on an atlas page, leaving them out");
+            continue;
+        }
+
+        for (int cell = 0; cell < sheets[i].count; cell++)
+        {
+            atlas_placement placement;
+            placement.sheet = i;
+            placement.cell = cell;
+            placement.region.area.width = sheets[i].cell_width;
+            placement.region.area.height = sheets[i].cell_height;
+            placements.push_back(placement);
+        }
+    }
+
+    stable_sort(placements.begin(), placements.end(), [](const atlas_placement &one, const atlas_placement &two) {
+        if (one.region.area.height != two.region.area.height)
+            return one.region.area.height > two.region.area.height;
+        return one.region.area.width > two.region.area.width;
+    });
+
+    int page = 0;
+    int x = 0;
+    int shelf_y = 0;
+    int shelf_height = 0;
+    for (int i = 0; i < placements.size(); i++)
+    {
+        rectangle &area = placements[i].region.area;
+
+        if (x + area.width + ATLAS_PADDING > page_size)
+        {
+            x = 0;
+            shelf_y += shelf_height;
+            shelf_height = 0;
+        }
+        if (shelf_y + area.height + ATLAS_PADDING > page_size)
+        {
+            page += 1;
+            x = 0;
+            shelf_y = 0;
+            shelf_height = 0;
+        }
+
+        placements[i].region.page = page;
+        area.x = x + ATLAS_PADDING / 2;
+        area.y = shelf_y + ATLAS_PADDING / 2;
+
+        x += area.width + ATLAS_PADDING;
+        if (area.height + ATLAS_PADDING > shelf_height)
+            shelf_height = area.height + ATLAS_PADDING;
+    }
+
+    return placements.empty() ? 0 : page + 1;
+}
+
+// save_bitmap always writes to the desktop, so the page is moved into Resources/images after
+bool save_atlas_page(bitmap page, string file)
+{
+    string base = file.substr(0, file.rfind('.'));
+    save_bitmap(page, base);
+
+    const char *home = getenv("HOME");
+    string saved = string(home == nullptr ? "" : home) + "/Desktop/" + file;
+    string images = path_to_resources(IMAGE_RESOURCE);
+    if (!images.empty() && images.back() != '/')
+        images += "/";
+
+    if (rename(saved.c_str(), (images + file).c_str()) != 0)
+    {
+        write_line("Couldn't move " + saved + " into " + images + ", copy it there by hand");
+        return false;
+    }
+
+    return true;
+}
+
+// Offline step: packs the cell sheets of the given bundles into atlas pages, saves them into
+// Resources/images and writes the atlas bundle and remap table into Resources/bundles
+int build_texture_atlas(vector<string> bundle_files)
+{
+    vector<atlas_sheet> sheets = read_atlas_sheets(bundle_files);
+    vector<atlas_placement> placements;
+    int pages = pack_atlas_cells(sheets, ATLAS_PAGE_SIZE, placements);
+
+    if (pages == 0)
+    {
+        write_line("No cell sheets to pack");
+        return 1;
+    }
+
+    // Every page is saved before the atlas files are touched, so a page that didn't make it into
+    // Resources/images never ends up in a table that points at it
+    vector<string> page_names;
+    vector<string> page_files;
+    bool saved = true;
+    for (int p = 0; p < pages; p++)
+    {
+        string name = ATLAS_PAGE_NAME + to_string(p);
+        string file = "atlas_" + to_string(p) + ".png";
+
+        bitmap page = create_bitmap(name, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+        clear_bitmap(page, COLOR_TRANSPARENT);
+        for (int i = 0; i < placements.size(); i++)
+        {
+            if (placements[i].region.page != p)
+                continue;
+
+            atlas_sheet &sheet = sheets[placements[i].sheet];
+            rectangle area = placements[i].region.area;
+            draw_bitmap_on_bitmap(page, asset_bitmap(sheet.name), area.x, area.y, option_with_bitmap_cell(placements[i].cell));
+        }
+
+        saved = save_atlas_page(page, file) && saved;
+        free_bitmap(page);
+        page_names.push_back(name);
+        page_files.push_back(file);
+    }
+
+    if (!saved)
+    {
+        write_line("Atlas pages missing from Resources/images, the atlas files were left as they were");
+        return 1;
+    }
+
+    ofstream bundle(path_to_resources(BUNDLE_RESOURCE) + "/" + ATLAS_BUNDLE_FILE);
+    ofstream table(path_to_resources(BUNDLE_RESOURCE) + "/" + ATLAS_TABLE_FILE);
+    if (bundle.fail() || table.fail())
+    {
+        write_line("Can't write the atlas files into Resources/bundles");
+        return 1;
+    }
+
+    for (int p = 0; p < pages; p++)
+    {
+        bundle << "BITMAP, " << page_names[p] << ", " << page_files[p] << endl;
+        table << "PAGE, " << page_names[p] << endl;
+    }
+
+    // Every sheet gets its own lines, including the ones that share an image file
+    for (int s = 0; s < sheets.size(); s++)
+        for (int i = 0; i < placements.size(); i++)
+        {
+            if (sheets[placements[i].sheet].file != sheets[s].file)
+                continue;
+
+            rectangle area = placements[i].region.area;
+            table << "REGION, " << sheets[s].name << ", " << placements[i].cell << ", " << placements[i].region.page << ", "
+                  << area.x << ", " << area.y << ", " << area.width << ", " << area.height << endl;
+        }
+
+    write_line("Packed " + to_string(placements.size()) + " cells from " + to_string(sheets.size()) + " cell sheets into " + to_string(pages) + " atlas pages");
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "splashkit.h"
+#include "renderqueue.h"
 #include <vector>
 
 class Background
@@ -14,7 +15,7 @@ class Background
         {
             for(int i = 0; i < images.size(); i++)
             {
-                draw_bitmap(images[i], 0, 0, option_to_screen());
+                submit_bitmap(images[i], 0, 0, option_to_screen());
             }
         };
 };
@@ -24,7 +25,7 @@ class GreyBackground : public Background
     public:
         GreyBackground()
         {
-            images.push_back(bitmap_named("GreyBackground"));
+            images.push_back(asset_bitmap("GreyBackground"));
         }
 };
 
@@ -33,6 +34,6 @@ class DarkBackground : public Background
     public:
         DarkBackground()
         {
-            images.push_back(bitmap_named("DarkBackground"));
+            images.push_back(asset_bitmap("DarkBackground"));
         }
 };
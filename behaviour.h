@@ -1,304 +1,146 @@
 #include "splashkit.h"
+#include "player.h"
+#include "navigation.h"
+#include <memory>
 #pragma once
 
-class Behaviour
-{
-    protected:
-        sprite enemy_sprite;
-        bool facing_left = true;
-        bool on_floor = true;
-        bool is_flying = false;
-        bool once = false;
-        
-
-    public:
-        Behaviour(sprite enemy_sprite)
-        {
-            this->enemy_sprite = enemy_sprite;
-        };
-        ~Behaviour(){};
-        virtual void update() = 0;
-
-        void update_animation(string left_anim, string right_anim)
-        {
-            if(facing_left)
-                sprite_start_animation(enemy_sprite, left_anim);
-            else
-                sprite_start_animation(enemy_sprite, right_anim);
-        }
-
-        void set_on_floor(bool new_value)
-        {
-            this->on_floor = new_value;
-        };
-
-        void set_facing_left(bool new_value)
-        {
-            this->once = false;
-            this->facing_left = new_value;
-        };
-
-        bool is_on_floor()
-        {
-            return this->on_floor;
-        };
+// Enemy Physics Variables
+#define ENEMY_WALK_SPEED 3
+#define ENEMY_FALL_SPEED 10
+#define ENEMY_HUNT_RANGE 16 // tiles
 
-        void set_y_value(float val)
-        {
-            sprite_set_y(enemy_sprite, val + (64 - sprite_height(enemy_sprite)));
-        };
-
-};
-
-class RoachBehaviour : public Behaviour
+enum enemy_type
 {
-    public:
-        RoachBehaviour(sprite enemy_sprite) : Behaviour(enemy_sprite)
-        {
-            if(facing_left)
-                sprite_start_animation(enemy_sprite, "LeftRun");
-            else
-                sprite_start_animation(enemy_sprite, "RightRun");
-            
-        };
-        ~RoachBehaviour()
-        {
-        };
-        void update() override
-        {
-            if(facing_left)
-            {
-                if(!once)
-                {
-                    update_animation("LeftRun", "RightRun");
-                    once = true;
-                }
-                sprite_set_dx(enemy_sprite, 3);
-            }
-            else
-            {
-                if(!once)
-                {
-                    update_animation("LeftRun", "RightRun");
-                    once = true;
-                }
-                sprite_set_dx(enemy_sprite, -3);
-            }
-
-            if(on_floor)
-            {
-                sprite_set_dy(enemy_sprite, 0);
-            }
-            else
-            {
-                sprite_set_dy(enemy_sprite, 10);
-            }
-        };
-
+    ENEMY_ROACH,
+    ENEMY_BLOB,
+    ENEMY_SNAKE,
+    ENEMY_RAT,
+    ENEMY_WATER_RAT,
+    ENEMY_TYPE_COUNT
 };
 
-class BlobBehaviour : public Behaviour
+// Everything that makes one kind of enemy different from another
+struct enemy_kind
 {
-    private:
-        vector<std::shared_ptr<Player>> level_players;
-
-    public:
-        BlobBehaviour(sprite enemy_sprite) : Behaviour(enemy_sprite)
-        {
-            if(facing_left)
-                sprite_start_animation(enemy_sprite, "LeftRun");
-            else
-                sprite_start_animation(enemy_sprite, "RightRun");
-        };
-        
-        ~BlobBehaviour()
-        {
-        };
-
-        void update() override
-        {
-            if(facing_left)
-            {
-                if(!once)
-                {
-                    update_animation("LeftRun", "RightRun");
-                    once = true;
-                }
-                sprite_set_dx(enemy_sprite, 3);
-            }
-            else
-            {
-                if(!once)
-                {
-                    update_animation("LeftRun", "RightRun");
-                    once = true;
-                }
-                sprite_set_dx(enemy_sprite, -3);
-            }
-
-            if(on_floor)
-            {
-                sprite_set_dy(enemy_sprite, 0);
-            }
-            else
-            {
-                sprite_set_dy(enemy_sprite, 10);
-            }
-        };
+    string bitmap_name;
+    string animation_name;
+    string bundle_name; // Resource bundle the bitmap and animation come from
+    int hp; // Times it can be jumped on before the jump that kills it
+    double walk_speed;
+    bool chases_players;
 };
 
-class SnakeBehaviour : public Behaviour
+enemy_kind get_enemy_kind(int type)
 {
-    private:
-        vector<std::shared_ptr<Player>> level_players;
-
-    public:
-        SnakeBehaviour(sprite enemy_sprite, vector<std::shared_ptr<Player>> level_players) : Behaviour(enemy_sprite)
-        {
-            this->level_players = level_players;
-            if(facing_left)
-                sprite_start_animation(enemy_sprite, "LeftRun");
-            else
-                sprite_start_animation(enemy_sprite, "RightRun");
-        };
-        ~SnakeBehaviour()
-        {
-        };
-        void update() override
-        {
-            for(int i = 0; i < level_players.size(); i++)
-            {
-                
-            }
-            if(facing_left)
-            {
-                if(!once)
-                {
-                    update_animation("LeftRun", "RightRun");
-                    once = true;
-                }
-                sprite_set_dx(enemy_sprite, 3);
-            }
-            else
-            {
-                if(!once)
-                {
-                    update_animation("LeftRun", "RightRun");
-                    once = true;
-                }
-                sprite_set_dx(enemy_sprite, -3);
-            }
-
-            if(on_floor)
-            {
-                sprite_set_dy(enemy_sprite, 0);
-            }
-            else
-            {
-                sprite_set_dy(enemy_sprite, 10);
-            }
-        };
-
-};
-
-class RatBehaviour : public Behaviour
+    enemy_kind kind;
+    kind.hp = 0;
+    kind.walk_speed = ENEMY_WALK_SPEED;
+    kind.chases_players = false;
+
+    switch(type)
+    {
+        case ENEMY_ROACH:
+            kind.bitmap_name = "Roach";
+            kind.animation_name = "RoachAnim";
+            kind.bundle_name = "roach";
+            break;
+        case ENEMY_BLOB:
+            kind.bitmap_name = "Blob";
+            kind.animation_name = "BlobAnim";
+            kind.bundle_name = "blob";
+            kind.hp = 3; // Blob has 3 hit points. If blob gets jumped on 3 times. It dies.
+            break;
+        case ENEMY_SNAKE:
+            kind.bitmap_name = "Snake";
+            kind.animation_name = "SnakeAnim";
+            kind.bundle_name = "snake";
+            kind.chases_players = true;
+            break;
+        case ENEMY_RAT:
+            kind.bitmap_name = "Rat";
+            kind.animation_name = "RatAnim";
+            kind.bundle_name = "rat";
+            kind.chases_players = true;
+            break;
+        case ENEMY_WATER_RAT:
+            kind.bitmap_name = "WaterRat";
+            kind.animation_name = "WaterRatAnim";
+            kind.bundle_name = "water_rat";
+            break;
+        default:
+            break;
+    }
+
+    return kind;
+}
+
+// Enemy type a level tile spawns, -1 when the tile isn't an enemy
+int enemy_type_from_tile(int tile)
+{
+    switch(tile)
+    {
+        case 1401:
+        case 1402:
+            return ENEMY_ROACH;
+        case 1403:
+        case 1404:
+            return ENEMY_SNAKE;
+        case 1405:
+        case 1406:
+            return ENEMY_RAT;
+        case 1407:
+        case 1408:
+            return ENEMY_BLOB;
+        default:
+            return -1;
+    }
+}
+
+// Horizontal speed for a facing. facing_left walks in the positive x direction.
+double enemy_walk_dx(bool facing_left, double walk_speed)
 {
-    private:
-        vector<std::shared_ptr<Player>> level_players;
+    if(facing_left)
+        return walk_speed;
+    else
+        return -walk_speed;
+}
+
+// Picks the player with the shortest walk, as long as they are within hunting range. -1 for nobody.
+int select_enemy_target(Navigation *navigation, point_2d feet, vector<std::shared_ptr<Player>> &level_players)
+{
+    int target_player = -1;
+    if(navigation == nullptr)
+        return target_player;
 
-    public:
-        RatBehaviour(sprite enemy_sprite, vector<std::shared_ptr<Player>> level_players) : Behaviour(enemy_sprite)
-        {
-            this->level_players = level_players;
-            if(facing_left)
-                sprite_start_animation(enemy_sprite, "LeftRun");
-            else
-                sprite_start_animation(enemy_sprite, "RightRun");
-            
-        };
-        ~RatBehaviour()
-        {
-        };
-        void update() override
+    int best = ENEMY_HUNT_RANGE + 1;
+    for(int i = 0; i < level_players.size(); i++)
+    {
+        if(level_players[i]->is_player_dead() || level_players[i]->get_state_type() == "Dying" || level_players[i]->get_state_type() == "Spawn")
+            continue;
+
+        int distance = navigation->distance_to(i, feet);
+        if(distance != NAV_UNREACHABLE && distance < best)
         {
-            for(int i = 0; i < level_players.size(); i++)
-            {
-                
-            }
-            if(facing_left)
-            {
-                if(!once)
-                {
-                    update_animation("LeftRun", "RightRun");
-                    once = true;
-                }
-                sprite_set_dx(enemy_sprite, 3);
-            }
-            else
-            {
-                if(!once)
-                {
-                    update_animation("LeftRun", "RightRun");
-                    once = true;
-                }
-                sprite_set_dx(enemy_sprite, -3);
-            }
+            best = distance;
+            target_player = i;
+        }
+    }
 
-            if(on_floor)
-            {
-                sprite_set_dy(enemy_sprite, 0);
-            }
-            else
-            {
-                sprite_set_dy(enemy_sprite, 10);
-            }
-        };
+    return target_player;
+}
 
-};
-
-class WaterRatBehaviour : public Behaviour
+// Cheap per frame steering, one lookup in the target's flow field. Returns the new facing.
+bool steer_enemy_to_target(Navigation *navigation, int target_player, point_2d feet, bool facing_left)
 {
-    public:
-        WaterRatBehaviour(sprite enemy_sprite) : Behaviour(enemy_sprite)
-        {
-            if(facing_left)
-                sprite_start_animation(enemy_sprite, "LeftRun");
-            else
-                sprite_start_animation(enemy_sprite, "RightRun");
-            
-        };
-        ~WaterRatBehaviour()
-        {
-        };
-        void update() override
-        {
-            if(facing_left)
-            {
-                if(!once)
-                {
-                    update_animation("LeftRun", "RightRun");
-                    once = true;
-                }
-                sprite_set_dx(enemy_sprite, 3);
-            }
-            else
-            {
-                if(!once)
-                {
-                    update_animation("LeftRun", "RightRun");
-                    once = true;
-                }
-                sprite_set_dx(enemy_sprite, -3);
-            }
+    if(navigation == nullptr || target_player < 0)
+        return facing_left;
+
+    nav_move move = navigation->next_move(target_player, feet);
 
-            if(on_floor)
-            {
-                sprite_set_dy(enemy_sprite, 0);
-            }
-            else
-            {
-                sprite_set_dy(enemy_sprite, 10);
-            }
-        };
+    if(move == NAV_RIGHT)
+        return true;
+    if(move == NAV_LEFT)
+        return false;
 
-};
\ No newline at end of file
+    return facing_left;
+}
@@ -1,8 +1,21 @@
 #include "splashkit.h"
 #include "types.h"
+#include "renderqueue.h"
 
 #pragma once
 
+// The parts of a block that change during play, pipes being picked up, placed and turned and
+// water starting and stopping
+struct block_state
+{
+    bitmap image;
+    drawing_options opts;
+    bool is_turnable;
+    bool is_picked_up;
+    bool is_flowing;
+    bool is_stopped;
+};
+
 class Block
 {
     protected:
@@ -35,7 +48,7 @@ class Block
 
         virtual void draw_block()
         {
-            draw_bitmap(image, position.x, position.y, opts);
+            submit_bitmap(image, position.x, position.y, opts);
             //draw_rectangle(COLOR_GREEN,hitbox);
         };
 
@@ -127,6 +140,28 @@ class Block
         {
             return this->special_hitbox;
         };
+
+        block_state save_state()
+        {
+            block_state state;
+            state.image = this->image;
+            state.opts = this->opts;
+            state.is_turnable = this->is_turnable;
+            state.is_picked_up = this->is_picked_up;
+            state.is_flowing = this->is_flowing;
+            state.is_stopped = this->is_stopped;
+            return state;
+        };
+
+        virtual void restore_state(const block_state &state)
+        {
+            this->image = state.image;
+            this->opts = state.opts;
+            this->is_turnable = state.is_turnable;
+            this->is_picked_up = state.is_picked_up;
+            this->is_flowing = state.is_flowing;
+            this->is_stopped = state.is_stopped;
+        };
 };
 
 class SolidBlock : public Block
@@ -320,7 +355,7 @@ class WaterBlock : public Block
             this->position = position;
             this->cell = cell;
 
-            animation_script water_script = animation_script_named("CellAnim");
+            animation_script water_script = asset_animation("CellAnim");
             animation anim;
             switch(this->cell)
             {
@@ -409,7 +444,7 @@ class WaterBlock : public Block
         {
             if(!is_stopped)
             {
-                draw_bitmap("Water", position.x, position.y, opts);
+                submit_bitmap("Water", position.x, position.y, opts);
                 update_animation(this->anim);
                 if (animation_ended(this->anim))
                     restart_animation(this->anim);
@@ -420,7 +455,7 @@ class WaterBlock : public Block
             {
                 if(is_flowing)
                 {
-                    draw_bitmap("Water", position.x, position.y, opts);
+                    submit_bitmap("Water", position.x, position.y, opts);
                     update_animation(this->anim);
                     if (animation_ended(this->anim))
                         restart_animation(this->anim);
@@ -435,6 +470,13 @@ class WaterBlock : public Block
                     time += 1;
             }
         } 
+
+        void restore_state(const block_state &state) override
+        {
+            Block::restore_state(state);
+            this->time = 0;
+            restart_animation(this->anim);
+        };
 };
 
 class ToxicBlock : public Block
@@ -448,7 +490,7 @@ class ToxicBlock : public Block
             this->cell = cell;
             this->opts.draw_cell = this->cell;
 
-            animation_script toxic_script = animation_script_named("CellAnim");
+            animation_script toxic_script = asset_animation("CellAnim");
             animation anim = create_animation(toxic_script, "ToxicFlow");
             drawing_options opts = option_defaults();
             this->opts = opts;
@@ -458,7 +500,7 @@ class ToxicBlock : public Block
 
         void draw_block() override
         {
-            draw_bitmap("Toxic", position.x, position.y, opts);
+            submit_bitmap("Toxic", position.x, position.y, opts);
             update_animation(this->anim);
             if (animation_ended(this->anim))
                 restart_animation(this->anim);
@@ -487,7 +529,7 @@ class DoorBlock : public Block
         {
             this->opts.draw_cell = this->cell;
 
-            animation_script door_script = animation_script_named("CellAnim");
+            animation_script door_script = asset_animation("CellAnim");
             animation anim = create_animation(door_script, "Door_Open");
             drawing_options opts = option_defaults();
             this->opts = opts;
@@ -510,7 +552,7 @@ class DoorBlock : public Block
 
         void draw_block() override
         {
-            draw_bitmap("Door", position.x, position.y, opts);
+            submit_bitmap("Door", position.x, position.y, opts);
             update_animation(this->anim);
             if (animation_ended(this->anim))
                 restart_animation(this->anim);
@@ -528,13 +570,21 @@ class DoorBlock : public Block
 
         void open_portal()
         {
-            animation_script door_script = animation_script_named("CellAnim");
+            animation_script door_script = asset_animation("CellAnim");
             animation anim = create_animation(door_script, "Door_Portal");
             drawing_options opts = option_defaults();
             this->opts = opts;
             this->anim = anim;
             this->opts.anim = anim;
         }
+
+        // Opening the portal swaps the animation, the saved options still hold the closed door's
+        void restore_state(const block_state &state) override
+        {
+            Block::restore_state(state);
+            this->anim = this->opts.anim;
+            restart_animation(this->anim);
+        };
 };
 
 class HoldablePipeBlock : public Block
@@ -561,7 +611,7 @@ class HoldablePipeBlock : public Block
         void draw_block() override
         {
             if(!is_picked_up)
-                draw_bitmap(image, position.x, position.y, opts);
+                submit_bitmap(image, position.x, position.y, opts);
         };
 };
 
@@ -1,4 +1,6 @@
 #include "splashkit.h"
+#include "textcache.h"
+#include "assetpack.h"
 
 class Button
 {
@@ -7,7 +9,7 @@ class Button
         point_2d position;
         int id;
         string text;
-        font button_font;
+        string button_font;
         int font_size = 25;
         bool selected = false;
         color font_color = COLOR_BLACK;
@@ -18,7 +20,7 @@ class Button
             this->button_bmp = button_bmp;
             this->id = id;
             this->text = text;
-            this->button_font = font_named("DefaultFont");
+            this->button_font = "DefaultFont";
             point_2d pt = screen_center();
             position.x = pt.x - bitmap_width(this->button_bmp)/2;
             position.y = pt.y - bitmap_height(this->button_bmp)/2 + offset;
@@ -34,7 +36,7 @@ class Button
             else
                 font_color = COLOR_RED;
 
-            draw_text(text, font_color, button_font, font_size, (center.x + position.x) - text_width(text, button_font, font_size)/2, (center.y + position.y) - text_height(text, button_font, font_size)/2, option_to_screen());
+            draw_cached_text(text, font_color, button_font, font_size, (center.x + position.x) - cached_text_width(text, button_font, font_size)/2, (center.y + position.y) - cached_text_height(text, button_font, font_size)/2, option_to_screen());
         };
 
         void set_selected(bool new_value)
@@ -1,8 +1,30 @@
 #include "splashkit.h"
 #include "player.h"
 #include <memory>
+#include <vector>
 #pragma once
 
+// World areas the level is shown in this frame, one per split screen view. Empty when the level
+// has the whole screen and SplashKit's camera is all there is.
+std::vector<rectangle> &level_views()
+{
+    static std::vector<rectangle> views;
+    return views;
+}
+
+// Same as rect_on_screen, but true for anything in any of the views
+bool rect_in_view(const rectangle &area)
+{
+    std::vector<rectangle> &views = level_views();
+    if (views.empty())
+        return rect_on_screen(area);
+
+    for (int i = 0; i < views.size(); i++)
+        if (rectangles_intersect(area, views[i]))
+            return true;
+    return false;
+}
+
 class Camera
 {
     private:
@@ -11,6 +33,8 @@ class Camera
         double x_border_right;
         double y_border_bottom;
         std::shared_ptr<Player> player;
+        // The area of the world this camera shows, as big as the screen unless it is one of a split
+        rectangle view;
 
     public:
         Camera(std::shared_ptr<Player> player, int tile_size, int map_height, int map_width)
@@ -19,22 +43,46 @@ class Camera
 
             this->x_border_right = tile_size * map_width;
             this->y_border_bottom = -(tile_size * map_height);
+
+            this->view.x = 0;
+            this->view.y = 0;
+            this->view.width = screen_width();
+            this->view.height = screen_height();
         };
 
         ~Camera(){};
 
+        void set_view_size(double width, double height)
+        {
+            this->view.width = width;
+            this->view.height = height;
+        };
+
+        // Centres the view on the player, kept inside the map
+        void follow()
+        {
+            point_2d center = center_point(this->player->get_player_sprite());
+            view.x = center.x - view.width / 2;
+            view.y = center.y - view.height / 2;
+
+            if(view.x < x_border_left)
+                view.x = x_border_left;
+            if(view.x + view.width > x_border_right)
+                view.x = x_border_right - view.width;
+            if(view.y < y_border_top)
+                view.y = y_border_top;
+            if(y_border_bottom > -view.y - view.height)
+                view.y = abs(y_border_bottom) - view.height;
+        }
 
         void update()
         {
-            center_camera_on(this->player->get_player_sprite(), 0, 0);
-
-            if(camera_x() < x_border_left)
-                set_camera_x(x_border_left);
-            if(camera_x() + screen_width() > x_border_right)
-                set_camera_x(x_border_right - screen_width());
-            if(camera_y() < y_border_top)
-                set_camera_y(y_border_top);
-            if(y_border_bottom > -camera_y() - screen_height())
-                set_camera_y(abs(y_border_bottom) - screen_height());
+            follow();
+            move_camera_to(view.x, view.y);
         }
+
+        rectangle get_view()
+        {
+            return this->view;
+        };
 };
@@ -1,4 +1,5 @@
 #include "splashkit.h"
+#include "renderqueue.h"
 #include <memory>
 
 class Collectable
@@ -25,7 +26,7 @@ class Collectable
         {
             if(!collected)
             {
-                draw_bitmap(image, position.x, position.y, opts);
+                submit_bitmap(image, position.x, position.y, opts);
                 //draw_rectangle(COLOR_GREEN, this->hitbox);
             }
         };
@@ -64,6 +65,11 @@ class Collectable
             this->collected = new_value;
         };
 
+        point_2d get_pos()
+        {
+            return this->position;
+        };
+
         rectangle get_hitbox()
         {
             return this->hitbox;
@@ -85,8 +91,8 @@ class HeartCollectable : public Collectable
         void effect(std::shared_ptr<Player> player)
         {
             //write_line("Heart Effect");
-            if(player->player_health < 3)
-                player->player_health += 1;
+            if(player->get_health() < 3)
+                player->set_health(player->get_health() + 1);
             else
                 collected = false;
         };
@@ -1,9 +1,18 @@
 #include "splashkit.h"
+#include "assetpack.h"
 #include "player.h"
+#include "camera.h"
 #include "playerinput.h"
 #include "block.h"
+#include "enemy.h"
+#include "spatialhash.h"
+#include "sweep.h"
+#include "aabbbatch.h"
+#include "contacts.h"
+#include "telemetry.h"
 #include <memory>
 #include <vector>
+#include <algorithm>
 
 #pragma once
 
@@ -31,106 +40,65 @@ bool test_rectangle_collision(rectangle one, rectangle two)
         return false;
 };
 
-void check_solid_block_collisions(vector<vector<shared_ptr<Block>>> solid_blocks, vector<shared_ptr<Player>> level_players)
+// Sweeps each player from where they were at the start of the frame to where their movement
+// took them, stopping them at the first solid block in the way.
+void resolve_player_movement(SpatialHash<rectangle> &solid_grid, vector<shared_ptr<Player>> level_players)
 {
     for (int k = 0; k < level_players.size(); k++)
     {
-        string collision = "None";
-        for (int j = 0; j < solid_blocks.size(); j++)
-        {
-            for (int i = 0; i < solid_blocks[j].size(); i++)
-            {
-                // if(!rect_on_screen(layers[j][i]->get_block_hitbox()))
-                // continue;
+        if (level_players[k]->is_player_dead())
+            continue;
 
-                // if(!test_rectangle_collision(test_area, layers[j][i]->get_block_hitbox()))
-                //     continue;
+        sprite player_sprite = level_players[k]->get_player_sprite();
+        point_2d from = level_players[k]->get_previous_position();
+        point_2d to = sprite_position(player_sprite);
 
-                collision = solid_blocks[j][i]->test_collision(level_players[k]->get_player_hitbox());
+        // Hitbox at the start of the move, it sits a fixed offset from the sprite
+        rectangle box = level_players[k]->get_player_hitbox();
+        double offset_y = box.y - to.y;
+        box.x = from.x;
+        box.y = from.y + offset_y;
 
-                if (collision == "Top")
-                {
-                    if (level_players[k]->is_on_ladder())
-                    {
-                        level_players[k]->set_player_dy(0);
-                        level_players[k]->set_on_floor(true);
-                        break;
-                    }
-                    level_players[k]->set_on_floor(true);
-                    sprite_set_y(level_players[k]->get_player_sprite(), solid_blocks[j][i]->get_top());
-                    break;
-                }
-                else if (collision == "Bottom")
-                {
-                    if (level_players[k]->is_on_floor())
-                        break;
+        sweep_result result = sweep_box(box, to.x - from.x, to.y - from.y, solid_grid);
+        sprite_set_position(player_sprite, point_at(result.box.x, result.box.y - offset_y));
+        level_players[k]->update_hitbox();
 
-                    if (!sound_effect_playing("HeadHit"))
-                        play_sound_effect("HeadHit");
+        if (result.hit_left || result.hit_right)
+        {
+            level_players[k]->set_player_dx(0);
 
-                    // Checks if the player is on ladder, if yes then it will go to ClimbIdle
-                    if (level_players[k]->is_on_ladder())
-                    {
-                        sprite_start_animation(level_players[k]->get_player_sprite(), "ClimbIdle");
-                        level_players[k]->set_player_dy(0);
-                        sprite_set_y(level_players[k]->get_player_sprite(), sprite_y(level_players[k]->get_player_sprite()) + 1);
-                        break;
-                    }
+            // Checks if the player is on ladder, if yes then it will go to ClimbIdle
+            if (level_players[k]->is_on_ladder())
+                level_players[k]->start_animation("ClimbIdle");
+        }
 
-                    level_players[k]->set_player_dy(0);
-                    level_players[k]->set_on_floor(false);
-                    sprite_set_y(level_players[k]->get_player_sprite(), sprite_y(level_players[k]->get_player_sprite()) + 5);
-                    level_players[k]->change_state(new JumpFallState, "JumpFall");
-                    break;
-                }
-                else if (collision == "Left")
-                {
-                    // Checks if the player is on ladder, if yes then it will go to ClimbIdle
-                    if (level_players[k]->is_on_ladder())
-                    {
-                        level_players[k]->set_player_dx(0);
-                        sprite_set_x(level_players[k]->get_player_sprite(), sprite_x(level_players[k]->get_player_sprite()) - 1);
-                        sprite_start_animation(level_players[k]->get_player_sprite(), "ClimbIdle");
-                        break;
-                    }
-                        
-                    level_players[k]->set_player_dx(0);
-                    level_players[k]->set_on_floor(false);
-                    sprite_set_x(level_players[k]->get_player_sprite(), sprite_x(level_players[k]->get_player_sprite()) - 3);
-                    break;
-                }
-                else if (collision == "Right")
-                {
-                    // Checks if the player is on ladder, if yes then it will go to ClimbIdle
-                    if (level_players[k]->is_on_ladder())
-                    {
-                        level_players[k]->set_player_dx(0);
-                        sprite_start_animation(level_players[k]->get_player_sprite(), "ClimbIdle");
-                        sprite_set_x(level_players[k]->get_player_sprite(), sprite_x(level_players[k]->get_player_sprite()) + 1);
-                        break;
-                    }
+        if (result.hit_ceiling && !level_players[k]->is_on_floor())
+        {
+            if (!sound_effect_playing("HeadHit"))
+                play_asset_sound("HeadHit");
 
-                    level_players[k]->set_player_dx(0);
-                    level_players[k]->set_on_floor(false);
-                    sprite_set_x(level_players[k]->get_player_sprite(), sprite_x(level_players[k]->get_player_sprite()) + 3);
-                    break;
-                }
-            }
-            if (collision != "None")
-                break;
+            level_players[k]->set_player_dy(0);
+
+            // Checks if the player is on ladder, if yes then it will go to ClimbIdle
+            if (level_players[k]->is_on_ladder())
+                level_players[k]->start_animation("ClimbIdle");
+            else
+                level_players[k]->change_state(new JumpFallState, "JumpFall");
         }
 
-        if (collision == "None")
-            level_players[k]->set_on_floor(false);
+        if (result.on_floor && level_players[k]->is_on_ladder())
+            level_players[k]->set_player_dy(0);
+
+        level_players[k]->set_on_floor(result.on_floor);
     }
 }
 
-void check_door_block_collisions(shared_ptr<DoorBlock> door, vector<shared_ptr<Player>> level_players)
+void check_door_block_collisions(shared_ptr<DoorBlock> door, vector<shared_ptr<Player>> level_players, vector<player_contacts> &contacts)
 {
     for (int i = 0; i < level_players.size(); i++)
     {
         string collision = "None";
-        collision = door->test_collision(level_players[i]->get_player_hitbox());
+        collision = contacts[i].door;
 
         if (collision != "None" && level_players[i]->is_on_floor())
             if (level_players[i]->get_state_type() != "Dance")
@@ -142,7 +110,7 @@ void check_door_block_collisions(shared_ptr<DoorBlock> door, vector<shared_ptr<P
     }
 }
 
-void check_ladder_collisions(vector<vector<shared_ptr<Ladder>>> ladders, vector<shared_ptr<Player>> level_players)
+void check_ladder_collisions(vector<vector<shared_ptr<Ladder>>> ladders, vector<shared_ptr<Player>> level_players, vector<player_contacts> &contacts)
 {
     for (int k = 0; k < level_players.size(); k++)
     {
@@ -151,15 +119,15 @@ void check_ladder_collisions(vector<vector<shared_ptr<Ladder>>> ladders, vector<
         {
             for (int i = 0; i < ladders[j].size(); i++)
             {
-                if (!rect_on_screen(ladders[j][i]->get_block_hitbox()))
+                if (!rect_in_view(ladders[j][i]->get_block_hitbox()))
                     continue;
 
                 if(level_players[k]->get_state_type() == "Dying")
                     continue;
 
-                collision = ladders[j][i]->test_collision(level_players[k]->get_player_hitbox());
+                collision = contacts[k].ladders.at(j, i);
 
-                if (collision != "None" && (key_typed(level_players[k]->input.jump_key) || key_typed(level_players[k]->input.crouch_key)))
+                if (collision != "None" && (player_key_typed(level_players[k]->input.jump_key) || player_key_typed(level_players[k]->input.crouch_key)))
                 {
                     level_players[k]->set_on_ladder(true);
                     sprite_set_y(level_players[k]->get_player_sprite(), sprite_y(level_players[k]->get_player_sprite()) - 1);
@@ -178,104 +146,60 @@ void check_ladder_collisions(vector<vector<shared_ptr<Ladder>>> ladders, vector<
     }
 }
 
-void check_enemy_solid_block_collisions(vector<vector<shared_ptr<Block>>> solid_blocks, vector<shared_ptr<Enemy>> level_enemies)
+// The first edge each enemy turns at, found side by side for a chunk of the enemies at a time
+void detect_enemy_edge_contacts(SpatialHash<shared_ptr<EdgeBlock>> &edge_grid, EnemySystem &enemies, vector<int> &level_enemies, int first, int last, vector<contact_side> &sides)
 {
-    for (int k = 0; k < level_enemies.size(); k++)
+    for (int k = first; k < last && k < level_enemies.size(); k++)
     {
-        if (!rect_on_screen(level_enemies[k]->get_enemy_hitbox()))
+        int enemy = level_enemies[k];
+        sides[k] = CONTACT_NONE;
+        if (!enemies.alive(enemy))
             continue;
 
-        string collision = "None";
-        for (int j = 0; j < solid_blocks.size(); j++)
+        vector<shared_ptr<EdgeBlock>> nearby = edge_grid.query_rect_shared(enemies.get_hitbox(enemy));
+        for (int i = 0; i < nearby.size(); i++)
         {
-            for (int i = 0; i < solid_blocks[j].size(); i++)
+            contact_side side = to_contact_side(nearby[i]->test_collision(enemies.get_hitbox(enemy)));
+            if (side == CONTACT_LEFT || side == CONTACT_RIGHT)
             {
-                // if(!rect_on_screen(layers[j][i]->get_block_hitbox()))
-                //     continue;
-
-                // if(!test_rectangle_collision(test_area, layers[j][i]->get_block_hitbox()))
-                //     continue;
-
-                collision = solid_blocks[j][i]->test_collision(level_enemies[k]->get_enemy_hitbox());
-
-                if (collision == "Top")
-                {
-                    level_enemies[k]->get_ai()->set_on_floor(true);
-                    level_enemies[k]->get_ai()->set_y_value(solid_blocks[j][i]->get_top());
-                    break;
-                }
-                else if (collision == "Bottom")
-                {
-                    if (level_enemies[k]->get_ai()->is_on_floor())
-                        break;
-                }
-                else if (collision == "Left")
-                {
-                    level_enemies[k]->get_ai()->set_facing_left(false);
-                    break;
-                }
-                else if (collision == "Right")
-                {
-                    level_enemies[k]->get_ai()->set_facing_left(true);
-                    break;
-                }
-            }
-
-            if (collision != "None")
+                sides[k] = side;
                 break;
+            }
         }
-
-        if (collision == "None")
-            level_enemies[k]->get_ai()->set_on_floor(false);
     }
 }
 
-void check_enemy_edge_block_collisions(vector<vector<shared_ptr<EdgeBlock>>> level_edges, vector<shared_ptr<Enemy>> level_enemies)
+void check_enemy_edge_block_collisions(EnemySystem &enemies, vector<int> level_enemies, vector<contact_side> &sides)
 {
     for (int k = 0; k < level_enemies.size(); k++)
     {
-        if (!rect_on_screen(level_enemies[k]->get_enemy_hitbox()))
+        int enemy = level_enemies[k];
+        if (!enemies.alive(enemy) || !rect_in_view(enemies.get_hitbox(enemy)))
             continue;
 
-        string collision = "None";
-        for (int j = 0; j < level_edges.size(); j++)
-        {
-            for (int i = 0; i < level_edges[j].size(); i++)
-            {
-                // if(!rect_on_screen(layers[j][i]->get_block_hitbox()))
-                //     continue;
-
-                // if(!test_rectangle_collision(test_area, layers[j][i]->get_block_hitbox()))
-                //     continue;
-
-                collision = level_edges[j][i]->test_collision(level_enemies[k]->get_enemy_hitbox());
-
-                if (collision == "Left")
-                {
-                    level_enemies[k]->get_ai()->set_facing_left(false);
-                    break;
-                }
-                else if (collision == "Right")
-                {
-                    level_enemies[k]->get_ai()->set_facing_left(true);
-                    break;
-                }
-            }
-
-            if (collision != "None")
-                break;
-        }
+        if (sides[k] == CONTACT_LEFT)
+            enemies.set_facing_left(enemy, false);
+        else if (sides[k] == CONTACT_RIGHT)
+            enemies.set_facing_left(enemy, true);
     }
 }
 
-void check_enemy_player_collisions(vector<shared_ptr<Enemy>> level_enemies, vector<shared_ptr<Player>> level_players)
+void check_enemy_player_collisions(EnemySystem &enemies, vector<shared_ptr<Player>> level_players, vector<player_contacts> &contacts)
 {
+    // Only enemies in the buckets around a player can touch one, keep them in level order
+    vector<int> level_enemies;
+    for (int j = 0; j < level_players.size(); j++)
+        level_enemies.insert(level_enemies.end(), contacts[j].enemies.begin(), contacts[j].enemies.end());
+    sort(level_enemies.begin(), level_enemies.end());
+    level_enemies.erase(unique(level_enemies.begin(), level_enemies.end()), level_enemies.end());
+
     for (int i = 0; i < level_enemies.size(); i++)
     {
-        if (!rect_on_screen(level_enemies[i]->get_enemy_hitbox()))
+        int enemy = level_enemies[i];
+        if (!enemies.alive(enemy))
             continue;
 
-        if (level_enemies[i]->get_dead())
+        if (!rect_in_view(enemies.get_hitbox(enemy)))
             continue;
 
         string collision = "None";
@@ -284,7 +208,7 @@ void check_enemy_player_collisions(vector<shared_ptr<Enemy>> level_enemies, vect
             if(level_players[j]->get_state_type() == "Dying" || level_players[j]->get_state_type() == "Spawn")
                 continue;
 
-            collision = level_enemies[i]->test_collision(level_players[j]->get_player_hitbox());
+            collision = enemies.test_collision(enemy, level_players[j]->get_player_hitbox());
 
             if (collision != "Top" && collision != "None")
             {
@@ -293,41 +217,48 @@ void check_enemy_player_collisions(vector<shared_ptr<Enemy>> level_enemies, vect
 
                 if (attack_success)
                 {
-                    level_enemies[i]->set_dead(true);
+                    telemetry().record(TELEMETRY_ENEMY_KILL, level_players[j]->get_slot(), rectangle_center(enemies.get_hitbox(enemy)));
+                    enemies.kill(enemy);
+                    level_players[j]->add_score(SCORE_ENEMY);
+                    break;
                 }
                 else
                 {
                     // player get hurt
-                    string damage_timer = "DamageTimerP" + std::to_string(j + 1);
-                    if (!timer_started(timer_named(damage_timer)))
+                    string damage_timer = player_timer("Damage", level_players[j]->get_slot());
+                    if (!level_clock().started(damage_timer))
                     {
-                        level_players[j]->player_health -= 1;
-                        start_timer(damage_timer);
+                        level_players[j]->set_health(level_players[j]->get_health() - 1);
+                        level_clock().start(damage_timer);
                         level_players[j]->change_state(new HurtState, "Hurt");
                     }
 
-                    int time = timer_ticks(damage_timer) / 1000;
+                    int time = level_clock().ticks(damage_timer) / 1000;
 
                     // Invincibility frames
                     if (!(time < 2))
-                        stop_timer(damage_timer);
+                        level_clock().stop(damage_timer);
                 }
             }
             else if (collision != "None" && !level_players[j]->is_on_floor())
             {
                 // Jumped on enemy
-                if (level_enemies[i]->get_hp() == 0) // If HP is not 0, then take damage.
+                level_players[j]->change_state(new JumpRiseState, "JumpRise");
+                level_players[j]->set_player_dx(0);
+
+                if (enemies.get_hp(enemy) == 0) // If HP is not 0, then take damage.
                 {
                     if (!sound_effect_playing("EnemyDead"))
-                        play_sound_effect("EnemyDead");
-                    level_enemies[i]->set_dead(true);
+                        play_asset_sound("EnemyDead");
+                    telemetry().record(TELEMETRY_ENEMY_KILL, level_players[j]->get_slot(), rectangle_center(enemies.get_hitbox(enemy)));
+                    enemies.kill(enemy);
+                    level_players[j]->add_score(SCORE_ENEMY);
+                    break;
                 }
                 else 
                 {
-                    level_enemies[i]->take_damage(1); // By 1 hp.
+                    enemies.take_damage(enemy, 1); // By 1 hp.
                 }
-                level_players[j]->change_state(new JumpRiseState, "JumpRise");
-                level_players[j]->set_player_dx(0);
             }
         }
         if (collision != "None")
@@ -335,7 +266,7 @@ void check_enemy_player_collisions(vector<shared_ptr<Enemy>> level_enemies, vect
     }
 }
 
-void check_water_block_collisions(vector<vector<shared_ptr<WaterBlock>>> water, vector<shared_ptr<Player>> level_players)
+void check_water_block_collisions(vector<vector<shared_ptr<WaterBlock>>> water, vector<shared_ptr<Player>> level_players, vector<player_contacts> &contacts)
 {
     for (int k = 0; k < level_players.size(); k++)
     {
@@ -344,18 +275,18 @@ void check_water_block_collisions(vector<vector<shared_ptr<WaterBlock>>> water,
         {
             for (int i = 0; i < water[j].size(); i++)
             {
-                if (!rect_on_screen(water[j][i]->get_block_hitbox()))
+                if (!rect_in_view(water[j][i]->get_block_hitbox()))
                     continue;
 
                 if (water[j][i]->get_is_flowing())
-                    collision = water[j][i]->test_collision(level_players[k]->get_player_hitbox());
+                    collision = contacts[k].water.at(j, i);
                 else
                     continue;
 
                 if (collision == "Left")
                 {
                     if (!sound_effect_playing("Water"))
-                        play_sound_effect("Water");
+                        play_asset_sound("Water");
                     level_players[k]->set_player_dx(0);
                     sprite_set_x(level_players[k]->get_player_sprite(), sprite_x(level_players[k]->get_player_sprite()) - 3);
                     break;
@@ -363,7 +294,7 @@ void check_water_block_collisions(vector<vector<shared_ptr<WaterBlock>>> water,
                 else if (collision == "Right")
                 {
                     if (!sound_effect_playing("Water"))
-                        play_sound_effect("Water");
+                        play_asset_sound("Water");
                     level_players[k]->set_player_dx(0);
                     sprite_set_x(level_players[k]->get_player_sprite(), sprite_x(level_players[k]->get_player_sprite()) + 3);
                     break;
@@ -376,47 +307,39 @@ void check_water_block_collisions(vector<vector<shared_ptr<WaterBlock>>> water,
     }
 }
 
-void check_toxic_block_collisions(vector<vector<shared_ptr<ToxicBlock>>> toxic, vector<shared_ptr<Player>> level_players)
+void check_toxic_block_collisions(vector<shared_ptr<ToxicBlock>> &toxic, vector<shared_ptr<Player>> level_players, vector<player_contacts> &contacts)
 {
     for (int k = 0; k < level_players.size(); k++)
     {
-        string collision = "None";
-        for (int j = 0; j < toxic.size(); j++)
-        {
-            for (int i = 0; i < toxic[j].size(); i++)
-            {
-                if (!rect_on_screen(toxic[j][i]->get_block_hitbox()))
-                    continue;
-                
-                if(level_players[k]->get_state_type() == "Dying" || level_players[k]->get_state_type() == "Spawn")
-                    continue;
+        if(level_players[k]->get_state_type() == "Dying" || level_players[k]->get_state_type() == "Spawn")
+            continue;
 
-                collision = toxic[j][i]->test_collision(level_players[k]->get_player_hitbox());
+        vector<uint64_t> &overlaps = contacts[k].toxic;
+        for (int i = aabb_next_overlap(overlaps, 0); i >= 0; i = aabb_next_overlap(overlaps, i + 1))
+        {
+            if (!rect_in_view(toxic[i]->get_block_hitbox()))
+                continue;
 
-                if (collision != "None")
-                {
-                    string damage_timer = "DamageTimerP" + std::to_string(k + 1);
-                    if (!timer_started(timer_named(damage_timer)))
-                    {
-                        level_players[k]->player_health -= 1;
-                        start_timer(damage_timer);
-                    }
+            string damage_timer = player_timer("Damage", level_players[k]->get_slot());
+            if (!level_clock().started(damage_timer))
+            {
+                level_players[k]->set_health(level_players[k]->get_health() - 1);
+                level_clock().start(damage_timer);
+            }
 
-                    int time = timer_ticks(damage_timer) / 1000;
+            int time = level_clock().ticks(damage_timer) / 1000;
 
-                    // Invincibility frames
-                    if (!(time < 2))
-                    {
-                        stop_timer(damage_timer);
-                        break;
-                    }
-                }
+            // Invincibility frames
+            if (!(time < 2))
+            {
+                level_clock().stop(damage_timer);
+                break;
             }
         }
     }
 }
 
-void check_holdable_pipe_block_collisions(vector<vector<shared_ptr<HoldablePipeBlock>>> pipes, vector<shared_ptr<Player>> level_players)
+void check_holdable_pipe_block_collisions(vector<vector<shared_ptr<HoldablePipeBlock>>> pipes, vector<shared_ptr<Player>> level_players, vector<player_contacts> &contacts)
 {
     for (int k = 0; k < level_players.size(); k++)
     {
@@ -431,14 +354,14 @@ void check_holdable_pipe_block_collisions(vector<vector<shared_ptr<HoldablePipeB
             for (int i = 0; i < pipes[j].size(); i++)
             {
                 if (!pipes[j][i]->picked_up())
-                    collision = pipes[j][i]->test_collision(level_players[k]->get_player_hitbox());
+                    collision = contacts[k].hold_pipes.at(j, i);
                 else
                     continue;
 
                 if (collision != "None")
                 {
                     if (!sound_effect_playing("Pickup"))
-                            play_sound_effect("Pickup");
+                            play_asset_sound("Pickup");
                             
                     // Pink and purple can interact with these pipes
                     if (pipes[j][i]->get_cell() < 6)
@@ -447,6 +370,7 @@ void check_holdable_pipe_block_collisions(vector<vector<shared_ptr<HoldablePipeB
                         {
                             pipes[j][i]->set_picked_up(true);
                             level_players[k]->pick_pipe(pipes[j][i]);
+                            telemetry().record(TELEMETRY_PIPE_PICKUP, level_players[k]->get_slot(), pipes[j][i]->get_pos());
                             break;
                         }
                     }
@@ -457,6 +381,7 @@ void check_holdable_pipe_block_collisions(vector<vector<shared_ptr<HoldablePipeB
                         {
                             pipes[j][i]->set_picked_up(true);
                             level_players[k]->pick_pipe(pipes[j][i]);
+                            telemetry().record(TELEMETRY_PIPE_PICKUP, level_players[k]->get_slot(), pipes[j][i]->get_pos());
                             break;
                         }
                     }
@@ -465,6 +390,7 @@ void check_holdable_pipe_block_collisions(vector<vector<shared_ptr<HoldablePipeB
                     {
                         pipes[j][i]->set_picked_up(true);
                         level_players[k]->pick_pipe(pipes[j][i]);
+                        telemetry().record(TELEMETRY_PIPE_PICKUP, level_players[k]->get_slot(), pipes[j][i]->get_pos());
                         break;
                     }
                 }
@@ -473,7 +399,7 @@ void check_holdable_pipe_block_collisions(vector<vector<shared_ptr<HoldablePipeB
     }
 }
 
-void check_turnable_pipe_block_collisions(vector<vector<shared_ptr<TurnablePipeBlock>>> pipes, vector<shared_ptr<Player>> level_players)
+void check_turnable_pipe_block_collisions(vector<vector<shared_ptr<TurnablePipeBlock>>> pipes, vector<shared_ptr<Player>> level_players, vector<player_contacts> &contacts)
 {
     for (int k = 0; k < level_players.size(); k++)
     {
@@ -483,9 +409,9 @@ void check_turnable_pipe_block_collisions(vector<vector<shared_ptr<TurnablePipeB
             for (int i = 0; i < pipes[j].size(); i++)
             {
                 if (pipes[j][i]->get_turnable())
-                    collision = pipes[j][i]->test_collision(level_players[k]->get_player_hitbox());
+                    collision = contacts[k].turn_pipes.at(j, i);
 
-                if (collision != "None" && key_typed(level_players[k]->input.attack_key))
+                if (collision != "None" && player_key_typed(level_players[k]->input.attack_key))
                 {
                     // Pink and purple can interact with these pipes
                     if (pipes[j][i]->get_cell() < 2)
@@ -494,6 +420,7 @@ void check_turnable_pipe_block_collisions(vector<vector<shared_ptr<TurnablePipeB
                         {
                             //write_line("Turned");
                             pipes[j][i]->set_turnable(false);
+                            telemetry().record(TELEMETRY_PIPE_TURN, level_players[k]->get_slot(), pipes[j][i]->get_pos());
                             break;
                         }
                     }
@@ -504,6 +431,7 @@ void check_turnable_pipe_block_collisions(vector<vector<shared_ptr<TurnablePipeB
                         {
                             //write_line("Turned");
                             pipes[j][i]->set_turnable(false);
+                            telemetry().record(TELEMETRY_PIPE_TURN, level_players[k]->get_slot(), pipes[j][i]->get_pos());
                             break;
                         }
                     }
@@ -512,6 +440,7 @@ void check_turnable_pipe_block_collisions(vector<vector<shared_ptr<TurnablePipeB
                     {
                         //write_line("Turned");
                         pipes[j][i]->set_turnable(false);
+                        telemetry().record(TELEMETRY_PIPE_TURN, level_players[k]->get_slot(), pipes[j][i]->get_pos());
                         break;
                     }
                 }
@@ -520,7 +449,7 @@ void check_turnable_pipe_block_collisions(vector<vector<shared_ptr<TurnablePipeB
     }
 }
 
-void check_multi_turnable_pipe_block_collisions(vector<vector<shared_ptr<MultiTurnablePipeBlock>>> pipes, vector<shared_ptr<Player>> level_players)
+void check_multi_turnable_pipe_block_collisions(vector<vector<shared_ptr<MultiTurnablePipeBlock>>> pipes, vector<shared_ptr<Player>> level_players, vector<player_contacts> &contacts)
 {
     for (int k = 0; k < level_players.size(); k++)
     {
@@ -529,9 +458,9 @@ void check_multi_turnable_pipe_block_collisions(vector<vector<shared_ptr<MultiTu
         {
             for (int i = 0; i < pipes[j].size(); i++)
             {
-                collision = pipes[j][i]->test_collision(level_players[k]->get_player_hitbox());
+                collision = contacts[k].multi_pipes.at(j, i);
 
-                if (collision != "None" && key_typed(level_players[k]->input.attack_key))
+                if (collision != "None" && player_key_typed(level_players[k]->input.attack_key))
                 {
                     // Pink and purple can interact with these pipes
                     if (pipes[j][i]->get_cell() < 2)
@@ -542,6 +471,7 @@ void check_multi_turnable_pipe_block_collisions(vector<vector<shared_ptr<MultiTu
                                 pipes[j][i]->set_turnable(false);
                             else
                                 pipes[j][i]->set_turnable(true);
+                            telemetry().record(TELEMETRY_PIPE_TURN, level_players[k]->get_slot(), pipes[j][i]->get_pos());
 
                             break;
                         }
@@ -555,6 +485,7 @@ void check_multi_turnable_pipe_block_collisions(vector<vector<shared_ptr<MultiTu
                                 pipes[j][i]->set_turnable(false);
                             else
                                 pipes[j][i]->set_turnable(true);
+                            telemetry().record(TELEMETRY_PIPE_TURN, level_players[k]->get_slot(), pipes[j][i]->get_pos());
 
                             break;
                         }
@@ -566,6 +497,7 @@ void check_multi_turnable_pipe_block_collisions(vector<vector<shared_ptr<MultiTu
                             pipes[j][i]->set_turnable(false);
                         else
                             pipes[j][i]->set_turnable(true);
+                        telemetry().record(TELEMETRY_PIPE_TURN, level_players[k]->get_slot(), pipes[j][i]->get_pos());
 
                         break;
                     }
@@ -575,7 +507,7 @@ void check_multi_turnable_pipe_block_collisions(vector<vector<shared_ptr<MultiTu
     }
 }
 
-void check_empty_pipe_block_collisions(vector<vector<shared_ptr<EmptyPipeBlock>>> empty_pipes, vector<shared_ptr<Player>> level_players)
+void check_empty_pipe_block_collisions(vector<vector<shared_ptr<EmptyPipeBlock>>> empty_pipes, vector<shared_ptr<Player>> level_players, vector<player_contacts> &contacts)
 {
     for (int k = 0; k < level_players.size(); k++)
     {
@@ -588,7 +520,7 @@ void check_empty_pipe_block_collisions(vector<vector<shared_ptr<EmptyPipeBlock>>
         {
             for (int i = 0; i < empty_pipes[j].size(); i++)
             {
-                collision = empty_pipes[j][i]->special_collision(level_players[k]->get_player_hitbox());
+                collision = contacts[k].empty_pipes.at(j, i);
 
                 if (collision != "None")
                 {
@@ -597,7 +529,8 @@ void check_empty_pipe_block_collisions(vector<vector<shared_ptr<EmptyPipeBlock>>
                         // write_line("Collision between Held Pipe Id: " + std::to_string(level_players[k]->get_held_pipe()->get_cell()) + " Empty Block Id: " + std::to_string(empty_pipes[j][i]->get_cell()));
                         //  player place this pipe
                         level_players[k]->place_pipe(empty_pipes[j][i]);
-                        empty_pipes[j][i]->change_cell_sheet(bitmap_named("HoldPipes"));
+                        telemetry().record(TELEMETRY_PIPE_PLACE, level_players[k]->get_slot(), empty_pipes[j][i]->get_pos());
+                        empty_pipes[j][i]->change_cell_sheet(asset_bitmap("HoldPipes"));
                         empty_pipes[j][i]->set_flowing(false);
                         empty_pipes[j][i]->set_stopped(true);
                     }
@@ -607,221 +540,112 @@ void check_empty_pipe_block_collisions(vector<vector<shared_ptr<EmptyPipeBlock>>
     }
 }
 
-void check_water_empty_block_collisions(vector<vector<shared_ptr<EmptyPipeBlock>>> empty_pipes, vector<vector<shared_ptr<WaterBlock>>> water)
+void check_water_empty_block_collisions(water_network &network)
 {
-    string collision = "None";
-    for (int i = 0; i < empty_pipes.size(); i++)
+    for (int i = 0; i < network.empty_water.size(); i++)
     {
-        for (int j = 0; j < empty_pipes[i].size(); j++)
+        shared_ptr<EmptyPipeBlock> empty_pipe = network.empty_water[i].first;
+        shared_ptr<WaterBlock> water = network.empty_water[i].second;
+        if (!water->get_is_flowing())
+            continue;
+
+        if (!empty_pipe->get_is_stopped())
         {
-            // Found Empty Space
-            for (int k = 0; k < water.size(); k++)
-            {
-                for (int l = 0; l < water[k].size(); l++)
-                {
-                    // Found Water Block
-                    if (water[k][l]->get_is_flowing())
-                    {
-                        if (empty_pipes[i][j]->test_collision(water[k][l]->get_block_hitbox()) != "None" && !empty_pipes[i][j]->get_is_stopped())
-                        {
-                            water[k][l]->set_stopped(false);
-                        }
-                        else if (empty_pipes[i][j]->test_collision(water[k][l]->get_block_hitbox()) != "None" && empty_pipes[i][j]->get_is_stopped())
-                        {
-                            water[k][l]->set_stopped(true);
-                            water[k][l]->set_flowing(false);
-                        }
-                    }
-                    else
-                        continue;
-                }
-            }
+            water->set_stopped(false);
+        }
+        else
+        {
+            water->set_stopped(true);
+            water->set_flowing(false);
         }
     }
 }
 
-void check_water_empty_turn_block_collisions(vector<vector<shared_ptr<EmptyTurnBlock>>> empty_pipes, vector<vector<shared_ptr<WaterBlock>>> water)
+void check_water_empty_turn_block_collisions(water_network &network)
 {
-    string collision = "None";
-    for (int i = 0; i < empty_pipes.size(); i++)
+    for (int i = 0; i < network.empty_turn_water.size(); i++)
     {
-        for (int j = 0; j < empty_pipes[i].size(); j++)
-        {
-            // Found Empty Space
-            for (int k = 0; k < water.size(); k++)
-            {
-                for (int l = 0; l < water[k].size(); l++)
-                {
-                    // Found Water Block
-                    if (water[k][l]->get_is_flowing())
-                    {
-                        if (empty_pipes[i][j]->test_collision(water[k][l]->get_block_hitbox()) != "None")
-                        {
-                            if (empty_pipes[i][j]->get_is_flowing())
-                                water[k][l]->set_stopped(false);
-                            else
-                                water[k][l]->set_stopped(true);
-                        }
-                        else
-                            continue;
-                    }
-                    else
-                        continue;
-                }
-            }
-        }
+        shared_ptr<WaterBlock> water = network.empty_turn_water[i].second;
+        if (!water->get_is_flowing())
+            continue;
+
+        if (network.empty_turn_water[i].first->get_is_flowing())
+            water->set_stopped(false);
+        else
+            water->set_stopped(true);
     }
 }
 
-void check_water_empty_multi_turn_block_collisions(vector<vector<shared_ptr<EmptyMultiTurnBlock>>> empty_pipes, vector<vector<shared_ptr<WaterBlock>>> water)
+void check_water_empty_multi_turn_block_collisions(water_network &network)
 {
-    string collision = "None";
-    for (int i = 0; i < empty_pipes.size(); i++)
+    for (int i = 0; i < network.empty_multi_water.size(); i++)
     {
-        for (int j = 0; j < empty_pipes[i].size(); j++)
-        {
-            // Found Empty Space
-            for (int k = 0; k < water.size(); k++)
-            {
-                for (int l = 0; l < water[k].size(); l++)
-                {
-                    // Found Water Block
-                    if (empty_pipes[i][j]->test_collision(water[k][l]->get_block_hitbox()) != "None")
-                    {
-                        if (empty_pipes[i][j]->get_is_flowing())
-                        {
-                            water[k][l]->set_stopped(false);
-                        }
-                        else
-                        {
-                            water[k][l]->set_stopped(true);
-                        }
-                    }
-                    else
-                        continue;
-                }
-            }
-        }
+        if (network.empty_multi_water[i].first->get_is_flowing())
+            network.empty_multi_water[i].second->set_stopped(false);
+        else
+            network.empty_multi_water[i].second->set_stopped(true);
     }
 }
 
-void check_water_water_block_collisions(vector<vector<shared_ptr<WaterBlock>>> water, vector<vector<shared_ptr<WaterBlock>>> water2)
+void check_water_water_block_collisions(water_network &network)
 {
-    string collision = "None";
-    for (int i = 0; i < water.size(); i++)
+    for (int i = 0; i < network.water_below.size(); i++)
     {
-        for (int j = 0; j < water[i].size(); j++)
+        shared_ptr<WaterBlock> above = network.water_below[i].first;
+        shared_ptr<WaterBlock> below = network.water_below[i].second;
+
+        // Flowing water starts the water under it, stopped water stops it
+        if (above->get_is_flowing())
         {
-            if (water[i][j]->get_is_flowing())
-            {
-                // Found flowing block
-                for (int k = 0; k < water2.size(); k++)
-                {
-                    for (int l = 0; l < water2[k].size(); l++)
-                    {
-                        // Found Water Block
-                        if (!water[k][l]->get_is_flowing())
-                        {
-                            if (water[i][j]->test_collision(water2[k][l]->get_block_hitbox()) == "Bottom")
-                            {
-                                water2[k][l]->set_stopped(false);
-                            }
-                        }
-                    }
-                }
-            }
-            else
-            {
-                for (int k = 0; k < water2.size(); k++)
-                {
-                    for (int l = 0; l < water2[k].size(); l++)
-                    {
-                        if (water[i][j]->test_collision(water2[k][l]->get_block_hitbox()) == "Bottom")
-                            water2[k][l]->set_stopped(true);
-                    }
-                }
-            }
+            if (!below->get_is_flowing())
+                below->set_stopped(false);
         }
+        else
+            below->set_stopped(true);
     }
 }
 
-void check_turn_empty_pipes(vector<vector<shared_ptr<TurnablePipeBlock>>> turn_pipes, vector<vector<shared_ptr<EmptyTurnBlock>>> empty_blocks)
+void check_turn_empty_pipes(water_network &network)
 {
-    string collision = "None";
-    for (int i = 0; i < turn_pipes.size(); i++)
-    {
-        for (int j = 0; j < turn_pipes[i].size(); j++)
-        {
-            for (int k = 0; k < empty_blocks.size(); k++)
-            {
-                for (int l = 0; l < empty_blocks[k].size(); l++)
-                {
-                    if (turn_pipes[i][j]->get_cell() == empty_blocks[k][l]->get_cell())
-                    {
-                        if (!turn_pipes[i][j]->get_turnable())
-                            empty_blocks[k][l]->set_flowing(false);
-                    }
-                    else
-                        continue;
-                }
-            }
-        }
-    }
+    for (int i = 0; i < network.turn_empty.size(); i++)
+        if (!network.turn_empty[i].first->get_turnable())
+            network.turn_empty[i].second->set_flowing(false);
 }
 
-void check_turn_multi_empty_pipes(vector<vector<shared_ptr<MultiTurnablePipeBlock>>> turn_pipes, vector<vector<shared_ptr<EmptyMultiTurnBlock>>> empty_blocks)
+void check_turn_multi_empty_pipes(water_network &network)
 {
-    string collision = "None";
-    for (int i = 0; i < turn_pipes.size(); i++)
+    for (int i = 0; i < network.multi_empty.size(); i++)
     {
-        for (int j = 0; j < turn_pipes[i].size(); j++)
-        {
-            for (int k = 0; k < empty_blocks.size(); k++)
-            {
-                for (int l = 0; l < empty_blocks[k].size(); l++)
-                {
-                    if (turn_pipes[i][j]->get_cell() == empty_blocks[k][l]->get_cell())
-                    {
-                        if (!turn_pipes[i][j]->get_turnable())
-                            empty_blocks[k][l]->set_flowing(false);
-                        else
-                            empty_blocks[k][l]->set_flowing(true);
-                    }
-                    else if (turn_pipes[i][j]->get_cell() + 6 == empty_blocks[k][l]->get_cell())
-                    {
-                        if (turn_pipes[i][j]->get_turnable())
-                            empty_blocks[k][l]->set_flowing(false);
-                        else
-                            empty_blocks[k][l]->set_flowing(true);
-                    }
-                    else
-                        continue;
-                }
-            }
-        }
+        bool turned = !network.multi_empty[i].first->get_turnable();
+        if (network.multi_empty_opposite[i])
+            network.multi_empty[i].second->set_flowing(turned);
+        else
+            network.multi_empty[i].second->set_flowing(!turned);
     }
 }
 
-void check_collectable_collisions(vector<vector<shared_ptr<Collectable>>> collect, vector<shared_ptr<Player>> level_players)
+void check_collectable_collisions(vector<shared_ptr<Player>> level_players, vector<player_contacts> &contacts)
 {
     for (int k = 0; k < level_players.size(); k++)
     {
         string collision = "None";
-        for (int j = 0; j < collect.size(); j++)
+        vector<shared_ptr<Collectable>> &nearby = contacts[k].collectables;
+        for (int i = 0; i < nearby.size(); i++)
         {
-            for (int i = 0; i < collect[j].size(); i++)
-            {
-                if (!rect_on_screen(collect[j][i]->get_hitbox()))
-                    continue;
+            if (!rect_in_view(nearby[i]->get_hitbox()))
+                continue;
 
-                if (!collect[j][i]->get_collected())
-                    collision = collect[j][i]->collision(level_players[k]->get_player_hitbox());
+            if (!nearby[i]->get_collected())
+                collision = contacts[k].collectable_hits.at(0, i);
 
-                if (collision != "None")
-                {
-                    collect[j][i]->set_collected(true);
-                    collect[j][i]->effect(level_players[k]);
-                }
+            if (collision != "None")
+            {
+                nearby[i]->set_collected(true);
+                nearby[i]->effect(level_players[k]);
+
+                // Effects that can't be used yet leave the collectable where it is
+                if (nearby[i]->get_collected())
+                    level_players[k]->add_score(SCORE_COLLECTABLE);
             }
         }
     }
@@ -0,0 +1,237 @@
+#include "splashkit.h"
+#include "block.h"
+#include "aabbbatch.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// Included once through map.h, only held by pointer here
+class Collectable;
+
+// Enemies each edge detection job looks at
+#define EDGE_ENEMIES_PER_JOB 32
+
+// What a collision test returned, small enough to keep one per contact
+enum contact_side : unsigned char
+{
+    CONTACT_NONE,
+    CONTACT_HIT,
+    CONTACT_LEFT,
+    CONTACT_RIGHT,
+    CONTACT_TOP,
+    CONTACT_BOTTOM
+};
+
+contact_side to_contact_side(const string &collision)
+{
+    if (collision == "Collision")
+        return CONTACT_HIT;
+    if (collision == "Left")
+        return CONTACT_LEFT;
+    if (collision == "Right")
+        return CONTACT_RIGHT;
+    if (collision == "Top")
+        return CONTACT_TOP;
+    if (collision == "Bottom")
+        return CONTACT_BOTTOM;
+    return CONTACT_NONE;
+}
+
+// Back to what the collision test would have said
+string contact_side_name(contact_side side)
+{
+    switch (side)
+    {
+        case CONTACT_HIT:
+            return "Collision";
+        case CONTACT_LEFT:
+            return "Left";
+        case CONTACT_RIGHT:
+            return "Right";
+        case CONTACT_TOP:
+            return "Top";
+        case CONTACT_BOTTOM:
+            return "Bottom";
+        default:
+            return "None";
+    }
+}
+
+struct contact
+{
+    int layer;
+    int index;
+    contact_side side;
+};
+
+// The blocks of a set of layers one hitbox touches, in layer then index order. Lookups are meant
+// to walk the layers in the same order, each one carries on from where the last left off.
+class ContactList
+{
+    private:
+        vector<contact> contacts;
+        int cursor = 0;
+
+        static bool before(const contact &one, int layer, int index)
+        {
+            return one.layer < layer || (one.layer == layer && one.index < index);
+        };
+
+    public:
+        ContactList(){};
+
+        ~ContactList(){};
+
+        void clear()
+        {
+            contacts.clear();
+            cursor = 0;
+        };
+
+        void add(int layer, int index, contact_side side)
+        {
+            contact found;
+            found.layer = layer;
+            found.index = index;
+            found.side = side;
+            contacts.push_back(found);
+        };
+
+        // What testing the block would have returned
+        string at(int layer, int index)
+        {
+            if (cursor > 0 && !before(contacts[cursor - 1], layer, index))
+                cursor = 0;
+
+            while (cursor < contacts.size() && before(contacts[cursor], layer, index))
+                cursor += 1;
+
+            if (cursor < contacts.size() && contacts[cursor].layer == layer && contacts[cursor].index == index)
+                return contact_side_name(contacts[cursor].side);
+            return "None";
+        };
+
+        int size()
+        {
+            return this->contacts.size();
+        };
+};
+
+// Everything one player touches this frame, found by a detection job and used by the responses
+struct player_contacts
+{
+    ContactList ladders;
+    ContactList hold_pipes;
+    ContactList turn_pipes;
+    ContactList empty_pipes;
+    ContactList multi_pipes;
+    ContactList water;
+    string door = "None";
+    vector<uint64_t> toxic;
+    vector<int> enemies;
+    vector<shared_ptr<Collectable>> collectables;
+    ContactList collectable_hits; // By place in collectables
+};
+
+// Tests a hitbox against every block of the layers. Only reads, so any number can run at once.
+template <typename T>
+void detect_layer_contacts(vector<vector<shared_ptr<T>>> &layers, rectangle hitbox, ContactList &contacts)
+{
+    contacts.clear();
+    for (int j = 0; j < layers.size(); j++)
+        for (int i = 0; i < layers[j].size(); i++)
+        {
+            contact_side side = to_contact_side(layers[j][i]->test_collision(hitbox));
+            if (side != CONTACT_NONE)
+                contacts.add(j, i, side);
+        }
+}
+
+// Same, against the blocks' bigger hitbox for placing pipes
+template <typename T>
+void detect_special_contacts(vector<vector<shared_ptr<T>>> &layers, rectangle hitbox, ContactList &contacts)
+{
+    contacts.clear();
+    for (int j = 0; j < layers.size(); j++)
+        for (int i = 0; i < layers[j].size(); i++)
+        {
+            contact_side side = to_contact_side(layers[j][i]->special_collision(hitbox));
+            if (side != CONTACT_NONE)
+                contacts.add(j, i, side);
+        }
+}
+
+// Which blocks of the water network touch which. None of them ever move, so the pairs are worked
+// out once when the level is built and each frame only applies them, in the order the blocks
+// used to be tested in.
+struct water_network
+{
+    vector<pair<shared_ptr<WaterBlock>, shared_ptr<WaterBlock>>> water_below; // Second sits at the bottom of the first
+    vector<pair<shared_ptr<EmptyPipeBlock>, shared_ptr<WaterBlock>>> empty_water;
+    vector<pair<shared_ptr<EmptyTurnBlock>, shared_ptr<WaterBlock>>> empty_turn_water;
+    vector<pair<shared_ptr<EmptyMultiTurnBlock>, shared_ptr<WaterBlock>>> empty_multi_water;
+    vector<pair<shared_ptr<TurnablePipeBlock>, shared_ptr<EmptyTurnBlock>>> turn_empty;
+    vector<pair<shared_ptr<MultiTurnablePipeBlock>, shared_ptr<EmptyMultiTurnBlock>>> multi_empty;
+    vector<unsigned char> multi_empty_opposite; // The empty block flows once the pipe is turned, not until
+};
+
+// Every water block overlapping each of the empty blocks
+template <typename T>
+void find_empty_water(vector<vector<shared_ptr<T>>> &empty_blocks, RectBatch &water_bounds, vector<shared_ptr<WaterBlock>> &water, vector<pair<shared_ptr<T>, shared_ptr<WaterBlock>>> &pairs)
+{
+    vector<uint64_t> overlaps;
+    for (int i = 0; i < empty_blocks.size(); i++)
+        for (int j = 0; j < empty_blocks[i].size(); j++)
+        {
+            aabb_overlap(empty_blocks[i][j]->get_block_hitbox(), water_bounds, overlaps);
+            for (int k = aabb_next_overlap(overlaps, 0); k >= 0; k = aabb_next_overlap(overlaps, k + 1))
+                pairs.push_back(make_pair(empty_blocks[i][j], water[k]));
+        }
+}
+
+water_network build_water_network(vector<vector<shared_ptr<WaterBlock>>> &water, RectBatch &water_bounds, vector<shared_ptr<WaterBlock>> &water_list,
+                                  vector<vector<shared_ptr<EmptyPipeBlock>>> &empty_pipes, vector<vector<shared_ptr<TurnablePipeBlock>>> &turn_pipes,
+                                  vector<vector<shared_ptr<EmptyTurnBlock>>> &empty_turn_pipes, vector<vector<shared_ptr<MultiTurnablePipeBlock>>> &multi_turn_pipes,
+                                  vector<vector<shared_ptr<EmptyMultiTurnBlock>>> &empty_multi_turn_pipes)
+{
+    water_network network;
+
+    for (int i = 0; i < water.size(); i++)
+        for (int j = 0; j < water[i].size(); j++)
+            for (int k = 0; k < water.size(); k++)
+                for (int l = 0; l < water[k].size(); l++)
+                    if (water[i][j]->test_collision(water[k][l]->get_block_hitbox()) == "Bottom")
+                        network.water_below.push_back(make_pair(water[i][j], water[k][l]));
+
+    find_empty_water(empty_pipes, water_bounds, water_list, network.empty_water);
+    find_empty_water(empty_turn_pipes, water_bounds, water_list, network.empty_turn_water);
+    find_empty_water(empty_multi_turn_pipes, water_bounds, water_list, network.empty_multi_water);
+
+    for (int i = 0; i < turn_pipes.size(); i++)
+        for (int j = 0; j < turn_pipes[i].size(); j++)
+            for (int k = 0; k < empty_turn_pipes.size(); k++)
+                for (int l = 0; l < empty_turn_pipes[k].size(); l++)
+                    if (turn_pipes[i][j]->get_cell() == empty_turn_pipes[k][l]->get_cell())
+                        network.turn_empty.push_back(make_pair(turn_pipes[i][j], empty_turn_pipes[k][l]));
+
+    for (int i = 0; i < multi_turn_pipes.size(); i++)
+        for (int j = 0; j < multi_turn_pipes[i].size(); j++)
+            for (int k = 0; k < empty_multi_turn_pipes.size(); k++)
+                for (int l = 0; l < empty_multi_turn_pipes[k].size(); l++)
+                {
+                    int pipe_cell = multi_turn_pipes[i][j]->get_cell();
+                    int empty_cell = empty_multi_turn_pipes[k][l]->get_cell();
+                    if (pipe_cell != empty_cell && pipe_cell + 6 != empty_cell)
+                        continue;
+
+                    network.multi_empty.push_back(make_pair(multi_turn_pipes[i][j], empty_multi_turn_pipes[k][l]));
+                    network.multi_empty_opposite.push_back(pipe_cell != empty_cell);
+                }
+
+    return network;
+}
@@ -1,219 +1,566 @@
 #include "splashkit.h"
 #include "behaviour.h"
+#include "tilegrid.h"
+#include "spatialhash.h"
+#include "navigation.h"
+#include "renderqueue.h"
+#include "sweep.h"
 #include <memory>
+#include <vector>
+#include <utility>
 
 #pragma once
 
-class Enemy
+using namespace std;
+
+// Copy of every enemy array, taken by value so restoring is a straight copy back
+struct enemy_snapshot
 {
-    protected:
-        sprite enemy_sprite;
-        point_2d position;
-        rectangle hitbox;
-        bool is_dead;
-        int hp; // Can set HP on any enemy if you choose to. Only set value at child class.
-        std::shared_ptr<Behaviour> ai;
-        vector<std::shared_ptr<Player>> level_players;
+    vector<sprite> sprites;
+    vector<double> x;
+    vector<double> y;
+    vector<double> dx;
+    vector<double> dy;
+    vector<double> width;
+    vector<double> height;
+    vector<rectangle> hitbox;
+    vector<int> hp;
+    vector<unsigned char> facing_left;
+    vector<unsigned char> on_floor;
+    vector<unsigned char> restart_animation;
+    vector<int> animation_ticks;
+    vector<unsigned char> type;
+    vector<int> id;
+    vector<int> last_tick;
+    vector<int> target_player;
+    int type_end[ENEMY_TYPE_COUNT];
+    vector<int> index_of_id;
+    SpatialHash<int> grid;
+};
 
-    public:
-        Enemy(sprite enemy_sprite, point_2d position, vector<std::shared_ptr<Player>> level_players)
+// All of a level's enemies, one array per property. Enemies of the same type sit next to each
+// other so each behaviour is one pass over a block of the arrays, and a dead enemy is swapped
+// out of its block and popped off the end.
+//
+// Gameplay code refers to enemies by id. Ids never change, indexes do whenever one is removed.
+class EnemySystem
+{
+    private:
+        vector<sprite> sprites;
+        vector<double> x;
+        vector<double> y;
+        vector<double> dx;
+        vector<double> dy;
+        vector<double> width;
+        vector<double> height;
+        vector<rectangle> hitbox;
+        vector<int> hp;
+        vector<unsigned char> facing_left;
+        vector<unsigned char> on_floor;
+        vector<unsigned char> restart_animation;
+        // Animation steps since it was started or replayed, so a snapshot can pick it up part way
+        vector<int> animation_ticks;
+        vector<unsigned char> type;
+        vector<int> id;
+        vector<int> last_tick;
+        vector<int> target_player;
+
+        // Type t lives in [type_begin(t), type_end[t])
+        int type_end[ENEMY_TYPE_COUNT];
+        vector<int> index_of_id;
+        vector<enemy_kind> kinds;
+        // Every sprite ever spawned. Killed enemies keep theirs so a snapshot can bring them back.
+        vector<sprite> owned_sprites;
+
+        // Ids go into the grid in spawn order, so an enemy's grid handle is its id
+        SpatialHash<int> grid;
+        Navigation *navigation = nullptr;
+        SpatialHash<rectangle> *solids = nullptr;
+
+        void swap_entries(int a, int b)
+        {
+            if (a == b)
+                return;
+
+            std::swap(sprites[a], sprites[b]);
+            std::swap(x[a], x[b]);
+            std::swap(y[a], y[b]);
+            std::swap(dx[a], dx[b]);
+            std::swap(dy[a], dy[b]);
+            std::swap(width[a], width[b]);
+            std::swap(height[a], height[b]);
+            std::swap(hitbox[a], hitbox[b]);
+            std::swap(hp[a], hp[b]);
+            std::swap(facing_left[a], facing_left[b]);
+            std::swap(on_floor[a], on_floor[b]);
+            std::swap(restart_animation[a], restart_animation[b]);
+            std::swap(animation_ticks[a], animation_ticks[b]);
+            std::swap(type[a], type[b]);
+            std::swap(id[a], id[b]);
+            std::swap(last_tick[a], last_tick[b]);
+            std::swap(target_player[a], target_player[b]);
+
+            index_of_id[id[a]] = a;
+            index_of_id[id[b]] = b;
+        };
+
+        void pop_entry()
+        {
+            sprites.pop_back();
+            x.pop_back();
+            y.pop_back();
+            dx.pop_back();
+            dy.pop_back();
+            width.pop_back();
+            height.pop_back();
+            hitbox.pop_back();
+            hp.pop_back();
+            facing_left.pop_back();
+            on_floor.pop_back();
+            restart_animation.pop_back();
+            animation_ticks.pop_back();
+            type.pop_back();
+            id.pop_back();
+            last_tick.pop_back();
+            target_player.pop_back();
+        };
+
+        void update_hitbox(int i)
         {
-            this->is_dead = false;
-            this->hp = 0;
-            this->enemy_sprite = enemy_sprite;
-            this->position = position;
-            this->level_players = level_players;
-            sprite_set_position(enemy_sprite, this->position);
-            make_hitbox();
+            hitbox[i].x = x[i];
+            hitbox[i].y = y[i] + 10;
+            hitbox[i].width = width[i];
+            hitbox[i].height = height[i] - 10;
         };
 
-        ~Enemy(){};
+        point_2d feet(int i)
+        {
+            return point_at(x[i] + width[i] / 2, y[i] + height[i]);
+        };
+
+        void start_animation(int i)
+        {
+            if (facing_left[i])
+                sprite_start_animation(sprites[i], "LeftRun");
+            else
+                sprite_start_animation(sprites[i], "RightRun");
+            restart_animation[i] = false;
+            animation_ticks[i] = 0;
+        };
 
-        virtual void update()
+        // Full simulation of one enemy, the camera can see it
+        void update_one(int i, bool chases)
         {
-            if(!is_dead)
+            if (chases)
             {
-                if(rect_on_screen(hitbox))
+                bool facing = steer_enemy_to_target(navigation, target_player[i], feet(i), facing_left[i]);
+                if (facing != facing_left[i])
                 {
-                    ai->update();
-                    draw_sprite(enemy_sprite);
-                    if(sprite_animation_has_ended(enemy_sprite))
-                        sprite_replay_animation(enemy_sprite);
-                    update_sprite(enemy_sprite);
-                    update_hitbox();
+                    facing_left[i] = facing;
+                    restart_animation[i] = true;
                 }
             }
+
+            if (restart_animation[i])
+                start_animation(i);
+
+            dx[i] = enemy_walk_dx(facing_left[i], kinds[type[i]].walk_speed);
+            dy[i] = on_floor[i] ? 0 : ENEMY_FALL_SPEED;
+
+            sprite_set_position(sprites[i], point_at(x[i], y[i]));
+            submit_sprite(sprites[i]);
+            if (sprite_animation_has_ended(sprites[i]))
+            {
+                sprite_replay_animation(sprites[i]);
+                animation_ticks[i] = 0;
+            }
+            animation_ticks[i] += 1;
+            update_sprite_animation(sprites[i]);
+
+            move(i);
+            grid.update(id[i], hitbox[i]);
         };
 
-        void make_hitbox()
+        // Sweeps the enemy's hitbox through the solid blocks. Walls turn it around.
+        void move(int i)
         {
-            rectangle hitbox;
-            hitbox.x = this->position.x;
-            hitbox.y = this->position.y + 10;
-            hitbox.height = sprite_height(this->enemy_sprite) - 10;
-            hitbox.width = sprite_width(this->enemy_sprite);
-            this->hitbox = hitbox;
+            if (solids == nullptr)
+            {
+                x[i] += dx[i];
+                y[i] += dy[i];
+                update_hitbox(i);
+                return;
+            }
+
+            sweep_result result = sweep_box(hitbox[i], dx[i], dy[i], *solids);
+            x[i] = result.box.x;
+            y[i] = result.box.y - 10;
+            update_hitbox(i);
+
+            on_floor[i] = result.on_floor;
+            if (result.hit_right)
+            {
+                facing_left[i] = false;
+                restart_animation[i] = true;
+            }
+            else if (result.hit_left)
+            {
+                facing_left[i] = true;
+                restart_animation[i] = true;
+            }
         };
 
-        void update_hitbox()
+    public:
+        EnemySystem()
         {
-            point_2d current_position = sprite_position(this->enemy_sprite);
-            this->hitbox.x = current_position.x;
-            this->hitbox.y = current_position.y + 10;
+            for (int t = 0; t < ENEMY_TYPE_COUNT; t++)
+            {
+                type_end[t] = 0;
+                kinds.push_back(get_enemy_kind(t));
+            }
         };
 
-        rectangle get_enemy_hitbox()
+        ~EnemySystem()
         {
-            return this->hitbox;
+            for (int i = 0; i < owned_sprites.size(); i++)
+                free_sprite(owned_sprites[i]);
         };
 
-        std::shared_ptr<Behaviour> get_ai()
+        // Sprites are owned here, so there is only ever one copy
+        EnemySystem(const EnemySystem &) = delete;
+        EnemySystem &operator=(const EnemySystem &) = delete;
+
+        // Adds an enemy standing in the tile at position and returns its id
+        int spawn(enemy_type enemy, point_2d position, bool facing)
         {
-            return this->ai;
+            const enemy_kind &kind = kinds[enemy];
+            sprite new_sprite = create_sprite(asset_bitmap(kind.bitmap_name), asset_animation(kind.animation_name));
+
+            int new_id = index_of_id.size();
+            owned_sprites.push_back(new_sprite);
+            sprites.push_back(new_sprite);
+            x.push_back(position.x);
+            y.push_back(position.y + 32);
+            dx.push_back(0);
+            dy.push_back(0);
+            width.push_back(sprite_width(new_sprite));
+            height.push_back(sprite_height(new_sprite));
+            hitbox.push_back(rectangle());
+            hp.push_back(kind.hp);
+            facing_left.push_back(facing);
+            on_floor.push_back(true);
+            restart_animation.push_back(true);
+            animation_ticks.push_back(0);
+            type.push_back(enemy);
+            id.push_back(new_id);
+            last_tick.push_back(0);
+            target_player.push_back(-1);
+            index_of_id.push_back(sprites.size() - 1);
+
+            int i = sprites.size() - 1;
+            update_hitbox(i);
+            start_animation(i);
+            grid.insert(new_id, hitbox[i]);
+
+            // Walk the new entry back to the end of its type's block
+            for (int t = ENEMY_TYPE_COUNT - 1; t > enemy; t--)
+            {
+                int first = type_begin(t);
+                swap_entries(i, first);
+                i = first;
+                type_end[t] += 1;
+            }
+            type_end[enemy] += 1;
+
+            return new_id;
         };
 
-        sprite get_enemy_sprite()
+        // Removes a dead enemy, the last enemy of each later type fills the gap
+        void kill(int enemy_id)
         {
-            return this->enemy_sprite;
+            if (!alive(enemy_id))
+                return;
+
+            int i = index_of_id[enemy_id];
+            int t = type[i];
+
+            int hole = type_end[t] - 1;
+            swap_entries(i, hole);
+            type_end[t] -= 1;
+
+            for (int u = t + 1; u < ENEMY_TYPE_COUNT; u++)
+            {
+                int last = type_end[u] - 1;
+                swap_entries(hole, last);
+                hole = last;
+                type_end[u] -= 1;
+            }
+
+            grid.remove(enemy_id);
+            index_of_id[enemy_id] = -1;
+            pop_entry();
         };
 
-        void set_dead(bool new_value)
+        void save_state(enemy_snapshot &snapshot)
         {
-            this->is_dead = new_value;
+            snapshot.sprites = sprites;
+            snapshot.x = x;
+            snapshot.y = y;
+            snapshot.dx = dx;
+            snapshot.dy = dy;
+            snapshot.width = width;
+            snapshot.height = height;
+            snapshot.hitbox = hitbox;
+            snapshot.hp = hp;
+            snapshot.facing_left = facing_left;
+            snapshot.on_floor = on_floor;
+            snapshot.restart_animation = restart_animation;
+            snapshot.animation_ticks = animation_ticks;
+            snapshot.type = type;
+            snapshot.id = id;
+            snapshot.last_tick = last_tick;
+            snapshot.target_player = target_player;
+            for (int t = 0; t < ENEMY_TYPE_COUNT; t++)
+                snapshot.type_end[t] = type_end[t];
+            snapshot.index_of_id = index_of_id;
+            snapshot.grid = grid;
         };
 
-        bool get_dead()
+        // Puts every enemy back where the snapshot had it, killed ones included. The vectors
+        // keep their storage so this is a copy into memory that is already there.
+        void restore_state(const enemy_snapshot &snapshot)
         {
-            return this->is_dead;
+            sprites = snapshot.sprites;
+            x = snapshot.x;
+            y = snapshot.y;
+            dx = snapshot.dx;
+            dy = snapshot.dy;
+            width = snapshot.width;
+            height = snapshot.height;
+            hitbox = snapshot.hitbox;
+            hp = snapshot.hp;
+            facing_left = snapshot.facing_left;
+            on_floor = snapshot.on_floor;
+            type = snapshot.type;
+            id = snapshot.id;
+            last_tick = snapshot.last_tick;
+            target_player = snapshot.target_player;
+            for (int t = 0; t < ENEMY_TYPE_COUNT; t++)
+                type_end[t] = snapshot.type_end[t];
+            index_of_id = snapshot.index_of_id;
+            grid = snapshot.grid;
+
+            restart_animation = snapshot.restart_animation;
+            animation_ticks = snapshot.animation_ticks;
+            for (int i = 0; i < sprites.size(); i++)
+            {
+                sprite_set_position(sprites[i], point_at(x[i], y[i]));
+
+                // Stepped back to the same frame of the same animation, never more than its length
+                if (restart_animation[i])
+                    continue;
+                start_animation(i);
+                for (int step = 0; step < snapshot.animation_ticks[i]; step++)
+                    update_sprite_animation(sprites[i]);
+                animation_ticks[i] = snapshot.animation_ticks[i];
+            }
         };
 
-        // Returns current enemy hp.
-        int get_hp()
+        int type_begin(int t)
         {
-            return this->hp;
-        }
+            if (t == 0)
+                return 0;
+            return type_end[t - 1];
+        };
 
-        // Decrements enemy hp. 
-        void take_damage(int decrement)
+        bool alive(int enemy_id)
         {
-            this->hp -= decrement;
-        }
+            return enemy_id >= 0 && enemy_id < index_of_id.size() && index_of_id[enemy_id] >= 0;
+        };
 
-        string test_collision(rectangle one)
+        int size()
         {
-            string collision = "None";
-            double dx = (one.x + one.width/2) - (this->hitbox.x + this->hitbox.width/2);
-            double dy = (one.y + one.height/2) - (this->hitbox.y + this->hitbox.height/2);
-            double width = (one.width + this->hitbox.width)/2;
-            double height = (one.height + this->hitbox.height)/2;
-            double crossWidth = width * dy;
-            double crossHeight = height * dx;
+            return this->sprites.size();
+        };
 
-            if(abs(dx) <= width && abs(dy) <= height)
+        int id_at(int index)
+        {
+            return this->id[index];
+        };
+
+        void set_navigation(Navigation *navigation)
+        {
+            this->navigation = navigation;
+        };
+
+        void set_solids(SpatialHash<rectangle> *solids)
+        {
+            this->solids = solids;
+        };
+
+        // Ids of every live enemy whose hitbox touches the area, in spawn order
+        vector<int> query_rect(rectangle area)
+        {
+            return grid.query_rect(area);
+        };
+
+        // Full update for the enemies the camera can see. Indexes are sorted so each
+        // type's block is walked in one go with its behaviour fixed for the whole pass.
+        void update(vector<int> &ids)
+        {
+            vector<int> indexes;
+            indexes.reserve(ids.size());
+            for (int k = 0; k < ids.size(); k++)
+                if (alive(ids[k]))
+                    indexes.push_back(index_of_id[ids[k]]);
+            sort(indexes.begin(), indexes.end());
+
+            int k = 0;
+            for (int t = 0; t < ENEMY_TYPE_COUNT; t++)
             {
-                if(crossWidth>=crossHeight)
+                bool chases = kinds[t].chases_players;
+                int end = type_end[t];
+                for (; k < indexes.size() && indexes[k] < end; k++)
+                    update_one(indexes[k], chases);
+            }
+        };
+
+        // Cheap movement for enemies the player can't see. Walks along the tile grid,
+        // turns at walls and edges and falls off ledges without animating or drawing.
+        void patrol(int enemy_id, TileGrid &tile_grid, int frames)
+        {
+            if (!alive(enemy_id))
+                return;
+
+            int i = index_of_id[enemy_id];
+            int tile_size = tile_grid.get_tile_size();
+            double walk_speed = kinds[type[i]].walk_speed;
+
+            for (int step = 0; step < frames; step++)
+            {
+                double bottom = y[i] + height[i];
+                int below_row = tile_grid.row_of(bottom);
+                int body_row = tile_grid.row_of(bottom - 1);
+                bool supported = tile_grid.has(tile_grid.column_of(x[i]), below_row, TILE_SOLID) || tile_grid.has(tile_grid.column_of(x[i] + width[i] - 1), below_row, TILE_SOLID);
+
+                if (!supported)
                 {
-                    if(crossWidth > (-crossHeight))
-                        collision = "Bottom";
-                    else
-                        collision = "Left";
+                    on_floor[i] = false;
+                    y[i] += ENEMY_FALL_SPEED;
+
+                    // Landed inside the next floor, stand on top of it
+                    int landed_row = tile_grid.row_of(y[i] + height[i]);
+                    if (landed_row != below_row && (tile_grid.has(tile_grid.column_of(x[i]), landed_row, TILE_SOLID) || tile_grid.has(tile_grid.column_of(x[i] + width[i] - 1), landed_row, TILE_SOLID)))
+                        y[i] = landed_row * tile_size - height[i];
+                    continue;
                 }
-                else
+
+                on_floor[i] = true;
+                double step_dx = enemy_walk_dx(facing_left[i], walk_speed);
+                double next_x = x[i] + step_dx;
+                int lead_col = step_dx > 0 ? tile_grid.column_of(next_x + width[i] - 1) : tile_grid.column_of(next_x);
+
+                if (tile_grid.has(lead_col, body_row, TILE_SOLID | TILE_EDGE))
                 {
-                    //Bias so player has a better chance of hitting them while above
-                    if(crossWidth - 200 > -(crossHeight))
-                        collision = "Right";
-                    else
-                        collision = "Top";
+                    facing_left[i] = !facing_left[i];
+                    restart_animation[i] = true;
                 }
+                else
+                    x[i] = next_x;
             }
 
-            return collision;
+            update_hitbox(i);
+            grid.update(enemy_id, hitbox[i]);
         };
-};
 
-class Roach : public Enemy
-{
-    public:
-        Roach(sprite enemy_sprite, point_2d position, vector<std::shared_ptr<Player>> level_players) : Enemy (enemy_sprite, position, level_players)
+        bool wants_to_think(int enemy_id)
         {
-            std::shared_ptr<Behaviour> ai(new RoachBehaviour(enemy_sprite));
-            this->ai = ai;
-            point_2d pos = this->position;
-            pos.y = pos.y + 32;
-            sprite_set_position(enemy_sprite, pos);
-            
-            make_hitbox();
+            return alive(enemy_id) && kinds[type[index_of_id[enemy_id]]].chases_players;
         };
 
-        ~Roach(){};
-};
-
-class Blob : public Enemy
-{
-    public:
-        Blob(sprite enemy_sprite, point_2d position, vector<std::shared_ptr<Player>> level_players) : Enemy (enemy_sprite, position, level_players)
+        // Expensive decisions, run by the AI scheduler every few frames
+        void think(int enemy_id, vector<std::shared_ptr<Player>> &level_players)
         {
-            std::shared_ptr<Behaviour> ai(new BlobBehaviour(enemy_sprite));
-            this->ai = ai;
-            this->hp = 3; // Blob has 3 hit points. If blob gets jumped on 3 times. It dies.
-            point_2d pos = this->position;
-            pos.y = pos.y + 32;
-            sprite_set_position(enemy_sprite, pos);
+            if (!alive(enemy_id))
+                return;
 
-            make_hitbox();
+            int i = index_of_id[enemy_id];
+            target_player[i] = select_enemy_target(navigation, feet(i), level_players);
         };
 
-        ~Blob(){};
-};
-
-class Snake : public Enemy
-{
-    public:
-        Snake(sprite enemy_sprite, point_2d position, vector<std::shared_ptr<Player>> level_players) : Enemy (enemy_sprite, position, level_players)
+        // For the collision jobs, which run side by side
+        vector<int> query_rect_shared(rectangle area) const
         {
-            std::shared_ptr<Behaviour> ai(new SnakeBehaviour(enemy_sprite, level_players));
-            this->ai = ai;
-            point_2d pos = this->position;
-            pos.y = pos.y + 32;
-            sprite_set_position(enemy_sprite, pos);
+            return grid.query_rect_shared(area);
+        };
 
-            make_hitbox();
+        rectangle get_hitbox(int enemy_id)
+        {
+            return hitbox[index_of_id[enemy_id]];
         };
 
-        ~Snake(){};
-};
+        int get_hp(int enemy_id)
+        {
+            return hp[index_of_id[enemy_id]];
+        };
 
-class Rat : public Enemy
-{
-    public:
-        Rat(sprite enemy_sprite, point_2d position, vector<std::shared_ptr<Player>> level_players) : Enemy (enemy_sprite, position, level_players)
+        void take_damage(int enemy_id, int decrement)
         {
-            std::shared_ptr<Behaviour> ai(new RatBehaviour(enemy_sprite, level_players));
-            this->ai = ai;
-            point_2d pos = this->position;
-            pos.y = pos.y + 32;
-            sprite_set_position(enemy_sprite, pos);
+            hp[index_of_id[enemy_id]] -= decrement;
+        };
 
-            make_hitbox();
+        bool is_on_floor(int enemy_id)
+        {
+            return on_floor[index_of_id[enemy_id]];
         };
 
-        ~Rat(){};
-};
+        void set_facing_left(int enemy_id, bool new_value)
+        {
+            int i = index_of_id[enemy_id];
+            facing_left[i] = new_value;
+            restart_animation[i] = true;
+        };
 
-class WaterRat : public Enemy
-{
-    public:
-        WaterRat(sprite enemy_sprite, point_2d position, vector<std::shared_ptr<Player>> level_players) : Enemy (enemy_sprite, position, level_players)
+        int get_last_tick(int enemy_id)
         {
-            std::shared_ptr<Behaviour> ai(new WaterRatBehaviour(enemy_sprite));
-            this->ai = ai;
-            point_2d pos = this->position;
-            pos.y = pos.y + 32;
-            sprite_set_position(enemy_sprite, pos);
+            return last_tick[index_of_id[enemy_id]];
+        };
 
-            make_hitbox();
+        void set_last_tick(int enemy_id, int tick)
+        {
+            last_tick[index_of_id[enemy_id]] = tick;
         };
 
-        ~WaterRat(){};
-};
\ No newline at end of file
+        string test_collision(int enemy_id, rectangle one)
+        {
+            rectangle box = hitbox[index_of_id[enemy_id]];
+            string collision = "None";
+            double dx = (one.x + one.width/2) - (box.x + box.width/2);
+            double dy = (one.y + one.height/2) - (box.y + box.height/2);
+            double width = (one.width + box.width)/2;
+            double height = (one.height + box.height)/2;
+            double crossWidth = width * dy;
+            double crossHeight = height * dx;
+
+            if(abs(dx) <= width && abs(dy) <= height)
+            {
+                if(crossWidth>=crossHeight)
+                {
+                    if(crossWidth > (-crossHeight))
+                        collision = "Bottom";
+                    else
+                        collision = "Left";
+                }
+                else
+                {
+                    //Bias so player has a better chance of hitting them while above
+                    if(crossWidth - 200 > -(crossHeight))
+                        collision = "Right";
+                    else
+                        collision = "Top";
+                }
+            }
+
+            return collision;
+        };
+};
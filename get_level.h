@@ -1,7 +1,12 @@
 #include "splashkit.h"
 #include "level.h"
+#include <chrono>
 #include <memory>
 
+// The level with a spawn for every player, and how long it is run for when timed
+#define BENCH_LEVEL 6
+#define BENCH_TICKS 600
+
 shared_ptr<Level> get_next_level(int level, vector<CellSheet> cell_sheets, int tile_size, int players)
 { 
     shared_ptr<Level> next_level;
@@ -37,6 +42,12 @@ shared_ptr<Level> get_next_level(int level, vector<CellSheet> cell_sheets, int t
                 next_level = surfin;
                 break;
             }
+        case BENCH_LEVEL:
+            {
+                shared_ptr<Level> bench(new PlayerBench(cell_sheets, tile_size, players));
+                next_level = bench;
+                break;
+            }
         default:
             {
                 shared_ptr<Level> def(new TooManyRoach(cell_sheets, tile_size, players));
@@ -46,4 +57,29 @@ shared_ptr<Level> get_next_level(int level, vector<CellSheet> cell_sheets, int t
     }
 
     return next_level;
-}
\ No newline at end of file
+}
+
+// Times simulating the benchmark level with each player count, everyone standing still. Each
+// player adds their own collision detection, flow field and HUD slot, so the time per tick should
+// grow by about the same amount for every player added.
+int benchmark_player_counts(vector<CellSheet> cell_sheets, int tile_size)
+{
+    render_frame discarded;
+    for (int players = 1; players <= MAX_PLAYERS; players++)
+    {
+        shared_ptr<Level> level = get_next_level(BENCH_LEVEL, cell_sheets, tile_size, players);
+        current_input() = input_frame();
+
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < BENCH_TICKS; i++)
+        {
+            level->simulate();
+            render_queue().end_frame(discarded);
+        }
+        double tick_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / BENCH_TICKS;
+
+        write_line(to_string(players) + " players: " + to_string(tick_ms) + "ms per tick");
+    }
+
+    return 0;
+}
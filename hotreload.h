@@ -0,0 +1,234 @@
+#include "splashkit.h"
+#include "level.h"
+#include "levelparts.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#pragma once
+
+using namespace std;
+
+// Frames between reading the layer files again where there is no inotify to say they changed
+#define HOT_RELOAD_POLL_FRAMES 30
+
+// A layer file's tile ids row by row, false if it can't be read or is empty, as it can be while
+// an editor is part way through saving it
+bool read_layer_tiles(const string &file, vector<vector<int>> &tiles)
+{
+    ifstream map_level(file);
+    if (map_level.fail())
+        return false;
+
+    tiles.clear();
+    string line;
+    while (getline(map_level, line))
+    {
+        istringstream row(line);
+        vector<int> ids;
+        int id;
+        while (row >> id)
+            ids.push_back(id);
+        if (!ids.empty())
+            tiles.push_back(ids);
+    }
+    return !tiles.empty();
+}
+
+// Every tile that differs, only for layers of the same size
+vector<tile_change> diff_layer_tiles(const vector<vector<int>> &was, const vector<vector<int>> &now)
+{
+    vector<tile_change> changes;
+    for (int row = 0; row < was.size(); row++)
+        for (int col = 0; col < was[row].size(); col++)
+            if (was[row][col] != now[row][col])
+                changes.push_back({col, row, was[row][col], now[row][col]});
+    return changes;
+}
+
+bool same_layer_size(const vector<vector<int>> &one, const vector<vector<int>> &other)
+{
+    if (one.size() != other.size())
+        return false;
+    for (int row = 0; row < one.size(); row++)
+        if (one[row].size() != other[row].size())
+            return false;
+    return true;
+}
+
+// Watches the layer files of the level being played and rebuilds the tiles that change in them,
+// so a level designer sees an edit a frame after saving it instead of starting the level again.
+// Uses inotify on the files' directories where there is one, as editors often save by moving a
+// new file over the old, and reads the files again every so often where there isn't.
+class LayerWatcher
+{
+    private:
+        shared_ptr<Level> level;
+        vector<string> files;
+        // Each layer's ids as the level has them now
+        vector<vector<vector<int>>> tiles;
+        vector<bool> changed;
+        int notify = -1;
+        int frames = 0;
+
+        static string file_name(const string &path)
+        {
+            size_t slash = path.find_last_of('/');
+            return slash == string::npos ? path : path.substr(slash + 1);
+        };
+
+        static string directory_of(const string &path)
+        {
+            size_t slash = path.find_last_of('/');
+            return slash == string::npos ? "." : path.substr(0, slash);
+        };
+
+        // Closing the descriptor takes its watches with it
+        void close_watches()
+        {
+#ifdef __linux__
+            if (notify >= 0)
+                close(notify);
+#endif
+            notify = -1;
+        };
+
+        void open_watches()
+        {
+#ifdef __linux__
+            notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (notify < 0)
+                return;
+
+            vector<string> watched;
+            for (int i = 0; i < files.size(); i++)
+            {
+                string directory = directory_of(files[i]);
+                if (find(watched.begin(), watched.end(), directory) != watched.end())
+                    continue;
+
+                inotify_add_watch(notify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+                watched.push_back(directory);
+            }
+#endif
+        };
+
+        // Marks the layers whose file was written or moved into place since the last look
+        void read_events()
+        {
+#ifdef __linux__
+            if (notify >= 0)
+            {
+                alignas(inotify_event) char buffer[4096];
+                ssize_t length;
+                while ((length = read(notify, buffer, sizeof(buffer))) > 0)
+                {
+                    for (char *at = buffer; at < buffer + length;)
+                    {
+                        inotify_event *event = reinterpret_cast<inotify_event *>(at);
+                        string name = event->len > 0 ? string(event->name) : "";
+                        for (int i = 0; i < files.size(); i++)
+                            if (file_name(files[i]) == name)
+                                changed[i] = true;
+                        at += sizeof(inotify_event) + event->len;
+                    }
+                }
+                return;
+            }
+#endif
+            frames += 1;
+            if (frames % HOT_RELOAD_POLL_FRAMES != 0)
+                return;
+
+            for (int i = 0; i < files.size(); i++)
+            {
+                vector<vector<int>> now;
+                if (read_layer_tiles(files[i], now) && now != tiles[i])
+                    changed[i] = true;
+            }
+        };
+
+    public:
+        LayerWatcher(){};
+
+        ~LayerWatcher()
+        {
+            close_watches();
+        };
+
+        LayerWatcher(const LayerWatcher &) = delete;
+        LayerWatcher &operator=(const LayerWatcher &) = delete;
+
+        // Starts watching the level's layer files from what they hold now
+        void watch(shared_ptr<Level> level)
+        {
+            close_watches();
+            this->level = level;
+            this->files = level->get_layer_files();
+            this->tiles.assign(files.size(), vector<vector<int>>());
+            this->changed.assign(files.size(), false);
+            this->frames = 0;
+
+            for (int i = 0; i < files.size(); i++)
+                read_layer_tiles(files[i], tiles[i]);
+            open_watches();
+        };
+
+        shared_ptr<Level> get_level()
+        {
+            return this->level;
+        };
+
+        // Whether a watched file has changed, only reads events so the level can still be running
+        bool poll()
+        {
+            if (level == nullptr)
+                return false;
+
+            read_events();
+            return find(changed.begin(), changed.end(), true) != changed.end();
+        };
+
+        // Rebuilds the changed tiles of every changed layer, the level must not be simulating
+        void apply()
+        {
+            for (int i = 0; i < files.size(); i++)
+            {
+                if (!changed[i])
+                    continue;
+                changed[i] = false;
+
+                vector<vector<int>> now;
+                if (!read_layer_tiles(files[i], now))
+                    continue;
+
+                if (!same_layer_size(tiles[i], now))
+                {
+                    write_line("Hot reload: " + files[i] + " changed size, start the level again to see it");
+                    continue;
+                }
+
+                vector<tile_change> changes = diff_layer_tiles(tiles[i], now);
+                if (changes.empty())
+                    continue;
+
+                auto start = chrono::steady_clock::now();
+                int read_once = level->reload_tiles(i, changes);
+                double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                tiles[i] = now;
+
+                string report = "Hot reload: " + to_string(changes.size()) + " tiles of " + files[i] + " rebuilt in " + to_string(ms) + "ms";
+                if (read_once > 0)
+                    report += ", " + to_string(read_once) + " door, spawn or enemy tiles need the level started again";
+                write_line(report);
+            }
+        };
+};
@@ -1,92 +1,159 @@
 #include "splashkit.h"
 #include "player.h"
+#include "renderqueue.h"
+#include "assetpack.h"
+#include "telemetry.h"
 #include <memory>
 
 #pragma once
 
+// HUD layout, each player gets a slot of health bar and lives across the top
+#define HUD_SLOT_X 125
+#define HUD_SLOT_WIDTH 145
+#define HUD_LIFE_SPACING 35
+#define HUD_HEIGHT 120
+#define HUD_FONT_SIZE 9
+
+// Name the HUD bitmaps of a player's colour start with
+string player_colour_name(int player_id)
+{
+    switch (player_id)
+    {
+        case 1:
+            return "Blue";
+        case 2:
+            return "Pink";
+        default:
+            return "Purple";
+    }
+}
+
+// What the HUD shows, copied from the players at the end of a tick and handed over with the frame
+// it drew, so the main thread never reads the players while the next tick changes them
+struct hud_values
+{
+    int players = 0;
+    int player_id[MAX_PLAYERS] = {};
+    int health[MAX_PLAYERS] = {};
+    int lives[MAX_PLAYERS] = {};
+    int score = 0;
+
+    bool operator==(const hud_values &other) const
+    {
+        if (players != other.players || score != other.score)
+            return false;
+        for (int i = 0; i < players; i++)
+            if (player_id[i] != other.player_id[i] || health[i] != other.health[i] || lives[i] != other.lives[i])
+                return false;
+        return true;
+    };
+
+    bool operator!=(const hud_values &other) const
+    {
+        return !(*this == other);
+    };
+};
+
 class HUD
 {
     private:
         //Added the current level players so you have easy access to them
         vector<std::shared_ptr<Player>> level_players;
+        // Everything the HUD shows, drawn again only when the values change
+        bitmap cache;
+        hud_values shown;
+        bool drawn = false;
+        int best_score = 0;
+        int redraws = 0;
 
-        void high_score()
+        // Best score so far, the high score table is written by the telemetry thread
+        void high_score(int score)
         {
-            // To Be Done.
+            telemetry().offer_score(score);
+            best_score = telemetry().get_best_score();
         }
 
+        // The players are laid out last to first so player one ends up on the right
+        void draw_player(const hud_values &values, int player, int slot)
+        {
+            string colour = player_colour_name(values.player_id[player]);
+            int x = HUD_SLOT_X + slot * HUD_SLOT_WIDTH;
+
+            draw_bitmap_on_bitmap(cache, asset_bitmap(colour + "EmptyBar"), x, 80, option_part_bmp(0, 0, 64, 32));
+            draw_bitmap_on_bitmap(cache, asset_bitmap(colour + "HealthBar"), x, 80, option_part_bmp(0, 0, 64 / 3 * values.health[player], 32));
+
+            for (int i = 0; i < values.lives[player]; i++)
+                draw_bitmap_on_bitmap(cache, asset_bitmap(colour + "Live"), x - 5 + i * HUD_LIFE_SPACING, 55);
+        };
+
+        void redraw(const hud_values &values)
+        {
+            shown = values;
+            drawn = true;
+            high_score(values.score);
+            asset_font("DefaultFont");
+
+            clear_bitmap(cache, COLOR_TRANSPARENT);
+            draw_text_on_bitmap(cache, "HEALTH: ", COLOR_WHITE, "DefaultFont", HUD_FONT_SIZE, 60, 100);
+            draw_text_on_bitmap(cache, "LIVES: ", COLOR_WHITE, "DefaultFont", HUD_FONT_SIZE, 60, 70);
+
+            for (int i = 0; i < values.players; i++)
+                draw_player(values, i, values.players - 1 - i);
+
+            int x = HUD_SLOT_X + values.players * HUD_SLOT_WIDTH;
+            draw_text_on_bitmap(cache, "SCORE: " + to_string(values.score), COLOR_WHITE, "DefaultFont", HUD_FONT_SIZE, x, 70);
+            draw_text_on_bitmap(cache, "HIGH: " + to_string(best_score), COLOR_WHITE, "DefaultFont", HUD_FONT_SIZE, x, 100);
+
+            redraws += 1;
+        };
+
     public:
         HUD(vector<std::shared_ptr<Player>> level_players)
         {
+            static int huds = 0;
+
             this->level_players = level_players;
+            this->cache = create_bitmap("HUD" + to_string(huds++), HUD_SLOT_X + (level_players.size() + 1) * HUD_SLOT_WIDTH + 60, HUD_HEIGHT);
+            this->best_score = telemetry().get_best_score();
         };
-        ~HUD(){};
 
-        void update()
+        ~HUD()
         {
-            draw_text("HEALTH: ", COLOR_WHITE, "DefaultFont", 9, 60, 100, option_to_screen());
-            draw_text("LIVES: ", COLOR_WHITE, "DefaultFont", 9, 60, 70, option_to_screen());
+            free_bitmap(cache);
+        };
 
-            if(level_players.size() > 1 )
+        // The players' stats as they are now, taken by the simulation at the end of a tick
+        hud_values take_values()
+        {
+            hud_values values;
+            values.players = min((int)level_players.size(), MAX_PLAYERS);
+            for (int i = 0; i < values.players; i++)
             {
-                draw_bitmap("PinkEmptyBar", 125, 80, option_part_bmp(0, 0, 64, 32, option_to_screen()));
-                draw_bitmap("PinkHealthBar", 125, 80, option_part_bmp(0, 0, 64/3*level_players[1]->player_health, 32, option_to_screen()));
-
-                if(level_players[1]->player_lives==3)
-                {                
-                    draw_bitmap("PinkLive", 190, 55, option_to_screen());
-                    draw_bitmap("PinkLive", 155, 55, option_to_screen());
-                    draw_bitmap("PinkLive", 120, 55, option_to_screen());
-                }
-                if(level_players[1]->player_lives==2)
-                {
-                    draw_bitmap("PinkLive", 155, 55, option_to_screen());
-                    draw_bitmap("PinkLive", 120, 55, option_to_screen());
-                }
-                if(level_players[1]->player_lives==1)
-                {
-                    draw_bitmap("PinkLive", 120, 55, option_to_screen());
-                }
-
-                draw_bitmap("BlueEmptyBar", 270, 80, option_part_bmp(0, 0, 64, 32, option_to_screen()));
-                draw_bitmap("BlueHealthBar", 270, 80, option_part_bmp(0, 0, 64/3*level_players[0]->player_health, 32, option_to_screen()));
-
-                if(level_players[0]->player_lives==3)
-                {                
-                    draw_bitmap("BlueLive", 335, 55, option_to_screen());
-                    draw_bitmap("BlueLive", 300, 55, option_to_screen());
-                    draw_bitmap("BlueLive", 265, 55, option_to_screen());
-                }
-                if(level_players[0]->player_lives==2)
-                {
-                    draw_bitmap("BlueLive", 300, 55, option_to_screen());
-                    draw_bitmap("BlueLive", 265, 55, option_to_screen());
-                }
-                if(level_players[0]->player_lives==1)
-                {
-                    draw_bitmap("BlueLive", 265, 55, option_to_screen());
-                } 
-            }
-            else
-            {              
-                draw_bitmap("PurpleEmptyBar", 125, 80, option_part_bmp(0, 0, 64, 32, option_to_screen()));
-                draw_bitmap("PurpleHealthBar", 125, 80, option_part_bmp(0, 0, 64/3*level_players[0]->player_health, 32, option_to_screen()));
-                   
-                   if(level_players[0]->player_lives==3)
-                {                
-                    draw_bitmap("PurpleLive", 190, 55, option_to_screen());
-                    draw_bitmap("PurpleLive", 155, 55, option_to_screen());
-                    draw_bitmap("PurpleLive", 120, 55, option_to_screen());
-                }
-                if(level_players[0]->player_lives==2)
-                {
-                    draw_bitmap("PurpleLive", 155, 55, option_to_screen());
-                    draw_bitmap("PurpleLive", 120, 55, option_to_screen());
-                }
-                if(level_players[0]->player_lives==1)
-                {
-                    draw_bitmap("PurpleLive", 120, 55, option_to_screen());
-                }
+                values.player_id[i] = level_players[i]->get_player_id();
+                values.health[i] = level_players[i]->get_health();
+                values.lives[i] = level_players[i]->get_lives();
+                values.score += level_players[i]->get_score();
             }
+            return values;
+        };
+
+        // Redraws the bitmap from a frame's values if they differ from what it shows. Draws onto
+        // a bitmap, so main thread only.
+        void refresh(const hud_values &values)
+        {
+            if (!drawn || values != shown)
+                redraw(values);
+        };
+
+        // Records the bitmap into the frame. It is refreshed from the same tick's values just
+        // before the frame is drawn.
+        void submit()
+        {
+            submit_bitmap(cache, 0, 0, option_to_screen());
+        };
+
+        int get_redraws()
+        {
+            return this->redraws;
         };
-};
\ No newline at end of file
+};
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// Threads kept busy elsewhere, the main thread and the simulation thread
+#define JOB_RESERVED_THREADS 2
+#define JOB_THREADS_MAX 6
+
+// A few threads that sit waiting for batches of independent jobs. The thread handing out a batch
+// works on it too and gets back once every job has finished. With no threads everything runs on
+// the calling thread, in order.
+class JobPool
+{
+    private:
+        vector<thread> workers;
+        mutex lock;
+        condition_variable wake;
+        // Told when the last busy worker finishes
+        condition_variable idle;
+        function<void(int)> job;
+        int job_count = 0;
+        int generation = 0;
+        bool quitting = false;
+        // Workers that have taken a batch and not finished it, only changed under the lock
+        int busy = 0;
+        atomic<int> next{0};
+
+        void run_jobs(const function<void(int)> &job, int job_count)
+        {
+            for (int i = next++; i < job_count; i = next++)
+                job(i);
+        };
+
+        void work()
+        {
+            int seen = 0;
+            while (true)
+            {
+                // The batch is copied while the lock is held, run() can hand out the next one
+                // as soon as this worker is no longer busy
+                function<void(int)> batch;
+                int count;
+                {
+                    unique_lock<mutex> guard(lock);
+                    wake.wait(guard, [&]() { return quitting || generation != seen; });
+                    if (quitting)
+                        return;
+                    seen = generation;
+                    batch = job;
+                    count = job_count;
+                    busy += 1;
+                }
+
+                run_jobs(batch, count);
+
+                {
+                    lock_guard<mutex> guard(lock);
+                    busy -= 1;
+                    if (busy == 0)
+                        idle.notify_all();
+                }
+            }
+        };
+
+    public:
+        JobPool(int threads)
+        {
+            for (int i = 0; i < threads; i++)
+                workers.push_back(thread(&JobPool::work, this));
+        };
+
+        ~JobPool()
+        {
+            {
+                lock_guard<mutex> guard(lock);
+                quitting = true;
+            }
+            wake.notify_all();
+            for (int i = 0; i < workers.size(); i++)
+                workers[i].join();
+        };
+
+        JobPool(const JobPool &) = delete;
+        JobPool &operator=(const JobPool &) = delete;
+
+        // Runs job(0) to job(count - 1), returns once they are all done
+        void run(int count, function<void(int)> job)
+        {
+            if (workers.empty() || count <= 1)
+            {
+                for (int i = 0; i < count; i++)
+                    job(i);
+                return;
+            }
+
+            {
+                // A worker still finishing the last batch would pick up this one's indexes
+                unique_lock<mutex> guard(lock);
+                idle.wait(guard, [&]() { return busy == 0; });
+                this->job = job;
+                this->job_count = count;
+                this->next = 0;
+                this->generation += 1;
+            }
+            wake.notify_all();
+
+            run_jobs(job, count);
+
+            // Every index has been handed out, so once no worker is busy they have all finished.
+            // A worker that wakes after this finds nothing left to take.
+            unique_lock<mutex> guard(lock);
+            idle.wait(guard, [&]() { return busy == 0; });
+        };
+
+        int get_threads()
+        {
+            return this->workers.size();
+        };
+};
+
+// The pool the collision detection jobs run on, sized to the cores nothing else is using
+JobPool &collision_jobs()
+{
+    static JobPool pool(min(JOB_THREADS_MAX, max(0, (int)thread::hardware_concurrency() - JOB_RESERVED_THREADS)));
+    return pool;
+}
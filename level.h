@@ -10,19 +10,46 @@
 #include "collision.h"
 #include "background.h"
 #include "levelparts.h"
+#include "spatialhash.h"
+#include "tilegrid.h"
+#include "aischeduler.h"
+#include "navigation.h"
+#include "arena.h"
+#include "solidmerge.h"
+#include "renderqueue.h"
+#include "residency.h"
+#include "snapshot.h"
+#include "contacts.h"
+#include "jobs.h"
+#include "tilechunks.h"
+#include "metrics.h"
+#include <chrono>
 #include <memory>
 #include <vector>
 
 #pragma once
 
+// Black gap between the views of a split screen
+#define SPLIT_SCREEN_GAP 4
+
+// Enemy simulation level of detail
+#define FAR_ENEMIES_PER_FRAME 16
+#define FAR_ENEMY_MAX_STEPS 60
+
 class Level
 {
     protected:
+        // Who has finished and who is out of lives
+        level_status progress;
+        // Enemy bundles the level uses, given back only once everything else has gone
+        BundleHold bundles;
+        // Owns every block and collectable of the level, declared first so it goes last
+        LevelArena arena;
         vector<CellSheet> cell_sheets;
         vector<string> files;
         vector<shared_ptr<Player>> level_players;
         shared_ptr<DoorBlock> door;
-        vector<shared_ptr<Enemy>> level_enemies;
+        EnemySystem enemies;
         vector<vector<shared_ptr<Block>>> solid_blocks;
         vector<vector<shared_ptr<EdgeBlock>>> level_edges;
         vector<vector<shared_ptr<Ladder>>> ladders;
@@ -36,9 +63,33 @@ class Level
         vector<vector<shared_ptr<MultiTurnablePipeBlock>>> multi_turn_pipes;
         vector<vector<shared_ptr<EmptyMultiTurnBlock>>> empty_multi_turn_pipes;
         vector<vector<shared_ptr<Collectable>>> level_collectables;
+        SpatialHash<rectangle> solid_grid;
+        vector<shared_ptr<WaterBlock>> water_list;
+        RectBatch water_bounds;
+        vector<shared_ptr<ToxicBlock>> toxic_list;
+        RectBatch toxic_bounds;
+        solid_merge_stats merge_stats;
+        SpatialHash<shared_ptr<EdgeBlock>> edge_grid;
+        SpatialHash<shared_ptr<Collectable>> collectable_grid;
+        water_network water_pipes;
+        // What the collision detection jobs found this frame, one per player and per on screen enemy
+        vector<player_contacts> contacts;
+        vector<contact_side> edge_sides;
+        vector<int> on_screen_enemies;
+        TileGrid tile_grid;
+        int frame = 0;
+        int far_enemy_cursor = 0;
+        AIScheduler ai_scheduler;
+        Navigation navigation;
         shared_ptr<Camera> camera;
+        // One camera per player when the screen is split, the tiles both halves draw from
+        bool split_screen = false;
+        vector<shared_ptr<Camera>> split_cameras;
+        TileChunkCache static_tiles;
         shared_ptr<Background> background;
         shared_ptr<HUD> level_hud;
+        // What the HUD showed at the end of the last tick
+        hud_values hud_frame;
         vector<string> pre_level_side_text;
         string password;
         int tile_size;
@@ -47,234 +98,839 @@ class Level
         string level_name = "";
         music level_music;
         bitmap pre_level_image;
+        // The level as it was built, and wherever it was last checkpointed
+        level_snapshot start;
+        level_snapshot checkpoint;
+        // The last frame update recorded, kept so its storage is reused
+        render_frame frame_drawn;
+        // Phase timings and counts of the last tick
+        level_metrics metrics;
 
-    public:
-        bool is_player1_out_of_lives = false;
-        bool player1_complete = false;
+        // Adds the time since phase_start to the phase, and starts the next phase from now
+        void end_phase(level_phase phase, chrono::steady_clock::time_point &phase_start)
+        {
+            chrono::steady_clock::time_point now = chrono::steady_clock::now();
+            metrics.phase_ms[phase] += chrono::duration<double, milli>(now - phase_start).count();
+            phase_start = now;
+        }
+
+        void save_snapshot(level_snapshot &snapshot)
+        {
+            snapshot.frame = this->frame;
+            snapshot.camera = point_at(camera_x(), camera_y());
+            snapshot.progress = this->progress;
+            snapshot.door = door->save_state();
+
+            // Only the blocks that can change, cleared rather than reallocated when saved over
+            snapshot.blocks.clear();
+            save_block_layers(water, snapshot.blocks);
+            save_block_layers(hold_pipes, snapshot.blocks);
+            save_block_layers(empty_pipes, snapshot.blocks);
+            save_block_layers(turn_pipes, snapshot.blocks);
+            save_block_layers(empty_turn_pipes, snapshot.blocks);
+            save_block_layers(multi_turn_pipes, snapshot.blocks);
+            save_block_layers(empty_multi_turn_pipes, snapshot.blocks);
+
+            snapshot.collected.clear();
+            save_collected(level_collectables, snapshot.collected);
+
+            snapshot.players.clear();
+            for (int i = 0; i < level_players.size(); i++)
+                snapshot.players.push_back(level_players[i]->save_state());
+
+            enemies.save_state(snapshot.enemies);
+            snapshot.far_enemy_cursor = this->far_enemy_cursor;
+            level_clock().save_state(snapshot.clock);
+            navigation.save_state(snapshot.navigation);
+            ai_scheduler.save_state(snapshot.ai);
+            snapshot.taken = true;
+        }
+
+        // With resume the level carries on exactly as it was when saved, as a rollback needs.
+        // Otherwise the players start over standing still and every timer is stopped.
+        void load_snapshot(const level_snapshot &snapshot, bool resume = false)
+        {
+            this->frame = snapshot.frame;
+            this->far_enemy_cursor = 0;
+            set_camera_x(snapshot.camera.x);
+            set_camera_y(snapshot.camera.y);
+            this->progress = snapshot.progress;
+            door->restore_state(snapshot.door);
+
+            // Same order as save_snapshot
+            int next = 0;
+            restore_block_layers(water, snapshot.blocks, next);
+            restore_block_layers(hold_pipes, snapshot.blocks, next);
+            restore_block_layers(empty_pipes, snapshot.blocks, next);
+            restore_block_layers(turn_pipes, snapshot.blocks, next);
+            restore_block_layers(empty_turn_pipes, snapshot.blocks, next);
+            restore_block_layers(multi_turn_pipes, snapshot.blocks, next);
+            restore_block_layers(empty_multi_turn_pipes, snapshot.blocks, next);
+
+            restore_collected(level_collectables, snapshot.collected);
+
+            for (int i = 0; i < level_players.size() && i < snapshot.players.size(); i++)
+                level_players[i]->restore_state(snapshot.players[i], resume);
+
+            enemies.restore_state(snapshot.enemies);
+            on_screen_enemies.clear();
+
+            if (!resume)
+            {
+                reset_level_timers();
+                return;
+            }
+
+            this->far_enemy_cursor = snapshot.far_enemy_cursor;
+            level_clock().restore_state(snapshot.clock);
+            navigation.restore_state(snapshot.navigation);
+            ai_scheduler.restore_state(snapshot.ai);
+        }
+
+        // The snapshot's states by block, taken before blocks are added or taken out
+        void index_snapshot(const level_snapshot &snapshot, snapshot_index &index)
+        {
+            // Same order as save_snapshot
+            int next = 0;
+            index_block_layers(water, snapshot.blocks, next, index);
+            index_block_layers(hold_pipes, snapshot.blocks, next, index);
+            index_block_layers(empty_pipes, snapshot.blocks, next, index);
+            index_block_layers(turn_pipes, snapshot.blocks, next, index);
+            index_block_layers(empty_turn_pipes, snapshot.blocks, next, index);
+            index_block_layers(multi_turn_pipes, snapshot.blocks, next, index);
+            index_block_layers(empty_multi_turn_pipes, snapshot.blocks, next, index);
+            index_collected(level_collectables, snapshot.collected, index);
+        }
+
+        // Lays the snapshot out again for the blocks the level has now
+        void reindex_snapshot(level_snapshot &snapshot, snapshot_index &index)
+        {
+            snapshot.blocks.clear();
+            reindex_block_layers(water, index, snapshot.blocks);
+            reindex_block_layers(hold_pipes, index, snapshot.blocks);
+            reindex_block_layers(empty_pipes, index, snapshot.blocks);
+            reindex_block_layers(turn_pipes, index, snapshot.blocks);
+            reindex_block_layers(empty_turn_pipes, index, snapshot.blocks);
+            reindex_block_layers(multi_turn_pipes, index, snapshot.blocks);
+            reindex_block_layers(empty_multi_turn_pipes, index, snapshot.blocks);
+
+            snapshot.collected.clear();
+            reindex_collected(level_collectables, index, snapshot.collected);
+        }
+
+        bool on_changed_tile(point_2d position, const vector<unsigned char> &changed)
+        {
+            int col = tile_grid.column_of(position.x);
+            int row = tile_grid.row_of(position.y);
+            return tile_grid.in_bounds(col, row) && changed[row * tile_grid.get_map_width() + col];
+        }
 
-        bool is_player2_out_of_lives = false;
-        bool player2_complete = true;
+        // Takes the blocks on changed tiles out of the list, the rest keep their order
+        template <typename T>
+        vector<shared_ptr<T>> take_changed_tiles(vector<shared_ptr<T>> &blocks, const vector<unsigned char> &changed)
+        {
+            vector<shared_ptr<T>> kept;
+            vector<shared_ptr<T>> taken;
+            for (int i = 0; i < blocks.size(); i++)
+            {
+                if (on_changed_tile(blocks[i]->get_pos(), changed))
+                    taken.push_back(blocks[i]);
+                else
+                    kept.push_back(blocks[i]);
+            }
 
+            blocks = kept;
+            return taken;
+        }
+
+        // Merged solid rectangles reaching into a changed tile are taken out, then every solid tile
+        // they covered and every solid on a changed tile is merged again
+        void remerge_solids(const vector<tile_change> &changes, const vector<unsigned char> &changed)
+        {
+            vector<rectangle> taken;
+            for (int i = 0; i < changes.size(); i++)
+            {
+                rectangle tile = rectangle_from(changes[i].col * tile_size, changes[i].row * tile_size, tile_size, tile_size);
+                vector<rectangle> removed = solid_grid.remove_inside(tile, [](const rectangle &) { return true; });
+                taken.insert(taken.end(), removed.begin(), removed.end());
+            }
+
+            vector<vector<shared_ptr<Block>>> nearby(1);
+            for (int j = 0; j < level_layers; j++)
+                for (int i = 0; i < solid_blocks[j].size(); i++)
+                {
+                    rectangle hitbox = solid_blocks[j][i]->get_block_hitbox();
+                    bool covered = on_changed_tile(solid_blocks[j][i]->get_pos(), changed);
+                    for (int k = 0; k < taken.size() && !covered; k++)
+                        covered = hitbox.x < taken[k].x + taken[k].width && hitbox.x + hitbox.width > taken[k].x && hitbox.y < taken[k].y + taken[k].height && hitbox.y + hitbox.height > taken[k].y;
+
+                    if (covered)
+                        nearby[0].push_back(solid_blocks[j][i]);
+                }
+
+            solid_merge_stats stats;
+            vector<rectangle> merged = merge_solid_tiles(nearby, this->tile_size, stats);
+            for (int i = 0; i < merged.size(); i++)
+                solid_grid.insert(merged[i], merged[i]);
+            merge_stats.rectangles += (int)merged.size() - (int)taken.size();
+        }
+
+    public:
         Level(vector<CellSheet> cell_sheets, int tile_size, int players)
         {
             set_camera_x(0);
             set_camera_y(0);
             this->tile_size = tile_size;
             this->cell_sheets = cell_sheets;
-            this->players = players;
-            if (this->players == 2)
-            {
-                this->player2_complete = false;
-                this->is_player2_out_of_lives = false;
-            }
+            this->players = max(1, min(players, MAX_PLAYERS));
+            this->progress.players = this->players;
         };
 
         ~Level(){};
 
         void make_level()
         {
-            this->door = make_level_door(files[0], this->tile_size, cell_sheets[5].cells);
+            this->bundles.hold(level_bundles(this->files));
 
-            if (players == 2)
-            {
-                for (int i = 1; i < players + 1; i++)
-                {
-                    shared_ptr<Player> player = make_level_player(files[0], this->tile_size, i);
-                    this->level_players.push_back(player);
-                }
-            }
-            else
+            // Each layer file is read once and everything on it is made from that
+            vector<LevelOjectsMap> layer_maps;
+            for (int i = 0; i < level_layers; i++)
+                layer_maps.push_back(LevelOjectsMap(files[i], this->tile_size));
+
+            this->door = make_level_door(this->arena, layer_maps[0], cell_sheets[5].cells);
+
+            for (int i = 0; i < players; i++)
             {
-                shared_ptr<Player> player = make_level_player(files[0], this->tile_size, 3);
+                shared_ptr<Player> player = make_level_player(layer_maps[0], i, players);
                 this->level_players.push_back(player);
             }
 
             for (int i = 0; i < level_layers; i++)
             {
-                string file = files[i];
+                LevelOjectsMap &map = layer_maps[i];
 
                 vector<shared_ptr<Block>> solid_block;
-                solid_block = make_level_solid_blocks(file, this->tile_size, this->cell_sheets);
+                solid_block = make_level_solid_blocks(this->arena, map, this->cell_sheets);
                 this->solid_blocks.push_back(solid_block);
 
                 vector<shared_ptr<Ladder>> ladder_block;
-                ladder_block = make_level_ladders(file, this->tile_size, this->cell_sheets);
+                ladder_block = make_level_ladders(this->arena, map, this->cell_sheets);
                 this->ladders.push_back(ladder_block);
 
                 vector<shared_ptr<WaterBlock>> water_block;
-                water_block = make_level_water(file, this->tile_size, this->cell_sheets);
+                water_block = make_level_water(this->arena, map, this->cell_sheets);
                 this->water.push_back(water_block);
 
                 vector<shared_ptr<ToxicBlock>> toxic_block;
-                toxic_block = make_level_toxic(file, this->tile_size, this->cell_sheets);
+                toxic_block = make_level_toxic(this->arena, map, this->cell_sheets);
                 this->toxic.push_back(toxic_block);
 
                 vector<shared_ptr<HoldablePipeBlock>> holdpipe_block;
-                holdpipe_block = make_holdable_pipes(file, this->tile_size, this->cell_sheets);
+                holdpipe_block = make_holdable_pipes(this->arena, map, this->cell_sheets);
                 this->hold_pipes.push_back(holdpipe_block);
 
                 vector<shared_ptr<EmptyPipeBlock>> emp_block;
-                emp_block = make_holdable_pipe_empty_spaces(file, this->tile_size, this->cell_sheets);
+                emp_block = make_holdable_pipe_empty_spaces(this->arena, map, this->cell_sheets);
                 this->empty_pipes.push_back(emp_block);
 
                 vector<shared_ptr<TurnablePipeBlock>> turnpipe_block;
-                turnpipe_block = make_turnable_pipes(file, this->tile_size, this->cell_sheets);
+                turnpipe_block = make_turnable_pipes(this->arena, map, this->cell_sheets);
                 this->turn_pipes.push_back(turnpipe_block);
 
                 vector<shared_ptr<EmptyTurnBlock>> emp_turn_block;
-                emp_turn_block = make_turnable_pipe_empty_spaces(file, this->tile_size, this->cell_sheets);
+                emp_turn_block = make_turnable_pipe_empty_spaces(this->arena, map, this->cell_sheets);
                 this->empty_turn_pipes.push_back(emp_turn_block);
 
                 vector<shared_ptr<MultiTurnablePipeBlock>> multiturnpipe_block;
-                multiturnpipe_block = make_multi_turnable_pipes(file, this->tile_size, this->cell_sheets);
+                multiturnpipe_block = make_multi_turnable_pipes(this->arena, map, this->cell_sheets);
                 this->multi_turn_pipes.push_back(multiturnpipe_block);
 
                 vector<shared_ptr<EmptyMultiTurnBlock>> emp_multi_turn_block;
-                emp_multi_turn_block = make_multi_turnable_pipe_empty_spaces(file, this->tile_size, this->cell_sheets);
+                emp_multi_turn_block = make_multi_turnable_pipe_empty_spaces(this->arena, map, this->cell_sheets);
                 this->empty_multi_turn_pipes.push_back(emp_multi_turn_block);
 
                 vector<shared_ptr<Block>> decoration_block;
-                decoration_block = make_level_decoration(file, this->tile_size, this->cell_sheets);
+                decoration_block = make_level_decoration(this->arena, map, this->cell_sheets);
                 this->decoration.push_back(decoration_block);
 
                 vector<shared_ptr<Collectable>> collect;
-                collect = make_level_collectables(file, this->tile_size, this->cell_sheets);
+                collect = make_level_collectables(this->arena, map, this->cell_sheets);
                 this->level_collectables.push_back(collect);
 
                 vector<shared_ptr<EdgeBlock>> edges;
-                edges = make_edges(file, this->tile_size, this->cell_sheets);
+                edges = make_edges(this->arena, map, this->cell_sheets);
                 this->level_edges.push_back(edges);
 
-                this->level_enemies = make_layer_enemies(this->level_enemies, file, this->tile_size, this->level_players);
+                make_layer_enemies(this->enemies, map);
             }
 
+            make_spatial_grids();
+            make_tile_grid(layer_maps[0]);
+
+            navigation.build(tile_grid, level_players.size());
+            enemies.set_navigation(&navigation);
+            enemies.set_solids(&solid_grid);
+
             shared_ptr<HUD> hud(new HUD(level_players));
             this->level_hud = hud;
 
-            this->camera = make_level_camera(level_players[0], files[0], tile_size);
+            this->camera = make_level_camera(level_players[0], tile_size, tile_grid.get_map_width(), tile_grid.get_map_height());
+
+            save_snapshot(this->start);
         }
 
-        void update()
+        // Puts the level back the way it was built, nothing is loaded again
+        void restart()
         {
-            clear_screen(COLOR_BLACK);
-            background->draw();
+            load_snapshot(this->start);
+        };
 
-            if (!music_playing())
+        void save_checkpoint()
+        {
+            save_snapshot(this->checkpoint);
+        };
+
+        // Back to the last checkpoint, or the start if there hasn't been one
+        void load_checkpoint()
+        {
+            if (this->checkpoint.taken)
+                load_snapshot(this->checkpoint);
+            else
+                restart();
+        };
+
+        // Everything needed to simulate on from this frame exactly, taken every frame of an online game
+        void save_frame(level_snapshot &snapshot)
+        {
+            save_snapshot(snapshot);
+        };
+
+        // Back to a frame saved by save_frame, so the frames after it can be simulated again
+        void load_frame(const level_snapshot &snapshot)
+        {
+            load_snapshot(snapshot, true);
+        };
+
+        // Both machines of an online game have to make the same decisions on the same frames
+        void set_lockstep(bool lockstep)
+        {
+            ai_scheduler.set_think_limit(lockstep ? AI_LOCKSTEP_THINKS : 0);
+        };
+
+        // Layer files the level was built from, back layer first
+        vector<string> get_layer_files()
+        {
+            return vector<string>(files.begin(), files.begin() + min((int)files.size(), level_layers));
+        };
+
+        // Swaps the blocks and collectables on the changed tiles of a layer for what the tiles hold
+        // now, and redoes the solid rectangles, tile flags, edge and collectable entries and tile
+        // chunks those tiles touch. Players, enemies and the rest of the level carry on as they
+        // were. Not safe while the level is being simulated, and needs the main thread when the
+        // screen is split. Returns how many changes were to tiles only read when a level is built.
+        int reload_tiles(int layer, const vector<tile_change> &changes)
+        {
+            int width = tile_grid.get_map_width();
+            vector<unsigned char> changed(width * tile_grid.get_map_height(), 0);
+            SparseLayer changed_ids(width, tile_grid.get_map_height());
+            int read_once = 0;
+
+            for (int i = 0; i < changes.size(); i++)
             {
-                play_music(this->level_music);
-                set_music_volume(0.2f);
+                if (!tile_grid.in_bounds(changes[i].col, changes[i].row))
+                    continue;
+
+                changed[changes[i].row * width + changes[i].col] = 1;
+                changed_ids.add_run(changes[i].row, changes[i].col, 1, changes[i].now);
+                if (tile_read_once(changes[i].was) || tile_read_once(changes[i].now))
+                    read_once += 1;
+            }
+
+            snapshot_index start_index;
+            snapshot_index checkpoint_index;
+            index_snapshot(this->start, start_index);
+            if (this->checkpoint.taken)
+                index_snapshot(this->checkpoint, checkpoint_index);
+
+            // Taken out blocks stay in the arena until the level goes
+            take_changed_tiles(solid_blocks[layer], changed);
+            take_changed_tiles(ladders[layer], changed);
+            take_changed_tiles(decoration[layer], changed);
+            take_changed_tiles(water[layer], changed);
+            take_changed_tiles(toxic[layer], changed);
+            take_changed_tiles(hold_pipes[layer], changed);
+            take_changed_tiles(empty_pipes[layer], changed);
+            take_changed_tiles(turn_pipes[layer], changed);
+            take_changed_tiles(empty_turn_pipes[layer], changed);
+            take_changed_tiles(multi_turn_pipes[layer], changed);
+            take_changed_tiles(empty_multi_turn_pipes[layer], changed);
+            vector<shared_ptr<EdgeBlock>> old_edges = take_changed_tiles(level_edges[layer], changed);
+            vector<shared_ptr<Collectable>> old_collectables = take_changed_tiles(level_collectables[layer], changed);
+
+            for (int i = 0; i < old_edges.size(); i++)
+                edge_grid.remove_inside(old_edges[i]->get_block_hitbox(), [&](const shared_ptr<EdgeBlock> &edge) { return edge == old_edges[i]; });
+            for (int i = 0; i < old_collectables.size(); i++)
+                collectable_grid.remove_inside(old_collectables[i]->get_hitbox(), [&](const shared_ptr<Collectable> &collect) { return collect == old_collectables[i]; });
+
+            // The map only has the changed tiles on it, in row order as the changes come
+            int first_edge = level_edges[layer].size();
+            int first_collectable = level_collectables[layer].size();
+            LevelOjectsMap map(changed_ids, this->tile_size);
+            for (int i = 0; i < cell_sheets.size(); i++)
+            {
+                bitmap cells = cell_sheets[i].cells;
+                int offset = cell_sheets[i].offset;
+                solid_blocks[layer] = map.get_solid_blocks(arena, solid_blocks[layer], cells, offset);
+                ladders[layer] = map.get_ladders(arena, ladders[layer], cells, offset);
+                water[layer] = map.get_water(arena, water[layer], cells, offset);
+                toxic[layer] = map.get_toxic(arena, toxic[layer], cells, offset);
+                hold_pipes[layer] = map.get_holdable_pipes(arena, hold_pipes[layer], cells, offset);
+                empty_pipes[layer] = map.get_empty_pipe_blocks(arena, empty_pipes[layer], cells, offset);
+                turn_pipes[layer] = map.get_turnable_pipes(arena, turn_pipes[layer], cells, offset);
+                empty_turn_pipes[layer] = map.get_empty_turn_blocks(arena, empty_turn_pipes[layer], cells, offset);
+                multi_turn_pipes[layer] = map.get_multi_turnable_pipes(arena, multi_turn_pipes[layer], cells, offset);
+                empty_multi_turn_pipes[layer] = map.get_empty_multi_turn_blocks(arena, empty_multi_turn_pipes[layer], cells, offset);
+                decoration[layer] = map.get_decoration(arena, decoration[layer], cells, offset);
+                level_collectables[layer] = map.get_collectables(arena, level_collectables[layer], cells, offset);
+                level_edges[layer] = map.get_edges(arena, level_edges[layer], cells, offset);
+            }
+
+            for (int i = first_edge; i < level_edges[layer].size(); i++)
+                edge_grid.insert(level_edges[layer][i], level_edges[layer][i]->get_block_hitbox());
+            for (int i = first_collectable; i < level_collectables[layer].size(); i++)
+                collectable_grid.insert(level_collectables[layer][i], level_collectables[layer][i]->get_hitbox());
+
+            remerge_solids(changes, changed);
+
+            // Tile flags come from every layer's blocks on the tile
+            for (int i = 0; i < changes.size(); i++)
+                tile_grid.clear(changes[i].col, changes[i].row);
+            for (int j = 0; j < level_layers; j++)
+            {
+                for (int i = 0; i < solid_blocks[j].size(); i++)
+                    if (on_changed_tile(solid_blocks[j][i]->get_pos(), changed))
+                        tile_grid.mark(solid_blocks[j][i]->get_block_hitbox(), TILE_SOLID);
+
+                for (int i = 0; i < level_edges[j].size(); i++)
+                    if (on_changed_tile(level_edges[j][i]->get_pos(), changed))
+                        tile_grid.mark(level_edges[j][i]->get_block_hitbox(), TILE_EDGE);
+
+                for (int i = 0; i < ladders[j].size(); i++)
+                    if (on_changed_tile(ladders[j][i]->get_pos(), changed))
+                        tile_grid.mark(ladders[j][i]->get_block_hitbox(), TILE_LADDER);
+            }
+            navigation.build(tile_grid, level_players.size());
+            make_water_network();
+
+            if (!static_tiles.empty())
+            {
+                for (int i = 0; i < changes.size(); i++)
+                    static_tiles.start_redraw(layer, rectangle_from(changes[i].col * tile_size, changes[i].row * tile_size, tile_size, tile_size));
+                static_tiles.add(layer, solid_blocks[layer]);
+                static_tiles.add(layer, ladders[layer]);
+                static_tiles.add(layer, decoration[layer]);
+                static_tiles.finish_redraw();
+            }
+
+            reindex_snapshot(this->start, start_index);
+            if (this->checkpoint.taken)
+                reindex_snapshot(this->checkpoint, checkpoint_index);
+
+            return read_once;
+        };
+
+        // Where a player's view goes on a split screen. Two players get a half each, three or four
+        // a quarter each.
+        rectangle split_view_area(int slot)
+        {
+            int columns = 2;
+            int rows = level_players.size() > 2 ? 2 : 1;
+            double width = (screen_width() - SPLIT_SCREEN_GAP * (columns - 1)) / columns;
+            double height = (screen_height() - SPLIT_SCREEN_GAP * (rows - 1)) / rows;
+            return rectangle_from((slot % columns) * (width + SPLIT_SCREEN_GAP), (slot / columns) * (height + SPLIT_SCREEN_GAP), width, height);
+        }
+
+        // Gives each player their own part of the screen. Builds the tile chunks the first time,
+        // so it has to be called from the main thread.
+        void set_split_screen(bool split)
+        {
+            this->split_screen = split && level_players.size() > 1;
+            if (!this->split_screen)
+                return;
+
+            if (split_cameras.empty())
+            {
+                for (int i = 0; i < level_players.size(); i++)
+                {
+                    shared_ptr<Camera> camera = make_level_camera(level_players[i], tile_size, tile_grid.get_map_width(), tile_grid.get_map_height());
+                    rectangle area = split_view_area(i);
+                    camera->set_view_size(area.width, area.height);
+                    split_cameras.push_back(camera);
+                }
+            }
+
+            if (static_tiles.empty())
+            {
+                for (int j = 0; j < level_layers; j++)
+                {
+                    static_tiles.add(j, solid_blocks[j]);
+                    static_tiles.add(j, ladders[j]);
+                    static_tiles.add(j, decoration[j]);
+                }
+            }
+        };
+
+        void make_spatial_grids()
+        {
+            // Solid tiles never change, collision runs against merged runs of them
+            vector<rectangle> solid_rectangles = merge_solid_tiles(solid_blocks, this->tile_size, merge_stats);
+            for (int i = 0; i < solid_rectangles.size(); i++)
+                solid_grid.insert(solid_rectangles[i], solid_rectangles[i]);
+
+            for (int j = 0; j < level_layers; j++)
+            {
+                for (int i = 0; i < level_edges[j].size(); i++)
+                    edge_grid.insert(level_edges[j][i], level_edges[j][i]->get_block_hitbox());
+
+                for (int i = 0; i < level_collectables[j].size(); i++)
+                    collectable_grid.insert(level_collectables[j][i], level_collectables[j][i]->get_hitbox());
             }
-                
+
+            make_water_network();
+        }
+
+        // Packed bounds for the checks that test one box against all of them, and the water network
+        void make_water_network()
+        {
+            water_list.clear();
+            water_bounds.clear();
+            toxic_list.clear();
+            toxic_bounds.clear();
+
+            for (int j = 0; j < level_layers; j++)
+            {
+                for (int i = 0; i < water[j].size(); i++)
+                {
+                    water_list.push_back(water[j][i]);
+                    water_bounds.push(water[j][i]->get_block_hitbox());
+                }
+
+                for (int i = 0; i < toxic[j].size(); i++)
+                {
+                    toxic_list.push_back(toxic[j][i]);
+                    toxic_bounds.push(toxic[j][i]->get_block_hitbox());
+                }
+            }
+
+            this->water_pipes = build_water_network(water, water_bounds, water_list, empty_pipes, turn_pipes, empty_turn_pipes, multi_turn_pipes, empty_multi_turn_pipes);
+        }
+
+        void make_tile_grid(LevelOjectsMap &map)
+        {
+            this->tile_grid = TileGrid(map.get_map_width(), map.get_map_height(), this->tile_size);
+
+            for (int j = 0; j < level_layers; j++)
+            {
+                for (int i = 0; i < solid_blocks[j].size(); i++)
+                    tile_grid.mark(solid_blocks[j][i]->get_block_hitbox(), TILE_SOLID);
+
+                for (int i = 0; i < level_edges[j].size(); i++)
+                    tile_grid.mark(level_edges[j][i]->get_block_hitbox(), TILE_EDGE);
+
+                for (int i = 0; i < ladders[j].size(); i++)
+                    tile_grid.mark(ladders[j][i]->get_block_hitbox(), TILE_LADDER);
+            }
+        }
+
+        // Enemy simulation level of detail. Enemies on screen run their behaviour and animate,
+        // enemies just outside the camera patrol the tile grid every frame and the rest of the
+        // level gets a fixed number of coarse catch up updates each frame.
+        void update_enemies()
+        {
+            vector<rectangle> views = level_views();
+            if (views.empty())
+                views.push_back(camera_world_rectangle());
+
+            on_screen_enemies.clear();
+            for (int v = 0; v < views.size(); v++)
+            {
+                vector<int> in_view = enemies.query_rect(views[v]);
+                for (int i = 0; i < in_view.size(); i++)
+                    if (rect_in_view(enemies.get_hitbox(in_view[i])))
+                        on_screen_enemies.push_back(in_view[i]);
+            }
+
+            // Both halves of a split screen can see the same enemy
+            if (views.size() > 1)
+            {
+                sort(on_screen_enemies.begin(), on_screen_enemies.end());
+                on_screen_enemies.erase(unique(on_screen_enemies.begin(), on_screen_enemies.end()), on_screen_enemies.end());
+            }
+
+            ai_scheduler.update(enemies, on_screen_enemies, level_players);
+
+            enemies.update(on_screen_enemies);
+            for (int i = 0; i < on_screen_enemies.size(); i++)
+                enemies.set_last_tick(on_screen_enemies[i], frame);
+
+            for (int v = 0; v < views.size(); v++)
+            {
+                rectangle near_view = views[v];
+                near_view.x -= views[v].width / 2;
+                near_view.y -= views[v].height / 2;
+                near_view.width += views[v].width;
+                near_view.height += views[v].height;
+
+                vector<int> near_enemies = enemies.query_rect(near_view);
+                for (int i = 0; i < near_enemies.size(); i++)
+                {
+                    int enemy = near_enemies[i];
+                    if (enemies.get_last_tick(enemy) == frame)
+                        continue;
+
+                    enemies.patrol(enemy, tile_grid, 1);
+                    enemies.set_last_tick(enemy, frame);
+                }
+            }
+
+            if (enemies.size() == 0)
+                return;
+
+            int budget = min(FAR_ENEMIES_PER_FRAME, enemies.size());
+            for (int i = 0; i < budget; i++)
+            {
+                far_enemy_cursor = (far_enemy_cursor + 1) % enemies.size();
+                int enemy = enemies.id_at(far_enemy_cursor);
+                if (enemies.get_last_tick(enemy) == frame)
+                    continue;
+
+                int steps = min(frame - enemies.get_last_tick(enemy), FAR_ENEMY_MAX_STEPS);
+                enemies.patrol(enemy, tile_grid, steps);
+                enemies.set_last_tick(enemy, frame);
+            }
+        }
+
+        void update()
+        {
+            current_input() = capture_input();
+            simulate();
+            render_queue().end_frame(this->frame_drawn);
+            present(this->frame_drawn, this->hud_frame);
+        }
+
+        // One tick of the level with the current input. Everything it draws is only recorded, so
+        // it can run off the main thread while the frame before is drawn.
+        void simulate()
+        {
+            chrono::steady_clock::time_point phase_start = chrono::steady_clock::now();
+            for (int i = 0; i < LEVEL_PHASE_COUNT; i++)
+                metrics.phase_ms[i] = 0;
+
+            level_clock().advance();
+            if (!split_screen)
+                level_views().clear();
+            render_queue().begin_frame(split_screen);
+
+            render_queue().set_layer(DRAW_LAYER_BACKGROUND);
+            background->draw();
 
             draw_layers(1, 0);
 
+            render_queue().set_layer(DRAW_LAYER_DOOR);
             door->draw_block();
 
+            render_queue().set_layer(DRAW_LAYER_ACTORS);
+            end_phase(LEVEL_PHASE_TILES, phase_start);
+
             // Player functions
             for (int i = 0; i < level_players.size(); i++)
             {
                 if (!level_players[i]->is_player_dead())
                 {
+                    level_players[i]->begin_move();
                     level_players[i]->update();
                     level_players[i]->get_input();
                     level_players[i]->update_hitbox();
                 }
 
                 if (level_players[i]->has_player_won())
-                {
-                    if (i == 0)
-                        player1_complete = true;
-                    else
-                        player2_complete = true;
-                }
+                    progress.complete[i] = true;
             }
 
-            for (int i = 0; i < level_enemies.size(); i++)
-            {
-                if (rect_on_screen(level_enemies[i]->get_enemy_hitbox()))
-                    level_enemies[i]->update();
-            }
+            frame += 1;
+            end_phase(LEVEL_PHASE_PLAYERS, phase_start);
+            navigation.update(level_players);
+            end_phase(LEVEL_PHASE_NAVIGATION, phase_start);
+            update_enemies();
+            end_phase(LEVEL_PHASE_ENEMIES, phase_start);
 
             draw_layers(level_layers, 1);
+            end_phase(LEVEL_PHASE_TILES, phase_start);
 
             this->camera->update();
+            update_split_views();
             check_collisions();
+            end_phase(LEVEL_PHASE_COLLISIONS, phase_start);
 
             for (int i = 0; i < level_players.size(); i++)
             {
                 point_2d player_pos = sprite_position(level_players[i]->get_player_sprite());
 
-                if(level_players[i]->get_player_id() == 2 && level_players[i]->get_state_type() == "Spawn")
+                // Everyone after player one respawns next to them if their spawn is off screen. With
+                // the screen split everyone has their own camera and nobody is pulled along.
+                if(!split_screen && i > 0 && level_players[i]->get_state_type() == "Spawn")
                 {
                     if(!point_on_screen(to_screen(player_pos)))
                     {
-                        sprite_set_position(level_players[i]->get_player_sprite(), sprite_position(level_players[0]->get_player_sprite()));
+                        level_players[i]->teleport(sprite_position(level_players[0]->get_player_sprite()));
                         player_pos = sprite_position(level_players[i]->get_player_sprite());
                     }
                 }
 
-                if(!point_on_screen(to_screen(player_pos)) && level_players[i]->get_state_type() != "Dying")
+                if(!player_in_view(i, player_pos) && level_players[i]->get_state_type() != "Dying")
                 {
                     if(level_players[i]->get_state_type() != "Spawn")
+                    {
                         this->level_players[i]->change_state(new DyingState, "Dying");
+                        telemetry().record(TELEMETRY_DEATH, i, rectangle_center(level_players[i]->get_player_hitbox()), level_players[i]->get_lives());
+                    }
                 }
 
                 //Player loses a life if they run out of health
-                if (level_players[i]->player_health < 1 && level_players[i]->get_state_type() != "Dying")
+                if (level_players[i]->get_health() < 1 && level_players[i]->get_state_type() != "Dying")
                 {
                     if(level_players[i]->get_state_type() != "Spawn")
+                    {
                         this->level_players[i]->change_state(new DyingState, "Dying");
+                        telemetry().record(TELEMETRY_DEATH, i, rectangle_center(level_players[i]->get_player_hitbox()), level_players[i]->get_lives());
+                    }
                 }
 
                 //If players sets out of lives
-                if (level_players[i]->player_lives == 0 && level_players[i]->get_state_type() == "Spawn")
+                if (level_players[i]->get_lives() == 0 && level_players[i]->get_state_type() == "Spawn")
                 {
                     this->level_players[i]->set_dead(true);
-
-                    if (i == 0)
-                        is_player1_out_of_lives = true;
-                    else
-                        is_player2_out_of_lives = true;
+                    progress.out_of_lives[i] = true;
                 }
             }
 
-            level_hud->update();
+            end_phase(LEVEL_PHASE_LIVES, phase_start);
+
+            render_queue().set_layer(DRAW_LAYER_HUD);
+            level_hud->submit();
+            hud_frame = level_hud->take_values();
+
+            for (int i = 0; i < split_cameras.size() && split_screen; i++)
+            {
+                rectangle view = split_cameras[i]->get_view();
+                render_queue().add_view(split_view_area(i), point_at(view.x, view.y));
+            }
+            end_phase(LEVEL_PHASE_HUD, phase_start);
+
+            metrics.enemies_active = on_screen_enemies.size();
+            metrics.enemies = enemies.size();
+            metrics.water_flowing = 0;
+            for (int i = 0; i < water_list.size(); i++)
+                if (water_list[i]->get_is_flowing())
+                    metrics.water_flowing += 1;
+            metrics.arena_bytes = arena.get_bytes();
+        }
+
+        // Each view of a split screen follows its player, what they show counts as on screen
+        void update_split_views()
+        {
+            if (!split_screen)
+                return;
+
+            level_views().clear();
+            for (int i = 0; i < split_cameras.size(); i++)
+            {
+                split_cameras[i]->follow();
+                level_views().push_back(split_cameras[i]->get_view());
+            }
+        }
+
+        bool player_in_view(int player, point_2d position)
+        {
+            if (split_screen)
+                return point_in_rectangle(position, split_cameras[player]->get_view());
+            return point_on_screen(to_screen(position));
+        }
+
+        // The main thread half of a frame: music, the HUD bitmap from the values of the tick that
+        // recorded the frame, and drawing it
+        void present(const render_frame &frame, const hud_values &hud)
+        {
+            clear_screen(COLOR_BLACK);
+
+            if (!music_playing())
+            {
+                play_music(this->level_music);
+                set_music_volume(0.2f);
+            }
+
+            level_hud->refresh(hud);
+            render_queue().draw(frame);
         }
 
+        // Taken on the thread that simulates, straight after a tick
+        hud_values get_hud_values()
+        {
+            return this->hud_frame;
+        };
+
+        level_status get_status()
+        {
+            return this->progress;
+        };
+
+        level_metrics get_metrics()
+        {
+            return this->metrics;
+        };
+
         void draw_layers(int num_layers, int start)
         {
             for(int j = start; j < num_layers; j++)
             {
-                for(int i = 0; i < solid_blocks[j].size(); i++)
-                    if(rect_on_screen(solid_blocks[j][i]->get_block_hitbox()))
-                        solid_blocks[j][i]->draw_block();
+                render_queue().set_layer(j == 0 ? DRAW_LAYER_BACK_TILES : DRAW_LAYER_FRONT_TILES + j);
 
-                for(int i = 0; i < ladders[j].size(); i++)
-                    if(rect_on_screen(ladders[j][i]->get_block_hitbox()))
-                        ladders[j][i]->draw_block();
+                // Tiles that never change come from the chunks when the screen is split
+                if (split_screen)
+                    static_tiles.submit(j);
+                else
+                {
+                    for(int i = 0; i < solid_blocks[j].size(); i++)
+                        if(rect_in_view(solid_blocks[j][i]->get_block_hitbox()))
+                            solid_blocks[j][i]->draw_block();
 
-                for(int i = 0; i < decoration[j].size(); i++)
-                    if(rect_on_screen(decoration[j][i]->get_block_hitbox()))
-                        decoration[j][i]->draw_block();
+                    for(int i = 0; i < ladders[j].size(); i++)
+                        if(rect_in_view(ladders[j][i]->get_block_hitbox()))
+                            ladders[j][i]->draw_block();
+
+                    for(int i = 0; i < decoration[j].size(); i++)
+                        if(rect_in_view(decoration[j][i]->get_block_hitbox()))
+                            decoration[j][i]->draw_block();
+                }
 
                 for(int i = 0; i < water[j].size(); i++)
                     //if(rect_on_screen(water[j][i]->get_block_hitbox()))
                         water[j][i]->draw_block();
                 
                 for(int i = 0; i < toxic[j].size(); i++)
-                    if(rect_on_screen(toxic[j][i]->get_block_hitbox()))
+                    if(rect_in_view(toxic[j][i]->get_block_hitbox()))
                         toxic[j][i]->draw_block();
 
                 for(int i = 0; i < hold_pipes[j].size(); i++)
-                    if(rect_on_screen(hold_pipes[j][i]->get_block_hitbox()))
+                    if(rect_in_view(hold_pipes[j][i]->get_block_hitbox()))
                         hold_pipes[j][i]->draw_block();
                 
                 for(int i = 0; i < empty_pipes[j].size(); i++)
-                    if(rect_on_screen(empty_pipes[j][i]->get_block_hitbox()))
+                    if(rect_in_view(empty_pipes[j][i]->get_block_hitbox()))
                         empty_pipes[j][i]->draw_block();
 
                 for(int i = 0; i < turn_pipes[j].size(); i++)
-                    if(rect_on_screen(turn_pipes[j][i]->get_block_hitbox()))
+                    if(rect_in_view(turn_pipes[j][i]->get_block_hitbox()))
                         turn_pipes[j][i]->draw_block();
                 
                 for(int i = 0; i < empty_turn_pipes[j].size(); i++)
@@ -282,7 +938,7 @@ class Level
                         empty_turn_pipes[j][i]->draw_block();
 
                 for(int i = 0; i < multi_turn_pipes[j].size(); i++)
-                    if(rect_on_screen(multi_turn_pipes[j][i]->get_block_hitbox()))
+                    if(rect_in_view(multi_turn_pipes[j][i]->get_block_hitbox()))
                         multi_turn_pipes[j][i]->draw_block();
 
                 for(int i = 0; i < empty_multi_turn_pipes[j].size(); i++)
@@ -290,42 +946,104 @@ class Level
                         empty_multi_turn_pipes[j][i]->draw_block();
                 
                 for(int i = 0; i < level_collectables[j].size(); i++)
-                    if(rect_on_screen(level_collectables[j][i]->get_hitbox()))
+                    if(rect_in_view(level_collectables[j][i]->get_hitbox()))
                         level_collectables[j][i]->draw();
 
                 for(int i = 0; i < level_edges[j].size(); i++)
-                    if(rect_on_screen(level_edges[j][i]->get_block_hitbox()))
+                    if(rect_in_view(level_edges[j][i]->get_block_hitbox()))
                         level_edges[j][i]->draw_block();
             }
         }
 
+        // Ladders are checked before anyone moves, the edges can be found at the same time
+        void detect_ladder_and_edge_contacts()
+        {
+            int edge_jobs = (on_screen_enemies.size() + EDGE_ENEMIES_PER_JOB - 1) / EDGE_ENEMIES_PER_JOB;
+            edge_sides.resize(on_screen_enemies.size());
+
+            collision_jobs().run(level_players.size() + edge_jobs, [&](int job) {
+                if (job < level_players.size())
+                {
+                    detect_layer_contacts(ladders, level_players[job]->get_player_hitbox(), contacts[job].ladders);
+                    return;
+                }
+
+                int first = (job - level_players.size()) * EDGE_ENEMIES_PER_JOB;
+                detect_enemy_edge_contacts(edge_grid, enemies, on_screen_enemies, first, first + EDGE_ENEMIES_PER_JOB, edge_sides);
+            });
+        }
+
+        // Everything else a player can touch, from where their movement left them
+        void detect_player_contacts(int k)
+        {
+            rectangle hitbox = level_players[k]->get_player_hitbox();
+            player_contacts &found = contacts[k];
+
+            detect_layer_contacts(hold_pipes, hitbox, found.hold_pipes);
+            detect_layer_contacts(turn_pipes, hitbox, found.turn_pipes);
+            detect_special_contacts(empty_pipes, hitbox, found.empty_pipes);
+            detect_layer_contacts(multi_turn_pipes, hitbox, found.multi_pipes);
+            detect_layer_contacts(water, hitbox, found.water);
+            found.door = door->test_collision(hitbox);
+            aabb_overlap(hitbox, toxic_bounds, found.toxic);
+            found.enemies = enemies.query_rect_shared(hitbox);
+
+            found.collectables = collectable_grid.query_rect_shared(hitbox);
+            found.collectable_hits.clear();
+            for (int i = 0; i < found.collectables.size(); i++)
+            {
+                contact_side side = to_contact_side(found.collectables[i]->collision(hitbox));
+                if (side != CONTACT_NONE)
+                    found.collectable_hits.add(0, i, side);
+            }
+        }
+
+        // Detection runs as jobs that only read the level and record what touches what. The
+        // responses then go through the records on this thread in the order the checks always ran,
+        // so sounds, state changes and scores come out the same as testing everything in place.
         void check_collisions()
         {
-            check_ladder_collisions(ladders, level_players);
-            check_solid_block_collisions(solid_blocks, level_players);
+            contacts.resize(level_players.size());
+
+            detect_ladder_and_edge_contacts();
+            check_ladder_collisions(ladders, level_players, contacts);
+            resolve_player_movement(solid_grid, level_players);
+
+            collision_jobs().run(level_players.size(), [&](int k) { detect_player_contacts(k); });
 
             // check for player to pick up a holdable pipe
-            check_holdable_pipe_block_collisions(hold_pipes, level_players);
-            check_turnable_pipe_block_collisions(turn_pipes, level_players);
+            check_holdable_pipe_block_collisions(hold_pipes, level_players, contacts);
+            check_turnable_pipe_block_collisions(turn_pipes, level_players, contacts);
 
             // check for player to place it's pipe on th empty pipe
-            check_empty_pipe_block_collisions(empty_pipes, level_players);
-            check_door_block_collisions(door, level_players);
-            check_enemy_solid_block_collisions(solid_blocks, level_enemies);
-            check_enemy_edge_block_collisions(level_edges, level_enemies);
-            check_enemy_player_collisions(level_enemies, level_players);
-            check_water_block_collisions(water, level_players);
-            check_toxic_block_collisions(toxic, level_players);
-            check_water_water_block_collisions(water, water);
-            check_water_empty_block_collisions(empty_pipes, water);
-            check_water_empty_turn_block_collisions(empty_turn_pipes, water);
-            check_turn_empty_pipes(turn_pipes, empty_turn_pipes);
-            check_multi_turnable_pipe_block_collisions(multi_turn_pipes, level_players);
-            check_water_empty_multi_turn_block_collisions(empty_multi_turn_pipes, water);
-            check_turn_multi_empty_pipes(multi_turn_pipes, empty_multi_turn_pipes);
-            check_collectable_collisions(level_collectables, level_players);
+            check_empty_pipe_block_collisions(empty_pipes, level_players, contacts);
+            check_door_block_collisions(door, level_players, contacts);
+            check_enemy_edge_block_collisions(enemies, on_screen_enemies, edge_sides);
+            check_enemy_player_collisions(enemies, level_players, contacts);
+            check_water_block_collisions(water, level_players, contacts);
+            check_toxic_block_collisions(toxic_list, level_players, contacts);
+            check_water_water_block_collisions(water_pipes);
+            check_water_empty_block_collisions(water_pipes);
+            check_water_empty_turn_block_collisions(water_pipes);
+            check_turn_empty_pipes(water_pipes);
+            check_multi_turnable_pipe_block_collisions(multi_turn_pipes, level_players, contacts);
+            check_water_empty_multi_turn_block_collisions(water_pipes);
+            check_turn_multi_empty_pipes(water_pipes);
+            check_collectable_collisions(level_players, contacts);
         }
 
+        // Debug query for how much the level's arena is holding
+        string get_memory_report()
+        {
+            return this->level_name + ": " + arena.report();
+        };
+
+        // Debug query for how well the solid tiles merged
+        string get_collision_report()
+        {
+            return this->level_name + ": " + solid_merge_report(merge_stats);
+        };
+
         string get_level_name()
         {
             return this->level_name;
@@ -353,12 +1071,9 @@ class MultiPipe : public Level
         MultiPipe(vector<CellSheet> cell_sheets, int tile_size, int players) : Level(cell_sheets, tile_size, players)
         {
             this->level_layers = 4;
-            this->files.push_back("1.txt");
-            this->files.push_back("2.txt");
-            this->files.push_back("3.txt");
-            this->files.push_back("4.txt");
+            this->files = get_level_files(1);
             make_level();
-            this->level_music = music_named("LevelOne");
+            this->level_music = asset_music("LevelOne");
             this->level_name = "Multi-Pipe Madness";
             shared_ptr<Background> backg(new GreyBackground);
             this->background = backg;
@@ -366,7 +1081,7 @@ class MultiPipe : public Level
             this->pre_level_side_text.push_back("Into The Sewers..");
             this->pre_level_side_text.push_back("Hoping To Find..");
             this->pre_level_side_text.push_back("The Answers..");
-            this->pre_level_image = bitmap_named("temp");
+            this->pre_level_image = asset_bitmap("temp");
         };
 };
 
@@ -376,16 +1091,15 @@ class TooManyRoach : public Level
         TooManyRoach(vector<CellSheet> cell_sheets, int tile_size, int players) : Level(cell_sheets, tile_size, players)
         {
             this->level_layers = 2;
-            this->files.push_back("levels/roach_1.txt");
-            this->files.push_back("levels/roach_2.txt");
+            this->files = get_level_files(2);
             make_level();
-            this->level_music = music_named("LevelOne");
+            this->level_music = asset_music("LevelOne");
             this->level_name = "Too Many Roaches";
             shared_ptr<Background> backg(new GreyBackground);
             this->background = backg;
             this->password = "Password";
             this->pre_level_side_text.push_back("Never Too Many");
-            this->pre_level_image = bitmap_named("temp");
+            this->pre_level_image = asset_bitmap("temp");
         };
 };
 
@@ -395,15 +1109,14 @@ class Level3 : public Level
         Level3(vector<CellSheet> cell_sheets, int tile_size, int players) : Level(cell_sheets, tile_size, players)
         {
             this->level_layers = 2;
-            this->files.push_back("levels/level3_1.txt");
-            this->files.push_back("levels/level3_2.txt");
+            this->files = get_level_files(3);
             make_level();
-            this->level_music = music_named("LevelOne");
+            this->level_music = asset_music("LevelOne");
             this->level_name = "Turn and Climb Time";
             shared_ptr<Background> backg(new GreyBackground);
             this->background = backg;
             this->password = "Password";
-            this->pre_level_image = bitmap_named("temp");
+            this->pre_level_image = asset_bitmap("temp");
         };
 };
 
@@ -413,17 +1126,14 @@ class FourCorners : public Level
         FourCorners(vector<CellSheet> cell_sheets, int tile_size, int players) : Level(cell_sheets, tile_size, players)
         {
             this->level_layers = 4;
-            this->files.push_back("levels/4c_1.txt");
-            this->files.push_back("levels/4c_2.txt");
-            this->files.push_back("levels/4c_3.txt");
-            this->files.push_back("levels/4c_4.txt");
+            this->files = get_level_files(4);
             make_level();
-            this->level_music = music_named("ThothTemple.mp3");
+            this->level_music = asset_music("ThothTemple.mp3");
             this->level_name = "The 4 Trials of Thoth";
             shared_ptr<Background> backg(new GreyBackground);
             this->background = backg;
             this->password = "Password";
-            this->pre_level_image = bitmap_named("temp");
+            this->pre_level_image = asset_bitmap("temp");
         };
 };
 
@@ -433,17 +1143,34 @@ class Surf : public Level
         Surf(vector<CellSheet> cell_sheets, int tile_size, int players) : Level(cell_sheets, tile_size, players)
         {
             this->level_layers = 2;
-            this->files.push_back("levels/surf_1.txt");
-            this->files.push_back("levels/surf_2.txt");
+            this->files = get_level_files(5);
             make_level();
-            this->level_music = music_named("LevelOne");
+            this->level_music = asset_music("LevelOne");
             this->level_name = "Slime Surfin'";
             shared_ptr<Background> backg(new DarkBackground);
             this->background = backg;
             this->password = "SURFN";
             this->pre_level_side_text.push_back("Surfin' through the");
             this->pre_level_side_text.push_back("Slime");
-            this->pre_level_image = bitmap_named("SlimeSurf");
+            this->pre_level_image = asset_bitmap("SlimeSurf");
+        };
+};
+
+// The roach level with a spawn for each of four players, only used to time player counts
+class PlayerBench : public Level
+{
+    public:
+        PlayerBench(vector<CellSheet> cell_sheets, int tile_size, int players) : Level(cell_sheets, tile_size, players)
+        {
+            this->level_layers = 2;
+            this->files = get_level_files(6);
+            make_level();
+            this->level_music = asset_music("LevelOne");
+            this->level_name = "Player Bench";
+            shared_ptr<Background> backg(new GreyBackground);
+            this->background = backg;
+            this->password = "";
+            this->pre_level_image = asset_bitmap("temp");
         };
 };
 
@@ -460,11 +1187,11 @@ class BlankLevel : public Level
                 else
                     this->level_name = file_names[i];
             }
-            this->level_music = music_named("LevelOne");
+            this->level_music = asset_music("LevelOne");
             shared_ptr<Background> backg(new GreyBackground);
             this->background = backg;
             make_level();
             this->password = "";
-            this->pre_level_image = bitmap_named("SlimeSurf");
+            this->pre_level_image = asset_bitmap("SlimeSurf");
         };
 };
\ No newline at end of file
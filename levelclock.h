@@ -0,0 +1,103 @@
+#include "splashkit.h"
+#include <string>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// Ticks a level is simulated at each second, the level's timers count in these
+#define LEVEL_TICKS_PER_SECOND 60
+
+// The level clock's timers as they were at one tick
+struct level_clock_snapshot
+{
+    int tick = 0;
+    vector<int> started_at;
+};
+
+// Named timers like SplashKit's, but counting simulated ticks instead of wall time. A tick takes
+// the same time however it is run, so a level simulated faster than real time or simulated again
+// after a rollback sees its timers run out on the same tick every time.
+class LevelClock
+{
+    private:
+        int tick = 0;
+        vector<string> names;
+        vector<int> started_at; // -1 while a timer is stopped
+
+        int find(const string &name)
+        {
+            for (int i = 0; i < names.size(); i++)
+                if (names[i] == name)
+                    return i;
+
+            names.push_back(name);
+            started_at.push_back(-1);
+            return names.size() - 1;
+        };
+
+    public:
+        LevelClock(){};
+
+        ~LevelClock(){};
+
+        // Called once at the start of every simulated tick
+        void advance()
+        {
+            tick += 1;
+        };
+
+        // Does nothing if the timer is already going, as with start_timer
+        void start(const string &name)
+        {
+            int timer = find(name);
+            if (started_at[timer] < 0)
+                started_at[timer] = tick;
+        };
+
+        void stop(const string &name)
+        {
+            started_at[find(name)] = -1;
+        };
+
+        bool started(const string &name)
+        {
+            return started_at[find(name)] >= 0;
+        };
+
+        // Milliseconds the timer has been going, 0 when stopped, as with timer_ticks
+        unsigned int ticks(const string &name)
+        {
+            int timer = find(name);
+            if (started_at[timer] < 0)
+                return 0;
+            return (unsigned int)(tick - started_at[timer]) * 1000 / LEVEL_TICKS_PER_SECOND;
+        };
+
+        void stop_all()
+        {
+            started_at.assign(started_at.size(), -1);
+        };
+
+        void save_state(level_clock_snapshot &snapshot)
+        {
+            snapshot.tick = tick;
+            snapshot.started_at = started_at;
+        };
+
+        // Timers first used after the snapshot was taken are left stopped
+        void restore_state(const level_clock_snapshot &snapshot)
+        {
+            tick = snapshot.tick;
+            for (int i = 0; i < started_at.size(); i++)
+                started_at[i] = i < snapshot.started_at.size() ? snapshot.started_at[i] : -1;
+        };
+};
+
+// The timers of the level being simulated, only ever used from the thread simulating it
+LevelClock &level_clock()
+{
+    static LevelClock clock;
+    return clock;
+}
@@ -11,211 +11,223 @@
 
 using namespace std;
 
+// Layer files of each numbered level, the same numbering get_next_level uses
+vector<string> get_level_files(int level)
+{
+    switch (level)
+    {
+        case 1:
+            return {"1.txt", "2.txt", "3.txt", "4.txt"};
+        case 3:
+            return {"levels/level3_1.txt", "levels/level3_2.txt"};
+        case 4:
+            return {"levels/4c_1.txt", "levels/4c_2.txt", "levels/4c_3.txt", "levels/4c_4.txt"};
+        case 5:
+            return {"levels/surf_1.txt", "levels/surf_2.txt"};
+        case 6:
+            return {"levels/bench4_1.txt", "levels/roach_2.txt"};
+        default:
+            return {"levels/roach_1.txt", "levels/roach_2.txt"};
+    }
+}
+
+// One tile of a layer file that differs from what the level was built from
+struct tile_change
+{
+    int col;
+    int row;
+    int was;
+    int now;
+};
 
-vector<shared_ptr<Block>> make_level_solid_blocks(string file, int tile_size, vector<CellSheet> cell_sheets)
+// Spawns, the door and enemies are only read from the file when the level is built
+bool tile_read_once(int id)
+{
+    return (id > 1200 && id < 1300) || id == 1301 || (id > 1400 && id < 1500);
+}
+
+vector<shared_ptr<Block>> make_level_solid_blocks(LevelArena &arena, LevelOjectsMap &map, vector<CellSheet> cell_sheets)
 {
     vector<shared_ptr<Block>> solid_blocks;
-    LevelOjectsMap map(file, tile_size);
 
     for (int i = 0; i < cell_sheets.size(); i++)
     {
-        solid_blocks = map.get_solid_blocks(solid_blocks, cell_sheets[i].cells, cell_sheets[i].offset);
+        solid_blocks = map.get_solid_blocks(arena, solid_blocks, cell_sheets[i].cells, cell_sheets[i].offset);
     }
 
     return solid_blocks;
 }
 
-vector<shared_ptr<Ladder>> make_level_ladders(string file, int tile_size, vector<CellSheet> cell_sheets)
+vector<shared_ptr<Ladder>> make_level_ladders(LevelArena &arena, LevelOjectsMap &map, vector<CellSheet> cell_sheets)
 {
     vector<shared_ptr<Ladder>> block;
-    LevelOjectsMap map(file, tile_size);
 
     for (int i = 0; i < cell_sheets.size(); i++)
     {
-        block = map.get_ladders(block, cell_sheets[i].cells, cell_sheets[i].offset);
+        block = map.get_ladders(arena, block, cell_sheets[i].cells, cell_sheets[i].offset);
     }
 
     return block;
 }
 
-vector<shared_ptr<WaterBlock>> make_level_water(string file, int tile_size, vector<CellSheet> cell_sheets)
+vector<shared_ptr<WaterBlock>> make_level_water(LevelArena &arena, LevelOjectsMap &map, vector<CellSheet> cell_sheets)
 {
     vector<shared_ptr<WaterBlock>> block;
-    LevelOjectsMap map(file, tile_size);
 
     for (int i = 0; i < cell_sheets.size(); i++)
     {
-        block = map.get_water(block, cell_sheets[i].cells, cell_sheets[i].offset);
+        block = map.get_water(arena, block, cell_sheets[i].cells, cell_sheets[i].offset);
     }
 
     return block;
 }
 
-vector<shared_ptr<ToxicBlock>> make_level_toxic(string file, int tile_size, vector<CellSheet> cell_sheets)
+vector<shared_ptr<ToxicBlock>> make_level_toxic(LevelArena &arena, LevelOjectsMap &map, vector<CellSheet> cell_sheets)
 {
     vector<shared_ptr<ToxicBlock>> block;
-    LevelOjectsMap map(file, tile_size);
 
     for (int i = 0; i < cell_sheets.size(); i++)
     {
-        block = map.get_toxic(block, cell_sheets[i].cells, cell_sheets[i].offset);
+        block = map.get_toxic(arena, block, cell_sheets[i].cells, cell_sheets[i].offset);
     }
 
     return block;
 }
 
-vector<shared_ptr<HoldablePipeBlock>> make_holdable_pipes(string file, int tile_size, vector<CellSheet> cell_sheets)
+vector<shared_ptr<HoldablePipeBlock>> make_holdable_pipes(LevelArena &arena, LevelOjectsMap &map, vector<CellSheet> cell_sheets)
 {
     vector<shared_ptr<HoldablePipeBlock>> block;
-    LevelOjectsMap map(file, tile_size);
 
     for (int i = 0; i < cell_sheets.size(); i++)
     {
-        block = map.get_holdable_pipes(block, cell_sheets[i].cells, cell_sheets[i].offset);
+        block = map.get_holdable_pipes(arena, block, cell_sheets[i].cells, cell_sheets[i].offset);
     }
 
     return block;
 }
 
-vector<shared_ptr<TurnablePipeBlock>> make_turnable_pipes(string file, int tile_size, vector<CellSheet> cell_sheets)
+vector<shared_ptr<TurnablePipeBlock>> make_turnable_pipes(LevelArena &arena, LevelOjectsMap &map, vector<CellSheet> cell_sheets)
 {
     vector<shared_ptr<TurnablePipeBlock>> block;
-    LevelOjectsMap map(file, tile_size);
 
     for (int i = 0; i < cell_sheets.size(); i++)
     {
-        block = map.get_turnable_pipes(block, cell_sheets[i].cells, cell_sheets[i].offset);
+        block = map.get_turnable_pipes(arena, block, cell_sheets[i].cells, cell_sheets[i].offset);
     }
 
     return block;
 }
 
-vector<shared_ptr<MultiTurnablePipeBlock>> make_multi_turnable_pipes(string file, int tile_size, vector<CellSheet> cell_sheets)
+vector<shared_ptr<MultiTurnablePipeBlock>> make_multi_turnable_pipes(LevelArena &arena, LevelOjectsMap &map, vector<CellSheet> cell_sheets)
 {
     vector<shared_ptr<MultiTurnablePipeBlock>> block;
-    LevelOjectsMap map(file, tile_size);
 
     for (int i = 0; i < cell_sheets.size(); i++)
     {
-        block = map.get_multi_turnable_pipes(block, cell_sheets[i].cells, cell_sheets[i].offset);
+        block = map.get_multi_turnable_pipes(arena, block, cell_sheets[i].cells, cell_sheets[i].offset);
     }
 
     return block;
 }
 
-vector<shared_ptr<EmptyPipeBlock>> make_holdable_pipe_empty_spaces(string file, int tile_size, vector<CellSheet> cell_sheets)
+vector<shared_ptr<EmptyPipeBlock>> make_holdable_pipe_empty_spaces(LevelArena &arena, LevelOjectsMap &map, vector<CellSheet> cell_sheets)
 {
     vector<shared_ptr<EmptyPipeBlock>> block;
-    LevelOjectsMap map(file, tile_size);
 
     for (int i = 0; i < cell_sheets.size(); i++)
     {
-        block = map.get_empty_pipe_blocks(block, cell_sheets[i].cells, cell_sheets[i].offset);
+        block = map.get_empty_pipe_blocks(arena, block, cell_sheets[i].cells, cell_sheets[i].offset);
     }
 
     return block;
 }
 
-vector<shared_ptr<EdgeBlock>> make_edges(string file, int tile_size, vector<CellSheet> cell_sheets)
+vector<shared_ptr<EdgeBlock>> make_edges(LevelArena &arena, LevelOjectsMap &map, vector<CellSheet> cell_sheets)
 {
     vector<shared_ptr<EdgeBlock>> block;
-    LevelOjectsMap map(file, tile_size);
 
     for (int i = 0; i < cell_sheets.size(); i++)
     {
-        block = map.get_edges(block, cell_sheets[i].cells, cell_sheets[i].offset);
+        block = map.get_edges(arena, block, cell_sheets[i].cells, cell_sheets[i].offset);
     }
 
     return block;
 }
 
-vector<shared_ptr<Collectable>> make_level_collectables(string file, int tile_size, vector<CellSheet> cell_sheets)
+vector<shared_ptr<Collectable>> make_level_collectables(LevelArena &arena, LevelOjectsMap &map, vector<CellSheet> cell_sheets)
 {
     vector<shared_ptr<Collectable>> collect;
-    LevelOjectsMap map(file, tile_size);
 
     for (int i = 0; i < cell_sheets.size(); i++)
     {
-        collect = map.get_collectables(collect, cell_sheets[i].cells, cell_sheets[i].offset);
+        collect = map.get_collectables(arena, collect, cell_sheets[i].cells, cell_sheets[i].offset);
     }
 
     return collect;
 }
 
-vector<shared_ptr<EmptyTurnBlock>> make_turnable_pipe_empty_spaces(string file, int tile_size, vector<CellSheet> cell_sheets)
+vector<shared_ptr<EmptyTurnBlock>> make_turnable_pipe_empty_spaces(LevelArena &arena, LevelOjectsMap &map, vector<CellSheet> cell_sheets)
 {
     vector<shared_ptr<EmptyTurnBlock>> block;
-    LevelOjectsMap map(file, tile_size);
 
     for (int i = 0; i < cell_sheets.size(); i++)
     {
-        block = map.get_empty_turn_blocks(block, cell_sheets[i].cells, cell_sheets[i].offset);
+        block = map.get_empty_turn_blocks(arena, block, cell_sheets[i].cells, cell_sheets[i].offset);
     }
 
     return block;
 }
 
-vector<shared_ptr<EmptyMultiTurnBlock>> make_multi_turnable_pipe_empty_spaces(string file, int tile_size, vector<CellSheet> cell_sheets)
+vector<shared_ptr<EmptyMultiTurnBlock>> make_multi_turnable_pipe_empty_spaces(LevelArena &arena, LevelOjectsMap &map, vector<CellSheet> cell_sheets)
 {
     vector<shared_ptr<EmptyMultiTurnBlock>> block;
-    LevelOjectsMap map(file, tile_size);
 
     for (int i = 0; i < cell_sheets.size(); i++)
     {
-        block = map.get_empty_multi_turn_blocks(block, cell_sheets[i].cells, cell_sheets[i].offset);
+        block = map.get_empty_multi_turn_blocks(arena, block, cell_sheets[i].cells, cell_sheets[i].offset);
     }
 
     return block;
 }
 
-vector<shared_ptr<Block>> make_level_decoration(string file, int tile_size, vector<CellSheet> cell_sheets)
+vector<shared_ptr<Block>> make_level_decoration(LevelArena &arena, LevelOjectsMap &map, vector<CellSheet> cell_sheets)
 {
     vector<shared_ptr<Block>> block;
-    LevelOjectsMap map(file, tile_size);
 
     for (int i = 0; i < cell_sheets.size(); i++)
     {
-        block = map.get_decoration(block, cell_sheets[i].cells, cell_sheets[i].offset);
+        block = map.get_decoration(arena, block, cell_sheets[i].cells, cell_sheets[i].offset);
     }
 
     return block;
 }
 
-vector<shared_ptr<Enemy>> make_layer_enemies(vector<shared_ptr<Enemy>> level_enemy, string file, int tile_size, vector<std::shared_ptr<Player>> level_players)
+void make_layer_enemies(EnemySystem &enemies, LevelOjectsMap &map)
 {
-    LevelOjectsMap map(file, tile_size);
-
-    level_enemy = map.get_enemies(level_enemy, level_players);
-
-    return level_enemy;
+    map.get_enemies(enemies);
 }
 
-shared_ptr<Player> make_level_player(string file, int tile_size, int player_number)
+shared_ptr<Player> make_level_player(LevelOjectsMap &map, int slot, int players)
 {
     shared_ptr<Player> player;
 
-    LevelOjectsMap map(file, tile_size);
-    player = map.get_player_position(player_number);
+    player = map.get_player_position(slot, players);
 
     return player;
 }
 
-shared_ptr<DoorBlock> make_level_door(string file, int tile_size, bitmap cell_sheet)
+shared_ptr<DoorBlock> make_level_door(LevelArena &arena, LevelOjectsMap &map, bitmap cell_sheet)
 {
     shared_ptr<DoorBlock> door;
 
-    LevelOjectsMap map(file, tile_size);
-    door = map.get_door(cell_sheet);
+    door = map.get_door(arena, cell_sheet);
 
     return door;
 }
 
-shared_ptr<Camera> make_level_camera(shared_ptr<Player> player, string file, int tile_size)
+// Map size in tiles
+shared_ptr<Camera> make_level_camera(shared_ptr<Player> player, int tile_size, int map_width, int map_height)
 {
-    LevelOjectsMap map(file, tile_size);
-    int map_width = map.get_map_width();
-    int map_height = map.get_map_height();
-
     shared_ptr<Camera> camera(new Camera(player, tile_size, map_height, map_width));
 
     return camera;
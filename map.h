@@ -1,5 +1,6 @@
 // Map Class
 #include "splashkit.h"
+#include "assetpack.h"
 #include "enemy.h"
 #include <fstream>
 #include <iostream>
@@ -7,6 +8,8 @@
 #include <memory>
 #include "block.h"
 #include "collectable.h"
+#include "arena.h"
+#include "sparselayer.h"
 using namespace std;
 
 #pragma once
@@ -18,7 +21,8 @@ using namespace std;
 class LevelOjectsMap
 {
     protected:
-        vector<vector<int> > map_array;
+        // Only the tiles that aren't empty, most upper layers are nearly all empty
+        SparseLayer layer;
         int tile_size = 64;
         int map_width;
         int map_height;
@@ -33,53 +37,25 @@ class LevelOjectsMap
         /**
          * @brief Destructor
          */
-        ~LevelOjectsMap()
-        {
-            //write_line("Deleting Map");
-            map_array.clear();
-        };
+        ~LevelOjectsMap(){};
 
         LevelOjectsMap(string level, int tile_size)
         {
             this->tile_size = tile_size;
-            check_map_dimensions(level);
-            this->map_array = new_level(level);
+            this->layer = load_sparse_layer(level);
+            this->map_width = layer.get_width();
+            this->map_height = layer.get_height();
         };
-            
-        void check_map_dimensions(string file)
-        {
-            ifstream map_level;
-            std::string line;
-            int y_count = 0;
-            int x_count = 0;
-
-            map_level.open(file);
-
-            if(map_level.fail())
-            {
-                write_line("Error");
-                cerr << "Error Opening File" << endl;
-                exit(1);
-            }
-
-            while(std::getline(map_level, line))
-            {
-                std::istringstream iss(line);
-
-                int i;
-                x_count = 0;
-                
-                while(iss >> i)
-                {
-                    x_count += 1;
-                }
-                y_count += 1;
-            }
-
-            map_level.close();
 
-            this->map_height = y_count;
-            this->map_width = x_count;
+        /**
+         * @brief Map of tiles already read, such as the changed tiles of a layer file
+         */
+        LevelOjectsMap(SparseLayer layer, int tile_size)
+        {
+            this->tile_size = tile_size;
+            this->layer = layer;
+            this->map_width = layer.get_width();
+            this->map_height = layer.get_height();
         };
 
         int get_map_width()
@@ -92,571 +68,394 @@ class LevelOjectsMap
             return this->map_height;
         };
 
-        vector<vector<int> > new_level(string file)
+        // Where the first tile with the id is, false if the map has none
+        bool find_tile(int tile, point_2d &position)
         {
-            // Initialise a 2D matrix of int to store level design  
-            vector<vector<int> > map;
-
-            // load in the level layout from file
-            ifstream map_level;
-            map_level.open(file);
-
-            // Check for errors
-            if(map_level.fail())
-            {
-                write_line("Error");
-                cerr << "Error Opening File" << endl;
-                exit(1);
-            }
-
-            // initialise a vector of strings to store each line of text
-            vector<int> map_line;
-            int temp;
-
-            for (int i = 0; i < this->map_height; i++)
-            {
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    map_level >> temp;
-                    map_line.push_back(temp);
-                }
-                // pushback line
-                map.push_back(map_line);
-                map_level.ignore();
-                map_line.clear();
-            }
-            map_level.close();
-            return map;
+            bool found = false;
+            layer.for_each_tile(tile, tile, [&](int col, int row, int) {
+                if (found)
+                    return;
+
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
+                found = true;
+            });
+
+            return found;
         };
 
-        shared_ptr<Player> get_player_position(int player_number)
+        // The player for a slot, on spawn tile 1201 + slot. Maps made for two players have no tiles
+        // past 1202, anyone after the first two shares their spawns.
+        shared_ptr<Player> get_player_position(int slot, int players)
         {
             point_2d position;
             shared_ptr<Player> player;
 
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
-
-                    if(this->map_array[i][j] == 1201)
-                    {
-                        if(player_number == 1)
-                        {
-                            sprite player_sprite = create_sprite("blueGuy", "PlayerAnim");
-                            player_input input = make_player1_input();
-                            shared_ptr<Player> player(new Player(new IdleState, player_sprite, position, false, input));
-                            player->set_player_id(1);
-                            return player;
-                        }
-                        if(player_number == 3)
-                        {
-                            sprite player_sprite = create_sprite("purpleGuy", "PlayerAnim");
-                            player_input input = make_player1_input();
-                            shared_ptr<Player> player(new Player(new IdleState, player_sprite, position, false, input));
-                            player->set_player_id(3);
-                            return player;
-                        }
-                    }
-                    if(this->map_array[i][j] == 1202)
-                    {
-                        if(player_number == 2)
-                        {
-                            sprite player_sprite = create_sprite("pinkGirl", "PlayerAnim");
-                            player_input input = make_player2_input();
-                            shared_ptr<Player> player(new Player(new IdleState, player_sprite, position, false, input));
-                            player->set_player_id(2);
-                            return player;
-                        }
-                    }
-                }
+            if(!find_tile(1201 + slot, position) && !find_tile(1201 + slot % 2, position))
+                return player;
 
+            int character = player_character(slot, players);
+            sprite player_sprite = create_sprite(asset_bitmap(player_sprite_name(character)), asset_animation("PlayerAnim"));
+            player_input input = make_player_input(slot);
+            player = shared_ptr<Player>(new Player(new IdleState, player_sprite, position, false, input));
+            player->set_player_id(character);
+            player->set_slot(slot);
             return player;
         };
 
-        shared_ptr<DoorBlock> get_door(bitmap cell_sheet)
+        shared_ptr<DoorBlock> get_door(LevelArena &arena, bitmap cell_sheet)
         {
-            point_2d position;
             shared_ptr<DoorBlock> door;
 
-            for (int i = 0; i < this->map_height; i++)
-            {
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
+            // The last door wins when a map has more than one
+            layer.for_each_tile(1301, 1301, [&](int col, int row, int) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-                    if(this->map_array[i][j] == 1301)
-                    {
-                        shared_ptr<DoorBlock> level_door(new DoorBlock(cell_sheet, position));
-                        door = level_door;
-                    }
-                }
-            }
+                shared_ptr<DoorBlock> level_door = arena.make<DoorBlock>(cell_sheet, position);
+                door = level_door;
+            });
 
             return door;
         };
         
 
-        vector<shared_ptr<Enemy>> get_enemies(vector<shared_ptr<Enemy>> level_enemies, vector<std::shared_ptr<Player>> level_players)
+        void get_enemies(EnemySystem &enemies)
         {
-            point_2d position;
+            layer.for_each_tile(1401, 1408, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
+
+                if(id == 1401)
+                    enemies.spawn(ENEMY_ROACH, position, false);
+                if(id == 1402)
+                    enemies.spawn(ENEMY_ROACH, position, true);
+                if(id == 1403)
+                    enemies.spawn(ENEMY_SNAKE, position, false);
+                if(id == 1404)
+                    enemies.spawn(ENEMY_SNAKE, position, true);
+                if(id == 1405)
+                    enemies.spawn(ENEMY_RAT, position, false);
+                if(id == 1406)
+                    enemies.spawn(ENEMY_RAT, position, true);
+                if(id == 1407)
+                    enemies.spawn(ENEMY_BLOB, position, true);
+                if(id == 1408)
+                    enemies.spawn(ENEMY_BLOB, position, false);
+            });
+        };
 
-             for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
+        vector<shared_ptr<Block>> get_solid_blocks(LevelArena &arena, vector<shared_ptr<Block>> solid_blocks, bitmap cell_sheet, int offset)
+        {
+            // Only the runs with this sheet's ids are visited
+            layer.for_each_tile(offset + 1, offset + SPARSE_IDS_PER_SHEET, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-                    if(this->map_array[i][j] == 1401)
-                    {
-                        sprite roach = create_sprite("Roach", "RoachAnim");
-                        shared_ptr<Roach> cockroach(new Roach(roach, position, level_players));
-                        cockroach->get_ai()->set_facing_left(false);
-                        level_enemies.push_back(cockroach);
-                    }
-                    if(this->map_array[i][j] == 1402)
-                    {
-                        sprite roach = create_sprite("Roach", "RoachAnim");
-                        shared_ptr<Roach> cockroach(new Roach(roach, position, level_players));
-                        cockroach->get_ai()->set_facing_left(true);
-                        level_enemies.push_back(cockroach);
-                    }
+                int cell = (id - 1) - offset;
 
-                    if(this->map_array[i][j] == 1403)
-                    {
-                        sprite snake = create_sprite("Snake", "SnakeAnim");
-                        shared_ptr<Snake> ssnake(new Snake(snake, position, level_players));
-                        ssnake->get_ai()->set_facing_left(false);
-                        level_enemies.push_back(ssnake);
-                    }
-                    if(this->map_array[i][j] == 1404)
-                    {
-                        sprite snake = create_sprite("Snake", "SnakeAnim");
-                        shared_ptr<Snake> ssnake(new Snake(snake, position, level_players));
-                        ssnake->get_ai()->set_facing_left(true);
-                        level_enemies.push_back(ssnake);
-                    }
-                    if(this->map_array[i][j] == 1405)
-                    {
-                        sprite rat = create_sprite("Rat", "RatAnim");
-                        shared_ptr<Rat> chubbyrat(new Rat(rat, position, level_players));
-                        chubbyrat->get_ai()->set_facing_left(false);
-                        level_enemies.push_back(chubbyrat);
-                    }
-                    if(this->map_array[i][j] == 1406)
-                    {
-                        sprite rat = create_sprite("Rat", "RatAnim");
-                        shared_ptr<Rat> chubbyrat(new Rat(rat, position, level_players));
-                        chubbyrat->get_ai()->set_facing_left(true);
-                        level_enemies.push_back(chubbyrat);
-                    }
-                    if(this->map_array[i][j] == 1407)
+                if(bitmap_name(cell_sheet) == "Solid")
+                {
+                    if(id < bitmap_cell_count(cell_sheet) + 1)
                     {
-                        sprite blob = create_sprite("Blob", "BlobAnim");
-                        shared_ptr<Blob> bblob(new Blob(blob, position, level_players));
-                        bblob->get_ai()->set_facing_left(true);
-                        level_enemies.push_back(bblob);
+                        shared_ptr<Block> block = arena.make<SolidBlock>(cell_sheet, position, cell);
+                        solid_blocks.push_back(block);
                     }
-                    if(this->map_array[i][j] == 1408)
+                }
+                if(bitmap_name(cell_sheet) == "HalfBlocksTop")
+                {
+                    if(id < bitmap_cell_count(cell_sheet) + 1 + offset)
                     {
-                        sprite blob = create_sprite("Blob", "BlobAnim");
-                        shared_ptr<Blob> bblob(new Blob(blob, position, level_players));
-                        bblob->get_ai()->set_facing_left(false);
-                        level_enemies.push_back(bblob);
+                        shared_ptr<Block> block = arena.make<HalfSolidBlockTop>(cell_sheet, position, cell);
+                        solid_blocks.push_back(block);
                     }
                 }
-
-            return level_enemies;
-        };
-
-        vector<shared_ptr<Block>> get_solid_blocks(vector<shared_ptr<Block>> solid_blocks, bitmap cell_sheet, int offset)
-        {
-            point_2d position;
-
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
+                if(bitmap_name(cell_sheet) == "HalfBlocksBottom")
                 {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
-
-                    int cell = ((this->map_array[i][j]) - 1) - offset;
-
-                    if(this->map_array[i][j] > offset)
+                    if(id < bitmap_cell_count(cell_sheet) + 1 + offset)
                     {
-                        if(bitmap_name(cell_sheet) == "Solid")
-                        {
-                            if(this->map_array[i][j] < bitmap_cell_count(cell_sheet) + 1)
-                            {
-                                shared_ptr<Block> block(new SolidBlock(cell_sheet, position, cell));
-                                solid_blocks.push_back(block);
-                            }
-                        }
-                        if(bitmap_name(cell_sheet) == "HalfBlocksTop")
-                        {
-                            if(this->map_array[i][j] < bitmap_cell_count(cell_sheet) + 1 + offset)
-                            {
-                                shared_ptr<Block> block(new HalfSolidBlockTop(cell_sheet, position, cell));
-                                solid_blocks.push_back(block);
-                            }
-                        }
-                        if(bitmap_name(cell_sheet) == "HalfBlocksBottom")
-                        {
-                            if(this->map_array[i][j] < bitmap_cell_count(cell_sheet) + 1 + offset)
-                            {
-                                shared_ptr<Block> block(new HalfSolidBlockBottom(cell_sheet, position, cell));
-                                solid_blocks.push_back(block);
-                            }
-                        }
+                        shared_ptr<Block> block = arena.make<HalfSolidBlockBottom>(cell_sheet, position, cell);
+                        solid_blocks.push_back(block);
                     }
                 }
+            });
 
             return solid_blocks;
         }
 
-        vector<shared_ptr<EdgeBlock>> get_edges(vector<shared_ptr<EdgeBlock>> edge_blocks, bitmap cell_sheet, int offset)
+        vector<shared_ptr<EdgeBlock>> get_edges(LevelArena &arena, vector<shared_ptr<EdgeBlock>> edge_blocks, bitmap cell_sheet, int offset)
         {
-            point_2d position;
-
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
+            layer.for_each_tile(offset + 1, offset + SPARSE_IDS_PER_SHEET, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-                    int cell = ((this->map_array[i][j]) - 1) - offset;
+                int cell = (id - 1) - offset;
 
-                    if(this->map_array[i][j] > offset)
+                if(bitmap_name(cell_sheet) == "Edge")
+                {
+                    if(id < bitmap_cell_count(cell_sheet) + 1 + offset)
                     {
-                        if(bitmap_name(cell_sheet) == "Edge")
-                        {
-                            if(this->map_array[i][j] < bitmap_cell_count(cell_sheet) + 1 + offset)
-                            {
-                                shared_ptr<EdgeBlock> block(new EdgeBlock(cell_sheet, position, cell));
-                                edge_blocks.push_back(block);
-                            }
-                        }
+                        shared_ptr<EdgeBlock> block = arena.make<EdgeBlock>(cell_sheet, position, cell);
+                        edge_blocks.push_back(block);
                     }
                 }
+            });
 
             return edge_blocks;
         }
 
-        vector<shared_ptr<Block>> get_decoration(vector<shared_ptr<Block>> decoration_blocks, bitmap cell_sheet, int offset)
+        vector<shared_ptr<Block>> get_decoration(LevelArena &arena, vector<shared_ptr<Block>> decoration_blocks, bitmap cell_sheet, int offset)
         {
-            point_2d position;
-
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
+            layer.for_each_tile(offset + 1, offset + SPARSE_IDS_PER_SHEET, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-                    int cell = ((this->map_array[i][j]) - 1) - offset;
+                int cell = (id - 1) - offset;
 
-                    if(this->map_array[i][j] > offset)
+                if(bitmap_name(cell_sheet) == "Pipe")
+                {
+                    if(id < (bitmap_cell_count(cell_sheet) + 1) + offset)
+                    {
+                        shared_ptr<Block> block = arena.make<PipeBlock>(cell_sheet, position, cell);
+                        decoration_blocks.push_back(block);
+                    }
+                }
+                if(bitmap_name(cell_sheet) == "Decorative")
+                {
+                    if(id < (bitmap_cell_count(cell_sheet) + 1) + offset)
                     {
-                        if(bitmap_name(cell_sheet) == "Pipe")
-                        {
-                            if(this->map_array[i][j] < (bitmap_cell_count(cell_sheet) + 1) + offset)
-                            {
-                                shared_ptr<Block> block(new PipeBlock(cell_sheet, position, cell));
-                                decoration_blocks.push_back(block);
-                            }
-                        }
-                        if(bitmap_name(cell_sheet) == "Decorative")
-                        {
-                            if(this->map_array[i][j] < (bitmap_cell_count(cell_sheet) + 1) + offset)
-                            {
-                                shared_ptr<Block> block(new DecorativeBlock(cell_sheet, position, cell));
-                                decoration_blocks.push_back(block);
-                            }
-                        }
+                        shared_ptr<Block> block = arena.make<DecorativeBlock>(cell_sheet, position, cell);
+                        decoration_blocks.push_back(block);
                     }
                 }
+            });
 
             return decoration_blocks;
         }
 
-        vector<shared_ptr<WaterBlock>> get_water(vector<shared_ptr<WaterBlock>> water_blocks, bitmap cell_sheet, int offset)
+        vector<shared_ptr<WaterBlock>> get_water(LevelArena &arena, vector<shared_ptr<WaterBlock>> water_blocks, bitmap cell_sheet, int offset)
         {
-            point_2d position;
+            layer.for_each_tile(offset + 1, offset + SPARSE_IDS_PER_SHEET, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
-
-                    int cell = ((this->map_array[i][j]) - 1) - offset;
+                int cell = (id - 1) - offset;
 
-                    if(this->map_array[i][j] > offset)
+                if(bitmap_name(cell_sheet) == "Water")
+                {
+                    if(id < (bitmap_cell_count(cell_sheet) + 1) + offset)
                     {
-                        if(bitmap_name(cell_sheet) == "Water")
-                        {
-                            if(this->map_array[i][j] < (bitmap_cell_count(cell_sheet) + 1) + offset)
-                            {
-                                shared_ptr<WaterBlock> block(new WaterBlock(cell_sheet, position, cell));
-                                water_blocks.push_back(block);
-                            }
-                        }
+                        shared_ptr<WaterBlock> block = arena.make<WaterBlock>(cell_sheet, position, cell);
+                        water_blocks.push_back(block);
                     }
                 }
+            });
 
             return water_blocks;
         }
 
-        vector<shared_ptr<ToxicBlock>> get_toxic(vector<shared_ptr<ToxicBlock>> toxic_blocks, bitmap cell_sheet, int offset)
+        vector<shared_ptr<ToxicBlock>> get_toxic(LevelArena &arena, vector<shared_ptr<ToxicBlock>> toxic_blocks, bitmap cell_sheet, int offset)
         {
-            point_2d position;
+            layer.for_each_tile(offset + 1, offset + SPARSE_IDS_PER_SHEET, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
-
-                    int cell = ((this->map_array[i][j]) - 1) - offset;
+                int cell = (id - 1) - offset;
 
-                    if(this->map_array[i][j] > offset)
+                if(bitmap_name(cell_sheet) == "Toxic")
+                {
+                    if(id < (bitmap_cell_count(cell_sheet) + 1) + offset)
                     {
-                        if(bitmap_name(cell_sheet) == "Toxic")
-                        {
-                            if(this->map_array[i][j] < (bitmap_cell_count(cell_sheet) + 1) + offset)
-                            {
-                                shared_ptr<ToxicBlock> block(new ToxicBlock(cell_sheet, position, cell));
-                                toxic_blocks.push_back(block);
-                            }
-                        }
+                        shared_ptr<ToxicBlock> block = arena.make<ToxicBlock>(cell_sheet, position, cell);
+                        toxic_blocks.push_back(block);
                     }
                 }
+            });
 
             return toxic_blocks;
         }
 
-        vector<shared_ptr<Collectable>> get_collectables(vector<shared_ptr<Collectable>> collectables, bitmap cell_sheet, int offset)
+        vector<shared_ptr<Collectable>> get_collectables(LevelArena &arena, vector<shared_ptr<Collectable>> collectables, bitmap cell_sheet, int offset)
         {
-            point_2d position;
-
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
+            layer.for_each_tile(offset + 1, offset + SPARSE_IDS_PER_SHEET, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-                    int cell = ((this->map_array[i][j]) - 1) - offset;
+                int cell = (id - 1) - offset;
 
-                    if(this->map_array[i][j] > offset)
+                //Less then 3?
+                if(bitmap_name(cell_sheet) == "Collect")
+                {
+                    if(id < (bitmap_cell_count(cell_sheet) + 1) + offset)
                     {
-                        //Less then 3?
-                        if(bitmap_name(cell_sheet) == "Collect")
-                        {
-                            if(this->map_array[i][j] < (bitmap_cell_count(cell_sheet) + 1) + offset)
-                            {
-                                shared_ptr<Collectable> block(new HeartCollectable(cell_sheet, position, cell));
-                                collectables.push_back(block);
-                            }
-                        }
+                        shared_ptr<Collectable> block = arena.make<HeartCollectable>(cell_sheet, position, cell);
+                        collectables.push_back(block);
                     }
                 }
+            });
 
             return collectables;
         }
 
-        vector<shared_ptr<HoldablePipeBlock>> get_holdable_pipes(vector<shared_ptr<HoldablePipeBlock>> hold_pipes, bitmap cell_sheet, int offset)
+        vector<shared_ptr<HoldablePipeBlock>> get_holdable_pipes(LevelArena &arena, vector<shared_ptr<HoldablePipeBlock>> hold_pipes, bitmap cell_sheet, int offset)
         {
-            point_2d position;
-
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
+            layer.for_each_tile(offset + 1, offset + SPARSE_IDS_PER_SHEET, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-                    int cell = ((this->map_array[i][j]) - 1) - offset;
+                int cell = (id - 1) - offset;
 
-                    if(this->map_array[i][j] > offset)
+                if(bitmap_name(cell_sheet) == "HoldPipes")
+                {
+                    if(id < (bitmap_cell_count(cell_sheet) + 1) + offset)
                     {
-                        if(bitmap_name(cell_sheet) == "HoldPipes")
-                        {
-                            if(this->map_array[i][j] < (bitmap_cell_count(cell_sheet) + 1) + offset)
-                            {
-                                shared_ptr<HoldablePipeBlock> block(new HoldablePipeBlock(cell_sheet, position, cell));
-                                hold_pipes.push_back(block);
-                            }
-                        }
+                        shared_ptr<HoldablePipeBlock> block = arena.make<HoldablePipeBlock>(cell_sheet, position, cell);
+                        hold_pipes.push_back(block);
                     }
                 }
+            });
 
             return hold_pipes;
         }
 
-        vector<shared_ptr<TurnablePipeBlock>> get_turnable_pipes(vector<shared_ptr<TurnablePipeBlock>> hold_pipes, bitmap cell_sheet, int offset)
+        vector<shared_ptr<TurnablePipeBlock>> get_turnable_pipes(LevelArena &arena, vector<shared_ptr<TurnablePipeBlock>> hold_pipes, bitmap cell_sheet, int offset)
         {
-            point_2d position;
+            layer.for_each_tile(offset + 1, offset + SPARSE_IDS_PER_SHEET, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
+                int cell = (id - 1) - offset;
 
-                    int cell = ((this->map_array[i][j]) - 1) - offset;
-
-                    if(this->map_array[i][j] > offset)
+                if(bitmap_name(cell_sheet) == "TurnPipes")
+                {
+                    if(id < (bitmap_cell_count(cell_sheet) + 1) + offset)
                     {
-                        if(bitmap_name(cell_sheet) == "TurnPipes")
-                        {
-                            if(this->map_array[i][j] < (bitmap_cell_count(cell_sheet) + 1) + offset)
-                            {
-                                shared_ptr<TurnablePipeBlock> block(new TurnablePipeBlock(cell_sheet, position, cell));
-                                hold_pipes.push_back(block);
-                            }
-                        }
+                        shared_ptr<TurnablePipeBlock> block = arena.make<TurnablePipeBlock>(cell_sheet, position, cell);
+                        hold_pipes.push_back(block);
                     }
                 }
+            });
 
             return hold_pipes;
         }
 
-        vector<shared_ptr<MultiTurnablePipeBlock>> get_multi_turnable_pipes(vector<shared_ptr<MultiTurnablePipeBlock>> hold_pipes, bitmap cell_sheet, int offset)
+        vector<shared_ptr<MultiTurnablePipeBlock>> get_multi_turnable_pipes(LevelArena &arena, vector<shared_ptr<MultiTurnablePipeBlock>> hold_pipes, bitmap cell_sheet, int offset)
         {
-            point_2d position;
+            layer.for_each_tile(offset + 1, offset + SPARSE_IDS_PER_SHEET, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
-
-                    int cell = ((this->map_array[i][j]) - 1) - offset;
+                int cell = (id - 1) - offset;
 
-                    if(this->map_array[i][j] > offset)
+                if(bitmap_name(cell_sheet) == "MultiPipes")
+                {
+                    if(id < (bitmap_cell_count(cell_sheet) + 1) + offset)
                     {
-                        if(bitmap_name(cell_sheet) == "MultiPipes")
-                        {
-                            if(this->map_array[i][j] < (bitmap_cell_count(cell_sheet) + 1) + offset)
-                            {
-                                shared_ptr<MultiTurnablePipeBlock> block(new MultiTurnablePipeBlock(cell_sheet, position, cell));
-                                hold_pipes.push_back(block);
-                            }
-                        }
+                        shared_ptr<MultiTurnablePipeBlock> block = arena.make<MultiTurnablePipeBlock>(cell_sheet, position, cell);
+                        hold_pipes.push_back(block);
                     }
                 }
+            });
 
             return hold_pipes;
         }
 
-        vector<shared_ptr<EmptyPipeBlock>> get_empty_pipe_blocks(vector<shared_ptr<EmptyPipeBlock>> empty_pipes, bitmap cell_sheet, int offset)
+        vector<shared_ptr<EmptyPipeBlock>> get_empty_pipe_blocks(LevelArena &arena, vector<shared_ptr<EmptyPipeBlock>> empty_pipes, bitmap cell_sheet, int offset)
         {
-            point_2d position;
-
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
+            layer.for_each_tile(offset + 1, offset + SPARSE_IDS_PER_SHEET, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-                    int cell = ((this->map_array[i][j]) - 1) - offset;
+                int cell = (id - 1) - offset;
 
-                    if(this->map_array[i][j] > offset)
+                if(bitmap_name(cell_sheet) == "EmptyHold")
+                {
+                    if(id < (bitmap_cell_count(cell_sheet) + 1) + offset)
                     {
-                        if(bitmap_name(cell_sheet) == "EmptyHold")
-                        {
-                            if(this->map_array[i][j] < (bitmap_cell_count(cell_sheet) + 1) + offset)
-                            {
-                                shared_ptr<EmptyPipeBlock> block(new EmptyPipeBlock(cell_sheet, position, cell));
-                                empty_pipes.push_back(block);
-                            }
-                        }
+                        shared_ptr<EmptyPipeBlock> block = arena.make<EmptyPipeBlock>(cell_sheet, position, cell);
+                        empty_pipes.push_back(block);
                     }
                 }
+            });
 
             return empty_pipes;
         }
 
-        vector<shared_ptr<EmptyTurnBlock>> get_empty_turn_blocks(vector<shared_ptr<EmptyTurnBlock>> empty_pipes, bitmap cell_sheet, int offset)
+        vector<shared_ptr<EmptyTurnBlock>> get_empty_turn_blocks(LevelArena &arena, vector<shared_ptr<EmptyTurnBlock>> empty_pipes, bitmap cell_sheet, int offset)
         {
-            point_2d position;
-
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
+            layer.for_each_tile(offset + 1, offset + SPARSE_IDS_PER_SHEET, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-                    int cell = ((this->map_array[i][j]) - 1) - offset;
+                int cell = (id - 1) - offset;
 
-                    if(this->map_array[i][j] > offset)
+                if(bitmap_name(cell_sheet) == "EmptyTurn")
+                {
+                    if(id < (bitmap_cell_count(cell_sheet) + 1) + offset)
                     {
-                        if(bitmap_name(cell_sheet) == "EmptyTurn")
-                        {
-                            if(this->map_array[i][j] < (bitmap_cell_count(cell_sheet) + 1) + offset)
-                            {
-                                shared_ptr<EmptyTurnBlock> block(new EmptyTurnBlock(cell_sheet, position, cell));
-                                empty_pipes.push_back(block);
-                            }
-                        }
+                        shared_ptr<EmptyTurnBlock> block = arena.make<EmptyTurnBlock>(cell_sheet, position, cell);
+                        empty_pipes.push_back(block);
                     }
                 }
+            });
 
             return empty_pipes;
         }
 
-        vector<shared_ptr<EmptyMultiTurnBlock>> get_empty_multi_turn_blocks(vector<shared_ptr<EmptyMultiTurnBlock>> empty_pipes, bitmap cell_sheet, int offset)
+        vector<shared_ptr<EmptyMultiTurnBlock>> get_empty_multi_turn_blocks(LevelArena &arena, vector<shared_ptr<EmptyMultiTurnBlock>> empty_pipes, bitmap cell_sheet, int offset)
         {
-            point_2d position;
+            layer.for_each_tile(offset + 1, offset + SPARSE_IDS_PER_SHEET, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
+                int cell = (id - 1) - offset;
 
-                    int cell = ((this->map_array[i][j]) - 1) - offset;
-
-                    if(this->map_array[i][j] > offset)
+                if(bitmap_name(cell_sheet) == "EmptyMulti")
+                {
+                    if(id < (bitmap_cell_count(cell_sheet) + 1) + offset)
                     {
-                        if(bitmap_name(cell_sheet) == "EmptyMulti")
-                        {
-                            if(this->map_array[i][j] < (bitmap_cell_count(cell_sheet) + 1) + offset)
-                            {
-                                shared_ptr<EmptyMultiTurnBlock> block(new EmptyMultiTurnBlock(cell_sheet, position, cell));
-                                empty_pipes.push_back(block);
-                            }
-                        }
+                        shared_ptr<EmptyMultiTurnBlock> block = arena.make<EmptyMultiTurnBlock>(cell_sheet, position, cell);
+                        empty_pipes.push_back(block);
                     }
                 }
+            });
 
             return empty_pipes;
         }
         
 
-        vector<shared_ptr<Ladder>> get_ladders(vector<shared_ptr<Ladder>> ladder_blocks, bitmap cell_sheet, int offset)
+        vector<shared_ptr<Ladder>> get_ladders(LevelArena &arena, vector<shared_ptr<Ladder>> ladder_blocks, bitmap cell_sheet, int offset)
         {
-            point_2d position;
+            layer.for_each_tile(offset + 1, offset + SPARSE_IDS_PER_SHEET, [&](int col, int row, int id) {
+                point_2d position;
+                position.x = col * this->tile_size;
+                position.y = row * this->tile_size;
 
-            for (int i = 0; i < this->map_height; i++)
-                for (int j = 0; j < this->map_width; j++)
-                {
-                    position.x = j * this->tile_size;
-                    position.y = i * this->tile_size;
-
-                    int cell = ((this->map_array[i][j]) - 1) - offset;
+                int cell = (id - 1) - offset;
 
-                    if(this->map_array[i][j] > offset)
+                if(bitmap_name(cell_sheet) == "Ladder")
+                {
+                    if(id < (bitmap_cell_count(cell_sheet) + 1) + offset)
                     {
-                        if(bitmap_name(cell_sheet) == "Ladder")
-                        {
-                            if(this->map_array[i][j] < (bitmap_cell_count(cell_sheet) + 1) + offset)
-                            {
-                                shared_ptr<Ladder> block(new Ladder(cell_sheet, position, cell));
-                                ladder_blocks.push_back(block);
-                            }
-                        }
+                        shared_ptr<Ladder> block = arena.make<Ladder>(cell_sheet, position, cell);
+                        ladder_blocks.push_back(block);
                     }
                 }
+            });
 
             return ladder_blocks;
         }
@@ -0,0 +1,201 @@
+#include "splashkit.h"
+#include "triplebuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#pragma once
+
+using namespace std;
+
+// Frame times the percentiles are taken over, ten seconds at 60 frames a second
+#define METRICS_FRAMES 600
+
+// The parts of a level tick that are timed, in the order they run
+enum level_phase
+{
+    LEVEL_PHASE_TILES,
+    LEVEL_PHASE_PLAYERS,
+    LEVEL_PHASE_NAVIGATION,
+    LEVEL_PHASE_ENEMIES,
+    LEVEL_PHASE_COLLISIONS,
+    LEVEL_PHASE_LIVES,
+    LEVEL_PHASE_HUD,
+    LEVEL_PHASE_COUNT
+};
+
+const char *LEVEL_PHASE_NAMES[LEVEL_PHASE_COUNT] = {"tiles", "players", "navigation", "enemies", "collisions", "lives", "hud"};
+
+// What the last tick of a level took and how much was going on in it
+struct level_metrics
+{
+    double phase_ms[LEVEL_PHASE_COUNT] = {};
+    int enemies_active = 0;
+    int enemies = 0;
+    int water_flowing = 0;
+    size_t arena_bytes = 0;
+};
+
+// Everything a scrape sees, as of the last frame the game published
+struct game_metrics
+{
+    long frames = 0;
+    vector<double> frame_ms; // The last METRICS_FRAMES frame times, oldest not necessarily first
+    string screen;
+    int level_number = 0;
+    string level_name;
+    level_metrics level;
+    int blocks_drawn = 0;
+};
+
+// Bytes of memory the process has resident, 0 where that can't be found out
+size_t resident_bytes()
+{
+#ifdef __linux__
+    ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (statm >> pages >> resident)
+        return resident * sysconf(_SC_PAGESIZE);
+#endif
+    return 0;
+}
+
+string json_escape(const string &text)
+{
+    string escaped;
+    for (int i = 0; i < text.size(); i++)
+    {
+        if (text[i] == '"' || text[i] == '\\')
+            escaped += '\\';
+        escaped += text[i];
+    }
+    return escaped;
+}
+
+// The frame time below which the given share of frames came in
+double frame_percentile(const vector<double> &sorted, double share)
+{
+    if (sorted.empty())
+        return 0;
+    int at = (int)ceil(share * sorted.size()) - 1;
+    return sorted[max(0, min(at, (int)sorted.size() - 1))];
+}
+
+string metrics_json(const game_metrics &metrics)
+{
+    vector<double> sorted = metrics.frame_ms;
+    sort(sorted.begin(), sorted.end());
+
+    string json = "{\"frames\":" + to_string(metrics.frames);
+    json += ",\"frame_ms\":{\"p50\":" + to_string(frame_percentile(sorted, 0.5)) + ",\"p90\":" + to_string(frame_percentile(sorted, 0.9)) + ",\"p99\":" + to_string(frame_percentile(sorted, 0.99)) + ",\"max\":" + to_string(sorted.empty() ? 0 : sorted.back()) + "}";
+
+    json += ",\"phase_ms\":{";
+    for (int i = 0; i < LEVEL_PHASE_COUNT; i++)
+        json += string(i > 0 ? "," : "") + "\"" + LEVEL_PHASE_NAMES[i] + "\":" + to_string(metrics.level.phase_ms[i]);
+    json += "}";
+
+    json += ",\"screen\":\"" + json_escape(metrics.screen) + "\"";
+    json += ",\"level\":{\"number\":" + to_string(metrics.level_number) + ",\"name\":\"" + json_escape(metrics.level_name) + "\"}";
+    json += ",\"objects\":{\"blocks_drawn\":" + to_string(metrics.blocks_drawn) + ",\"enemies_active\":" + to_string(metrics.level.enemies_active) + ",\"enemies\":" + to_string(metrics.level.enemies) + ",\"water_flowing\":" + to_string(metrics.level.water_flowing) + "}";
+    json += ",\"memory\":{\"resident_bytes\":" + to_string(resident_bytes()) + ",\"level_arena_bytes\":" + to_string(metrics.level.arena_bytes) + "}";
+    return json + "}";
+}
+
+// Serves the game's metrics as JSON at /metrics from its own thread. The game publishes each
+// frame through a triple buffer, so a scrape, however slow, never makes a frame wait.
+class MetricsServer
+{
+    private:
+        TripleBuffer<game_metrics> published;
+        thread worker;
+        atomic<bool> running{false};
+        unsigned short port;
+        // Game thread side, the frame times are kept here and copied into each published frame
+        vector<double> frame_ms;
+        int next_sample = 0;
+        long frames = 0;
+
+        void serve()
+        {
+            web_server server = start_web_server(port);
+            while (running)
+            {
+                if (!has_incoming_requests(server))
+                {
+                    this_thread::sleep_for(chrono::milliseconds(5));
+                    continue;
+                }
+
+                http_request request = next_web_request(server);
+                if (is_get_request_for(request, "/metrics"))
+                {
+                    published.acquire();
+                    send_response(request, HTTP_STATUS_OK, metrics_json(published.read_buffer()), "application/json");
+                }
+                else
+                    send_response(request, HTTP_STATUS_NOT_FOUND);
+            }
+            stop_web_server(server);
+        };
+
+    public:
+        MetricsServer(unsigned short port)
+        {
+            this->port = port;
+        };
+
+        ~MetricsServer()
+        {
+            stop();
+        };
+
+        MetricsServer(const MetricsServer &) = delete;
+        MetricsServer &operator=(const MetricsServer &) = delete;
+
+        void start()
+        {
+            if (running)
+                return;
+
+            running = true;
+            worker = thread(&MetricsServer::serve, this);
+        };
+
+        void stop()
+        {
+            if (!running)
+                return;
+
+            running = false;
+            worker.join();
+        };
+
+        // Hands this frame's numbers over, the buffer they go in is only ever touched from here
+        void publish(double frame_time_ms, const string &screen, int level_number, const string &level_name, const level_metrics &level, int blocks_drawn)
+        {
+            if (frame_ms.size() < METRICS_FRAMES)
+                frame_ms.push_back(frame_time_ms);
+            else
+                frame_ms[next_sample] = frame_time_ms;
+            next_sample = (next_sample + 1) % METRICS_FRAMES;
+            frames += 1;
+
+            game_metrics &metrics = published.write_buffer();
+            metrics.frames = frames;
+            metrics.frame_ms.assign(frame_ms.begin(), frame_ms.end());
+            metrics.screen = screen;
+            metrics.level_number = level_number;
+            metrics.level_name = level_name;
+            metrics.level = level;
+            metrics.blocks_drawn = blocks_drawn;
+            published.publish();
+        };
+};
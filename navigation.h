@@ -0,0 +1,285 @@
+#include "splashkit.h"
+#include "tilegrid.h"
+#include "player.h"
+#include <memory>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// How many graph nodes each flow field may expand per frame while it is being rebuilt
+#define NAV_NODES_PER_FRAME 4096
+#define NAV_UNREACHABLE -1
+
+enum nav_move
+{
+    NAV_NONE,
+    NAV_LEFT,
+    NAV_RIGHT,
+    NAV_CLIMB_UP,
+    NAV_CLIMB_DOWN
+};
+
+// Distance to one player from every walkable tile, and the move that gets you one step closer.
+// Rebuilt in the background when the player moves to another tile, readers always see the
+// last finished field.
+struct flow_field
+{
+    int target = NAV_UNREACHABLE;
+    vector<int> distance;
+    vector<unsigned char> move;
+
+    // The field being built
+    int pending_target = NAV_UNREACHABLE;
+    vector<int> next_distance;
+    vector<unsigned char> next_move;
+    vector<int> frontier;
+    int frontier_head = 0;
+};
+
+// The flow fields as they were at one frame, half built ones included
+struct navigation_snapshot
+{
+    vector<flow_field> fields;
+    vector<int> last_player_node;
+};
+
+// Walkable surface graph of a level. A node is a tile an enemy can stand in: an open tile
+// above a solid one, or a ladder. Edges walk sideways, drop off ledges and climb ladders.
+// Edge blocks can't be crossed, they are what keeps patrolling enemies in their area.
+class Navigation
+{
+    private:
+        TileGrid grid;
+        int map_width = 0;
+        int map_height = 0;
+        vector<bool> walkable;
+
+        // Reverse edges in one block: for node n, the nodes that can reach n in one move
+        // are rev_nodes[rev_offsets[n] .. rev_offsets[n + 1]]
+        vector<int> rev_offsets;
+        vector<int> rev_nodes;
+        vector<unsigned char> rev_moves;
+
+        vector<flow_field> fields;
+        vector<int> last_player_node;
+
+        int node_of(int col, int row)
+        {
+            return row * map_width + col;
+        };
+
+        bool blocked(int col, int row)
+        {
+            return grid.has(col, row, TILE_SOLID | TILE_EDGE);
+        };
+
+        bool standable(int col, int row)
+        {
+            if (!grid.in_bounds(col, row) || blocked(col, row))
+                return false;
+
+            return grid.has(col, row, TILE_LADDER) || grid.has(col, row + 1, TILE_SOLID);
+        };
+
+        // Where something stepping into an open tile ends up after falling
+        int landing_row(int col, int row)
+        {
+            while (grid.in_bounds(col, row) && !standable(col, row))
+            {
+                if (blocked(col, row))
+                    return -1;
+                row += 1;
+            }
+
+            if (!grid.in_bounds(col, row))
+                return -1;
+
+            return row;
+        };
+
+        void add_side_move(vector<vector<pair<int, unsigned char>>> &reverse, int col, int row, int step, nav_move move)
+        {
+            int next_col = col + step;
+            if (!grid.in_bounds(next_col, row) || blocked(next_col, row))
+                return;
+
+            int land = landing_row(next_col, row);
+            if (land < 0)
+                return;
+
+            reverse[node_of(next_col, land)].push_back(make_pair(node_of(col, row), (unsigned char)move));
+        };
+
+        void expand(flow_field &field, int budget)
+        {
+            while (field.frontier_head < field.frontier.size() && budget > 0)
+            {
+                int node = field.frontier[field.frontier_head];
+                field.frontier_head += 1;
+                budget -= 1;
+
+                for (int i = rev_offsets[node]; i < rev_offsets[node + 1]; i++)
+                {
+                    int from = rev_nodes[i];
+                    if (field.next_distance[from] != NAV_UNREACHABLE)
+                        continue;
+
+                    field.next_distance[from] = field.next_distance[node] + 1;
+                    field.next_move[from] = rev_moves[i];
+                    field.frontier.push_back(from);
+                }
+            }
+
+            // Finished, publish it
+            if (field.frontier_head >= field.frontier.size() && field.pending_target != NAV_UNREACHABLE)
+            {
+                field.distance.swap(field.next_distance);
+                field.move.swap(field.next_move);
+                field.target = field.pending_target;
+                field.pending_target = NAV_UNREACHABLE;
+            }
+        };
+
+        void start_field(flow_field &field, int target)
+        {
+            field.pending_target = target;
+            field.next_distance.assign(map_width * map_height, NAV_UNREACHABLE);
+            field.next_move.assign(map_width * map_height, NAV_NONE);
+            field.frontier.clear();
+            field.frontier_head = 0;
+
+            field.next_distance[target] = 0;
+            field.frontier.push_back(target);
+        };
+
+    public:
+        Navigation(){};
+
+        ~Navigation(){};
+
+        // Builds the surface graph, done once per level
+        void build(TileGrid &tile_grid, int players)
+        {
+            this->grid = tile_grid;
+            this->map_width = tile_grid.get_map_width();
+            this->map_height = tile_grid.get_map_height();
+
+            int nodes = map_width * map_height;
+            walkable.assign(nodes, false);
+            vector<vector<pair<int, unsigned char>>> reverse(nodes);
+
+            for (int row = 0; row < map_height; row++)
+                for (int col = 0; col < map_width; col++)
+                {
+                    if (!standable(col, row))
+                        continue;
+
+                    walkable[node_of(col, row)] = true;
+                    add_side_move(reverse, col, row, -1, NAV_LEFT);
+                    add_side_move(reverse, col, row, 1, NAV_RIGHT);
+
+                    if (grid.has(col, row, TILE_LADDER) && standable(col, row - 1))
+                        reverse[node_of(col, row - 1)].push_back(make_pair(node_of(col, row), (unsigned char)NAV_CLIMB_UP));
+
+                    if (grid.has(col, row + 1, TILE_LADDER) && standable(col, row + 1))
+                        reverse[node_of(col, row + 1)].push_back(make_pair(node_of(col, row), (unsigned char)NAV_CLIMB_DOWN));
+                }
+
+            rev_offsets.assign(nodes + 1, 0);
+            rev_nodes.clear();
+            rev_moves.clear();
+            for (int i = 0; i < nodes; i++)
+            {
+                rev_offsets[i] = rev_nodes.size();
+                for (int j = 0; j < reverse[i].size(); j++)
+                {
+                    rev_nodes.push_back(reverse[i][j].first);
+                    rev_moves.push_back(reverse[i][j].second);
+                }
+            }
+            rev_offsets[nodes] = rev_nodes.size();
+
+            fields.assign(players, flow_field());
+            last_player_node.assign(players, NAV_UNREACHABLE);
+        };
+
+        // Node for something whose feet are at this point, or NAV_UNREACHABLE when in the air
+        int node_at(point_2d feet)
+        {
+            if (map_width == 0)
+                return NAV_UNREACHABLE;
+
+            int col = grid.column_of(feet.x);
+            int row = grid.row_of(feet.y - 1);
+            if (!grid.in_bounds(col, row) || !walkable[node_of(col, row)])
+                return NAV_UNREACHABLE;
+
+            return node_of(col, row);
+        };
+
+        // Keeps each player's field pointing at the tile they last stood on. A field is only
+        // rebuilt when its player changes tile, and the rebuild is spread over frames.
+        void update(vector<shared_ptr<Player>> &level_players)
+        {
+            for (int i = 0; i < fields.size() && i < level_players.size(); i++)
+            {
+                rectangle hitbox = level_players[i]->get_player_hitbox();
+                point_2d feet = point_at(hitbox.x + hitbox.width / 2, hitbox.y + hitbox.height);
+                int node = node_at(feet);
+
+                if (node != NAV_UNREACHABLE && node != last_player_node[i])
+                {
+                    last_player_node[i] = node;
+                    start_field(fields[i], node);
+                }
+
+                if (fields[i].pending_target != NAV_UNREACHABLE)
+                    expand(fields[i], NAV_NODES_PER_FRAME);
+            }
+        };
+
+        // Steps from the tile under these feet to the player, NAV_UNREACHABLE if there is no path
+        int distance_to(int player, point_2d feet)
+        {
+            if (player < 0 || player >= fields.size() || fields[player].target == NAV_UNREACHABLE)
+                return NAV_UNREACHABLE;
+
+            int node = node_at(feet);
+            if (node == NAV_UNREACHABLE)
+                return NAV_UNREACHABLE;
+
+            return fields[player].distance[node];
+        };
+
+        // Move that brings something standing here one tile closer to the player
+        nav_move next_move(int player, point_2d feet)
+        {
+            if (player < 0 || player >= fields.size() || fields[player].target == NAV_UNREACHABLE)
+                return NAV_NONE;
+
+            int node = node_at(feet);
+            if (node == NAV_UNREACHABLE)
+                return NAV_NONE;
+
+            return (nav_move)fields[player].move[node];
+        };
+
+        int players()
+        {
+            return this->fields.size();
+        };
+
+        void save_state(navigation_snapshot &snapshot)
+        {
+            snapshot.fields = fields;
+            snapshot.last_player_node = last_player_node;
+        };
+
+        void restore_state(const navigation_snapshot &snapshot)
+        {
+            fields = snapshot.fields;
+            last_player_node = snapshot.last_player_node;
+        };
+};
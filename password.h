@@ -1,4 +1,6 @@
 #include "splashkit.h"
+#include "textcache.h"
+#include "assetpack.h"
 #include <memory>
 #include <vector>
 
@@ -10,7 +12,7 @@ class Letter
         string val;
         point_2d pos;
         bool selected = false;
-        font font_type;
+        string font_type;
         int font_size = 25;
         color font_color;
         color select_color;
@@ -22,11 +24,11 @@ class Letter
         {
             this->val = val;
             this->pos = pos;
-            this->font_type = font_named("DefaultFont");
+            this->font_type = "DefaultFont";
             this->font_color = COLOR_WHITE;
             this->select_color = COLOR_RED;
-            this->letter_width = text_width(val, font_type, font_size);
-            this->letter_height = text_height(val, font_type, font_size);
+            this->letter_width = cached_text_width(val, font_type, font_size);
+            this->letter_height = cached_text_height(val, font_type, font_size);
         };
         ~Letter(){};
 
@@ -34,11 +36,11 @@ class Letter
         {
             if(selected)
             {
-                draw_text(val, select_color, font_type, font_size, pos.x, pos.y);
+                draw_cached_text(val, select_color, font_type, font_size, pos.x, pos.y);
             }
             else
             {
-                draw_text(val, font_color, font_type, font_size, pos.x, pos.y);
+                draw_cached_text(val, font_color, font_type, font_size, pos.x, pos.y);
             }
         };
 
@@ -1,9 +1,15 @@
 #include "splashkit.h"
 #include "playerinput.h"
+#include "renderqueue.h"
 #include "block.h"
+#include "levelclock.h"
 #include <memory>
 #pragma once
 
+// Points for the HUD score
+#define SCORE_ENEMY 100
+#define SCORE_COLLECTABLE 50
+
 // Player Physics Variables
 #define MAX_JUMP_HEIGHT 127
 #define JUMP_MOMENTUM_RATE 8
@@ -16,7 +22,72 @@
 #define FALL_SIDE_MOMENTUM 0.072
 #define CLIMB_SPEED 3
 
+// Character ids, which pipes a player can use depends on theirs
+#define PLAYER_BLUE 1
+#define PLAYER_PINK 2
+#define PLAYER_PURPLE 3
+
 class Player;
+
+// Who plays in each slot. Alone you are purple, who can use every pipe. Together blue and pink
+// come first and everyone after them is purple, there are no more characters to go round.
+int player_character(int slot, int players)
+{
+    if (players == 1)
+        return PLAYER_PURPLE;
+
+    switch (slot)
+    {
+        case 0:
+            return PLAYER_BLUE;
+        case 1:
+            return PLAYER_PINK;
+        default:
+            return PLAYER_PURPLE;
+    }
+}
+
+string player_sprite_name(int character)
+{
+    switch (character)
+    {
+        case PLAYER_BLUE:
+            return "blueGuy";
+        case PLAYER_PINK:
+            return "pinkGirl";
+        default:
+            return "purpleGuy";
+    }
+}
+
+// Each player slot has its own damage, dying and spawn timer on the level clock, named like DamageTimerP1
+string player_timer(string kind, int slot)
+{
+    return kind + "TimerP" + to_string(slot + 1);
+}
+
+class PlayerState;
+
+// Everything about a player that changes while a level is played
+struct player_snapshot
+{
+    point_2d sprite_position;
+    vector_2d velocity;
+    bool facing_left;
+    bool on_floor;
+    bool on_ladder;
+    bool is_dead;
+    bool has_won;
+    std::shared_ptr<Block> held_pipe;
+    bool is_holding_pipe;
+    int lives;
+    int health;
+    int score;
+    // What the player was doing and how far into its animation, only used to resume exactly
+    std::shared_ptr<PlayerState> state;
+    string animation;
+    int animation_ticks;
+};
 class PlayerState
 {
 protected:
@@ -41,6 +112,8 @@ public:
 
     virtual void update() = 0;
     virtual void get_input() = 0;
+    // A copy partway through, for snapshots
+    virtual PlayerState *clone() = 0;
 };
 
 class Player
@@ -49,6 +122,7 @@ class Player
         PlayerState *state;
         sprite player_sprite;
         point_2d position;
+        point_2d previous_position;
         bool facing_left;
         bool on_floor;
         bool on_ladder;
@@ -58,11 +132,16 @@ class Player
         std::shared_ptr<Block> held_pipe;
         bool is_holding_pipe = false;
         int id;
+        int slot = 0;
+        // Sprite updates since the animation was started, so a snapshot can pick it up part way
+        int animation_ticks = 0;
+        // Only used by the simulation, the HUD is handed a copy at the end of each tick
+        int lives = 3;
+        int health = 3;
+        int score = 0;
 
     public:
         player_input input;
-        int player_lives = 3;
-        int player_health = 3;
 
         Player(PlayerState *state, sprite player_sprite, point_2d initial_position, bool facing_left, player_input input) : state(nullptr)
         {
@@ -74,6 +153,7 @@ class Player
             this->on_ladder = false;
             this->input = input;
             sprite_set_position(player_sprite, this->position);
+            this->previous_position = this->position;
             make_hitbox();
         };
 
@@ -119,6 +199,48 @@ class Player
             this->hitbox.y = current_position.y + 5;
         };
 
+        // Remembers where the sprite was before this frame's movement, so it can be swept.
+        void begin_move()
+        {
+            this->previous_position = sprite_position(this->player_sprite);
+        };
+
+        // Puts the player somewhere without travelling there.
+        void teleport(point_2d new_position)
+        {
+            sprite_set_position(this->player_sprite, new_position);
+            this->previous_position = new_position;
+        };
+
+        void start_animation(string name)
+        {
+            sprite_start_animation(this->player_sprite, name);
+            this->animation_ticks = 0;
+        };
+
+        // Starts the animation over, as the states that keep it going do once it has ended
+        void replay_animation()
+        {
+            sprite_replay_animation(this->player_sprite);
+            this->animation_ticks = 0;
+        };
+
+        // Moves the sprite and steps its animation. An animation that has ended stays on its last
+        // frame, so only the steps up to its end are counted and a snapshot never has more to
+        // step through than one animation's length.
+        void update_player_sprite()
+        {
+            if (!sprite_animation_has_ended(this->player_sprite))
+                this->animation_ticks += 1;
+            update_sprite(this->player_sprite);
+        };
+
+        // Returns where the sprite was before this frame's movement.
+        point_2d get_previous_position()
+        {
+            return this->previous_position;
+        };
+
         // Returns the player_sprite.
         sprite get_player_sprite()
         {
@@ -266,10 +388,75 @@ class Player
             this->id = id;
         };
 
+        // Where the player is in the level's list of players, their keys and timers go by it
+        int get_slot()
+        {
+            return this->slot;
+        };
+
+        void set_slot(int slot)
+        {
+            this->slot = slot;
+        };
+
         std::shared_ptr<Block> get_held_pipe()
         {
             return this->held_pipe;
         };
+
+        int get_health()
+        {
+            return this->health;
+        };
+
+        void set_health(int health)
+        {
+            this->health = health;
+        };
+
+        int get_lives()
+        {
+            return this->lives;
+        };
+
+        void set_lives(int lives)
+        {
+            this->lives = lives;
+        };
+
+        int get_score()
+        {
+            return this->score;
+        };
+
+        void add_score(int points)
+        {
+            this->score += points;
+        };
+
+        player_snapshot save_state()
+        {
+            player_snapshot snapshot;
+            snapshot.sprite_position = sprite_position(this->player_sprite);
+            snapshot.velocity = sprite_velocity(this->player_sprite);
+            snapshot.facing_left = this->facing_left;
+            snapshot.on_floor = this->on_floor;
+            snapshot.on_ladder = this->on_ladder;
+            snapshot.is_dead = this->is_dead;
+            snapshot.has_won = this->has_won;
+            snapshot.held_pipe = this->held_pipe;
+            snapshot.is_holding_pipe = this->is_holding_pipe;
+            snapshot.lives = this->lives;
+            snapshot.health = this->health;
+            snapshot.score = this->score;
+            snapshot.state = std::shared_ptr<PlayerState>(this->state->clone());
+            snapshot.animation = sprite_animation_name(this->player_sprite);
+            snapshot.animation_ticks = this->animation_ticks;
+            return snapshot;
+        };
+
+        // Defined after the states. Unless resuming, the player starts over standing still.
+        void restore_state(const player_snapshot &snapshot, bool resume = false);
 };
 
 // Idle State Class
@@ -285,6 +472,10 @@ class IdleState : public PlayerState
 
         void update() override;
         void get_input() override;
+        PlayerState *clone() override
+        {
+            return new IdleState(*this);
+        };
 };
 
 // Run State Class
@@ -304,6 +495,10 @@ class RunState : public PlayerState
 
         void update() override;
         void get_input() override;
+        PlayerState *clone() override
+        {
+            return new RunState(*this);
+        };
 };
 
 // Jumping State Class
@@ -321,6 +516,10 @@ class JumpRiseState : public PlayerState
 
         void update() override;
         void get_input() override;
+        PlayerState *clone() override
+        {
+            return new JumpRiseState(*this);
+        };
 };
 
 // Falling State Class
@@ -336,6 +535,10 @@ class JumpFallState : public PlayerState
 
         void update() override;
         void get_input() override;
+        PlayerState *clone() override
+        {
+            return new JumpFallState(*this);
+        };
 };
 
 // Dancing State Class
@@ -351,6 +554,10 @@ class DanceState : public PlayerState
 
         void update() override;
         void get_input() override;
+        PlayerState *clone() override
+        {
+            return new DanceState(*this);
+        };
 };
 
 // Attacking State Class
@@ -366,6 +573,10 @@ class AttackState : public PlayerState
 
         void update() override;
         void get_input() override;
+        PlayerState *clone() override
+        {
+            return new AttackState(*this);
+        };
 };
 
 // Hurt State Class
@@ -381,6 +592,10 @@ class HurtState : public PlayerState
 
         void update() override;
         void get_input() override;
+        PlayerState *clone() override
+        {
+            return new HurtState(*this);
+        };
 };
 
 // Climbing State Class
@@ -397,6 +612,10 @@ class ClimbState : public PlayerState
 
         void update() override;
         void get_input() override;
+        PlayerState *clone() override
+        {
+            return new ClimbState(*this);
+        };
 };
 
 // Dying State Class
@@ -412,6 +631,10 @@ class DyingState : public PlayerState
 
         void update() override;
         void get_input() override;
+        PlayerState *clone() override
+        {
+            return new DyingState(*this);
+        };
 };
 
 // Spawn State Class
@@ -427,6 +650,10 @@ class SpawningState : public PlayerState
 
         void update() override;
         void get_input() override;
+        PlayerState *clone() override
+        {
+            return new SpawningState(*this);
+        };
 };
 
 // Crouch State Class
@@ -442,6 +669,10 @@ public:
 
     void update() override;
     void get_input() override;
+    PlayerState *clone() override
+    {
+        return new CrouchState(*this);
+    };
 };
 
 void sprite_fall(sprite sprite)
@@ -453,17 +684,18 @@ void sprite_fall(sprite sprite)
 void animation_routine(Player *player, string left_anim, string right_anim)
 {
     if (player->is_facing_left())
-        sprite_start_animation(player->get_player_sprite(), left_anim);
+        player->start_animation(left_anim);
     else
-        sprite_start_animation(player->get_player_sprite(), right_anim);
+        player->start_animation(right_anim);
 }
 
-void sprite_update_routine_continuous(sprite player_sprite)
+void sprite_update_routine_continuous(Player *player)
 {
-    draw_sprite(player_sprite);
+    sprite player_sprite = player->get_player_sprite();
+    submit_sprite(player_sprite);
     if (sprite_animation_has_ended(player_sprite))
-        sprite_replay_animation(player_sprite);
-    update_sprite(player_sprite);
+        player->replay_animation();
+    player->update_player_sprite();
 }
 
 void player_draw_pipe(Player *player)
@@ -479,7 +711,7 @@ void player_draw_pipe(Player *player)
         point_2d pipe_center = bitmap_cell_center(pipe);
         position.x = position.x - pipe_center.x;
         position.y = position.y - pipe_center.y;
-        draw_bitmap(pipe, position.x, position.y, opts);
+        submit_bitmap(pipe, position.x, position.y, opts);
     }
 }
 
@@ -508,34 +740,34 @@ void IdleState::update()
 
     player_draw_pipe(player);
 
-    sprite_update_routine_continuous(this->player->get_player_sprite());
+    sprite_update_routine_continuous(this->player);
 }
 
 void IdleState::get_input()
 {
-    if (key_down(player->input.left_key))
+    if (player_key_down(player->input.left_key))
     {
         this->player->set_facing_left(true);
         this->player->change_state(new RunState(0), "RunLeft");
     }
-    if (key_down(player->input.right_key))
+    if (player_key_down(player->input.right_key))
     {
         this->player->set_facing_left(false);
         this->player->change_state(new RunState(0), "RunRight");
     }
-    if (key_typed(player->input.jump_key) && player->is_on_floor())
+    if (player_key_typed(player->input.jump_key) && player->is_on_floor())
     {
         this->player->change_state(new JumpRiseState, "JumpRise");
     }
-    if (key_typed(Z_KEY))
+    if (player_key_typed(Z_KEY))
     {
         this->player->change_state(new DanceState, "Dance");
     }
-    if (key_typed(player->input.attack_key))
+    if (player_key_typed(player->input.attack_key))
     {
         this->player->change_state(new AttackState, "Attack");
     }
-    if (key_down(player->input.crouch_key))
+    if (player_key_down(player->input.crouch_key))
     {
         this->player->change_state(new CrouchState, "Crouch");
     }
@@ -578,16 +810,16 @@ void RunState::update()
 
     player_draw_pipe(player);
 
-    sprite_update_routine_continuous(this->player->get_player_sprite());
+    sprite_update_routine_continuous(this->player);
 }
 
 void RunState::get_input()
 {
-    if (key_released(player->input.left_key) || key_released(player->input.right_key))
+    if (player_key_released(player->input.left_key) || player_key_released(player->input.right_key))
     {
         this->player->change_state(new IdleState, "Idle");
     }
-    if (key_typed(player->input.jump_key) && player->is_on_floor())
+    if (player_key_typed(player->input.jump_key) && player->is_on_floor())
     {
         this->player->change_state(new JumpRiseState, "JumpRise");
     }
@@ -598,7 +830,7 @@ void JumpRiseState::update()
     if (!run_once)
     {
         if (!sound_effect_playing("Jump"))
-            play_sound_effect("Jump");
+            play_asset_sound("Jump");
         initial_y = sprite_y(player->get_player_sprite());
         sprite_set_dy(player->get_player_sprite(), -JUMP_START_SPEED);
         animation_routine(player, "LeftJump", "RightJump");
@@ -614,7 +846,7 @@ void JumpRiseState::update()
 
     player_draw_pipe(player);
 
-    sprite_update_routine_continuous(this->player->get_player_sprite());
+    sprite_update_routine_continuous(this->player);
 
     float current_y = sprite_y(player->get_player_sprite());
 
@@ -627,12 +859,12 @@ void JumpRiseState::update()
 
 void JumpRiseState::get_input()
 {
-    if (key_down(player->input.left_key))
+    if (player_key_down(player->input.left_key))
     {
         if (sprite_dx(player->get_player_sprite()) > -MAX_RUN_SPEED)
             sprite_set_dx(player->get_player_sprite(), sprite_dx(player->get_player_sprite()) - RUN_ACCEL);
     }
-    if (key_down(player->input.right_key))
+    if (player_key_down(player->input.right_key))
     {
         if (sprite_dx(player->get_player_sprite()) < MAX_RUN_SPEED)
             sprite_set_dx(player->get_player_sprite(), sprite_dx(player->get_player_sprite()) + RUN_ACCEL);
@@ -648,16 +880,16 @@ void JumpFallState::update()
     }
 
     player_draw_pipe(player);
-    sprite_update_routine_continuous(this->player->get_player_sprite());
+    sprite_update_routine_continuous(this->player);
 
     sprite_fall(player->get_player_sprite());
 
     if (player->is_on_floor())
     {
         sprite_set_dy(player->get_player_sprite(), 0);
-        if (player->is_facing_left() && key_down(LEFT_KEY) && player->is_on_floor())
+        if (player->is_facing_left() && player_key_down(player->input.left_key) && player->is_on_floor())
             this->player->change_state(new RunState(sprite_dx(player->get_player_sprite())), "RunLeft");
-        else if (!player->is_facing_left() && key_down(RIGHT_KEY) && player->is_on_floor())
+        else if (!player->is_facing_left() && player_key_down(player->input.right_key) && player->is_on_floor())
             this->player->change_state(new RunState(sprite_dx(player->get_player_sprite())), "RunRight");
         else
             this->player->change_state(new IdleState, "Idle");
@@ -668,21 +900,21 @@ void JumpFallState::get_input()
 {
     if (player->is_on_floor())
     {
-        if (key_down(player->input.left_key) && player->is_facing_left())
+        if (player_key_down(player->input.left_key) && player->is_facing_left())
             this->player->change_state(new RunState(sprite_dx(player->get_player_sprite())), "RunLeft");
-        else if (key_down(player->input.right_key) && !player->is_facing_left())
+        else if (player_key_down(player->input.right_key) && !player->is_facing_left())
             this->player->change_state(new RunState(sprite_dx(player->get_player_sprite())), "RunRight");
         else
             this->player->change_state(new IdleState, "Idle");
     }
     else
     {
-        if (key_down(player->input.left_key))
+        if (player_key_down(player->input.left_key))
         {
             if (sprite_dx(player->get_player_sprite()) > -MAX_RUN_SPEED)
                 sprite_set_dx(player->get_player_sprite(), sprite_dx(player->get_player_sprite()) - FALL_SIDE_MOMENTUM);
         }
-        if (key_down(player->input.right_key))
+        if (player_key_down(player->input.right_key))
         {
             if (sprite_dx(player->get_player_sprite()) < MAX_RUN_SPEED)
                 sprite_set_dx(player->get_player_sprite(), sprite_dx(player->get_player_sprite()) + FALL_SIDE_MOMENTUM);
@@ -696,19 +928,19 @@ void DanceState::update()
     if (!run_once)
     {
         if (!sound_effect_playing("Dance"))
-            play_sound_effect("Dance");
+            play_asset_sound("Dance");
         sprite_set_dx(player_sprite, 0);
         sprite_set_dy(player_sprite, 0);
-        sprite_start_animation(player->get_player_sprite(), "Dance");
+        player->start_animation("Dance");
         run_once = true;
     }
 
-    sprite_update_routine_continuous(this->player->get_player_sprite());
+    sprite_update_routine_continuous(this->player);
 }
 
 void DanceState::get_input()
 {
-    if (key_typed(Z_KEY))
+    if (player_key_typed(Z_KEY))
     {
         this->player->change_state(new IdleState, "Idle");
     }//this is a test please don't use this for actual actions!
@@ -720,17 +952,17 @@ void AttackState::update()
     if (!run_once)
     {
         if (!sound_effect_playing("Attack"))
-            play_sound_effect("Attack");
+            play_asset_sound("Attack");
         sprite_set_dx(player_sprite, 0);
         sprite_set_dy(player_sprite, 0);
         animation_routine(player, "LeftAttack", "RightAttack");
         run_once = true;
     }
     player_draw_pipe(player);
-    draw_sprite(player_sprite);
+    submit_sprite(player_sprite);
     if (sprite_animation_has_ended(player_sprite))
         this->player->change_state(new IdleState, "Idle");
-    update_sprite(player_sprite);
+    this->player->update_player_sprite();
 }
 
 void AttackState::get_input()
@@ -757,12 +989,12 @@ void CrouchState::update()
     else
         sprite_fall(player->get_player_sprite());
 
-    sprite_update_routine_continuous(this->player->get_player_sprite());
+    sprite_update_routine_continuous(this->player);
 }
 
 void CrouchState::get_input()
 {
-     if (key_released(player->input.crouch_key))
+     if (player_key_released(player->input.crouch_key))
     {
         this->player->change_state(new IdleState, "Idle");
     }
@@ -774,7 +1006,7 @@ void HurtState::update()
     if (!run_once)
     {
         if (!sound_effect_playing("Hurt"))
-            play_sound_effect("Hurt");
+            play_asset_sound("Hurt");
         sprite_set_dx(player_sprite, 0);
         animation_routine(player, "LeftFall", "RightFall");
         run_once = true;
@@ -785,10 +1017,10 @@ void HurtState::update()
     else
         sprite_set_dy(player_sprite, 0);
 
-    draw_sprite(player_sprite);
+    submit_sprite(player_sprite);
     if (sprite_animation_has_ended(player_sprite))
         this->player->change_state(new IdleState, "Idle");
-    update_sprite(player_sprite);
+    this->player->update_player_sprite();
 }
 
 void HurtState::get_input()
@@ -803,12 +1035,12 @@ void ClimbState::update()
         is_moving = true;
         sprite_set_dx(player->get_player_sprite(), 0);
         sprite_set_dy(player->get_player_sprite(), 0);
-        sprite_start_animation(this->player->get_player_sprite(), "Climb");
+        this->player->start_animation("Climb");
         run_once = true;
     }
 
     player_draw_pipe(player);
-    sprite_update_routine_continuous(this->player->get_player_sprite());
+    sprite_update_routine_continuous(this->player);
 
     if (!player->is_on_ladder())
     {
@@ -819,38 +1051,38 @@ void ClimbState::update()
 // ClimbState Get Input Checks
 void ClimbState::get_input()
 {
-    if (key_down(player->input.left_key))
+    if (player_key_down(player->input.left_key))
     {
         if (!is_moving)
         {
-            sprite_start_animation(this->player->get_player_sprite(), "Climb");
+            this->player->start_animation("Climb");
             is_moving = true;
         }
         sprite_set_dx(player->get_player_sprite(), -CLIMB_SPEED);
     }
-    else if (key_down(player->input.right_key))
+    else if (player_key_down(player->input.right_key))
     {
         if (!is_moving)
         {
-            sprite_start_animation(this->player->get_player_sprite(), "Climb");
+            this->player->start_animation("Climb");
             is_moving = true;
         }
         sprite_set_dx(player->get_player_sprite(), CLIMB_SPEED);
     }
-    else if (key_down(player->input.jump_key))
+    else if (player_key_down(player->input.jump_key))
     {
         if (!is_moving)
         {
-            sprite_start_animation(this->player->get_player_sprite(), "Climb");
+            this->player->start_animation("Climb");
             is_moving = true;
         }
         sprite_set_dy(player->get_player_sprite(), -CLIMB_SPEED);
     }
-    else if (key_down(player->input.crouch_key))
+    else if (player_key_down(player->input.crouch_key))
     {
         if (!is_moving)
         {
-            sprite_start_animation(this->player->get_player_sprite(), "Climb");
+            this->player->start_animation("Climb");
             is_moving = true;
         }
         sprite_set_dy(player->get_player_sprite(), CLIMB_SPEED);
@@ -860,35 +1092,31 @@ void ClimbState::get_input()
             this->player->change_state(new IdleState, "Idle");
         }
     }
-    if (key_released(player->input.jump_key) || key_released(player->input.crouch_key))
+    if (player_key_released(player->input.jump_key) || player_key_released(player->input.crouch_key))
     {
         is_moving = false;
-        sprite_start_animation(this->player->get_player_sprite(), "ClimbIdle");
+        this->player->start_animation("ClimbIdle");
         sprite_set_dy(player->get_player_sprite(), 0);
     }
-    if(key_released(player->input.left_key) || key_released(player->input.right_key))
+    if(player_key_released(player->input.left_key) || player_key_released(player->input.right_key))
     {
         is_moving = false;
-        sprite_start_animation(this->player->get_player_sprite(), "ClimbIdle");
+        this->player->start_animation("ClimbIdle");
         sprite_set_dx(player->get_player_sprite(), 0);
     }
 }
 
 void DyingState::update()
 {
-    string dying_timer = "";
-    if(this->player->get_player_id() == 1 || this->player->get_player_id() == 3)
-        dying_timer = "DyingTimerP1";
-    else
-        dying_timer = "DyingTimerP2";
+    string dying_timer = player_timer("Dying", this->player->get_slot());
     
     sprite player_sprite = this->player->get_player_sprite();
     if (!run_once)
     {
         if (!sound_effect_playing("Dead"))
-            play_sound_effect("Dead");
-        this->player->player_lives -= 1;
-        start_timer(dying_timer);
+            play_asset_sound("Dead");
+        this->player->set_lives(this->player->get_lives() - 1);
+        level_clock().start(dying_timer);
         sprite_set_dx(player_sprite, 0);
         animation_routine(player, "LeftDying", "RightDying");
         run_once = true;
@@ -899,13 +1127,13 @@ void DyingState::update()
     else
         sprite_set_dy(player_sprite, 0);
 
-    int time = timer_ticks(dying_timer) / 1000;
+    int time = level_clock().ticks(dying_timer) / 1000;
 
     if(time < 2)
-         sprite_update_routine_continuous(player_sprite);
+         sprite_update_routine_continuous(this->player);
     else
     {
-        stop_timer(dying_timer);
+        level_clock().stop(dying_timer);
         this->player->change_state(new SpawningState, "Spawn");
     }
 }
@@ -916,18 +1144,14 @@ void DyingState::get_input()
 
 void SpawningState::update()
 {
-    string spawn_timer = "";
-    if(this->player->get_player_id() == 1 || this->player->get_player_id() == 3)
-        spawn_timer = "SpawnTimerP1";
-    else
-        spawn_timer = "SpawnTimerP2";
+    string spawn_timer = player_timer("Spawn", this->player->get_slot());
 
     sprite player_sprite = this->player->get_player_sprite();
     if (!run_once)
     {
-        sprite_set_position(player_sprite, this->player->get_player_position());
-        this->player->player_health = 3;
-        start_timer(spawn_timer);
+        this->player->teleport(this->player->get_player_position());
+        this->player->set_health(3);
+        level_clock().start(spawn_timer);
         this->player->set_facing_left(false);
         sprite_set_dx(player_sprite, 0);
         sprite_set_dy(player_sprite, 0);
@@ -940,13 +1164,13 @@ void SpawningState::update()
     else
         sprite_set_dy(player_sprite, 0);
 
-    int time = timer_ticks(spawn_timer) / 1000;
+    int time = level_clock().ticks(spawn_timer) / 1000;
 
     if(time < 1)
-         sprite_update_routine_continuous(player_sprite);
+         sprite_update_routine_continuous(this->player);
     else
     {
-        stop_timer(spawn_timer);
+        level_clock().stop(spawn_timer);
         this->player->change_state(new IdleState, "Idle");
     }
         
@@ -954,4 +1178,39 @@ void SpawningState::update()
 
 void SpawningState::get_input()
 {
-}
\ No newline at end of file
+}
+
+void Player::restore_state(const player_snapshot &snapshot, bool resume)
+{
+    teleport(snapshot.sprite_position);
+    sprite_set_velocity(this->player_sprite, snapshot.velocity);
+    this->facing_left = snapshot.facing_left;
+    this->on_floor = snapshot.on_floor;
+    this->on_ladder = snapshot.on_ladder;
+    this->is_dead = snapshot.is_dead;
+    this->has_won = snapshot.has_won;
+    this->held_pipe = snapshot.held_pipe;
+    this->is_holding_pipe = snapshot.is_holding_pipe;
+    this->lives = snapshot.lives;
+    this->health = snapshot.health;
+    this->score = snapshot.score;
+    update_hitbox();
+
+    if (resume && snapshot.state != nullptr)
+    {
+        // Carries on in the same state, with the animation stepped back to the same frame
+        this->change_state(snapshot.state->clone(), snapshot.state->get_type());
+        if (snapshot.animation != "")
+        {
+            sprite_start_animation(this->player_sprite, snapshot.animation);
+            for (int i = 0; i < snapshot.animation_ticks; i++)
+                update_sprite_animation(this->player_sprite);
+        }
+        this->animation_ticks = snapshot.animation_ticks;
+    }
+    else
+    {
+        // Whatever the player was doing is dropped, they start again standing still
+        this->change_state(new IdleState, "Initial");
+    }
+}
@@ -1,6 +1,10 @@
 #include "splashkit.h"
+#include <cstdint>
+#include <vector>
 #pragma once
 
+using namespace std;
+
 struct player_input
 {
     key_code left_key;
@@ -10,28 +14,136 @@ struct player_input
     key_code attack_key;
 };
 
-// Player one input
-player_input make_player1_input()
+// Most players a level can have, each needs its own keys
+#define MAX_PLAYERS 4
+
+player_input make_input(key_code left, key_code right, key_code jump, key_code crouch, key_code attack)
 {
     player_input input;
-    input.jump_key = W_KEY;
-    input.right_key = D_KEY;
-    input.left_key = A_KEY;
-    input.crouch_key = S_KEY;
-    input.attack_key = F_KEY;
+    input.jump_key = jump;
+    input.right_key = right;
+    input.left_key = left;
+    input.crouch_key = crouch;
+    input.attack_key = attack;
 
     return input;
 }
 
-// Player two input
-player_input make_player2_input()
+// Keys of the player in each slot, player one on WASD and F, two on the arrows and L, three on the
+// keypad, four on YGHJ and U
+player_input make_player_input(int slot)
 {
-    player_input input;
-    input.jump_key = UP_KEY;
-    input.right_key = RIGHT_KEY;
-    input.left_key = LEFT_KEY;
-    input.crouch_key = DOWN_KEY;
-    input.attack_key = L_KEY;
+    switch (slot)
+    {
+        case 1:
+            return make_input(LEFT_KEY, RIGHT_KEY, UP_KEY, DOWN_KEY, L_KEY);
+        case 2:
+            return make_input(KEYPAD_4, KEYPAD_6, KEYPAD_8, KEYPAD_5, KEYPAD_0);
+        case 3:
+            return make_input(G_KEY, J_KEY, Y_KEY, H_KEY, U_KEY);
+        default:
+            return make_input(A_KEY, D_KEY, W_KEY, S_KEY, F_KEY);
+    }
+}
 
-    return input;
-}
\ No newline at end of file
+// One frame of the keys gameplay reads, one bit per tracked key. Captured on the main thread
+// where SplashKit pumps events, so the simulation never has to touch SplashKit's input itself.
+struct input_frame
+{
+    uint32_t down = 0;
+    uint32_t typed = 0;
+    uint32_t released = 0;
+};
+
+// Bits each player's keys take, player n's start at bit n * KEYS_PER_PLAYER
+#define KEYS_PER_PLAYER 5
+
+// Every key the players use, a key's bit in an input_frame is its place in this list
+const vector<key_code> &tracked_keys()
+{
+    static const vector<key_code> keys = []() {
+        vector<key_code> keys;
+        for (int i = 0; i < MAX_PLAYERS; i++)
+        {
+            player_input input = make_player_input(i);
+            keys.push_back(input.left_key);
+            keys.push_back(input.right_key);
+            keys.push_back(input.jump_key);
+            keys.push_back(input.crouch_key);
+            keys.push_back(input.attack_key);
+        }
+        keys.push_back(Z_KEY); // Dance
+        return keys;
+    }();
+    return keys;
+}
+
+// Bits of the keys after every player's own, like dance, that whoever presses them presses for all
+uint32_t shared_key_bits()
+{
+    uint32_t tracked = (uint32_t)((1ull << tracked_keys().size()) - 1);
+    return tracked & ~((1u << (MAX_PLAYERS * KEYS_PER_PLAYER)) - 1);
+}
+
+uint32_t key_bit(key_code key)
+{
+    const vector<key_code> &keys = tracked_keys();
+    for (int i = 0; i < keys.size(); i++)
+        if (keys[i] == key)
+            return 1u << i;
+    return 0;
+}
+
+input_frame capture_input()
+{
+    input_frame frame;
+    const vector<key_code> &keys = tracked_keys();
+    for (int i = 0; i < keys.size(); i++)
+    {
+        if (key_down(keys[i]))
+            frame.down |= 1u << i;
+        if (key_typed(keys[i]))
+            frame.typed |= 1u << i;
+        if (key_released(keys[i]))
+            frame.released |= 1u << i;
+    }
+    return frame;
+}
+
+// The input the simulation is running this tick with
+input_frame &current_input()
+{
+    static input_frame frame;
+    return frame;
+}
+
+// key_down, key_typed and key_released for gameplay, read from the current input frame
+bool player_key_down(key_code key)
+{
+    return (current_input().down & key_bit(key)) != 0;
+}
+
+bool player_key_typed(key_code key)
+{
+    return (current_input().typed & key_bit(key)) != 0;
+}
+
+bool player_key_released(key_code key)
+{
+    return (current_input().released & key_bit(key)) != 0;
+}
+
+// Player one's keys moved onto another player's bits, so whoever plays on this machine uses WASD and F.
+// Shared keys stay where they are.
+input_frame keys_for_slot(const input_frame &input, int slot)
+{
+    uint32_t keys = (1u << KEYS_PER_PLAYER) - 1;
+    uint32_t shared = shared_key_bits();
+    int shift = slot * KEYS_PER_PLAYER;
+
+    input_frame moved;
+    moved.down = ((input.down & keys) << shift) | (input.down & shared);
+    moved.typed = ((input.typed & keys) << shift) | (input.typed & shared);
+    moved.released = ((input.released & keys) << shift) | (input.released & shared);
+    return moved;
+}
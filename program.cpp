@@ -3,6 +3,11 @@
 #include "screen.h"
 #include "enemy.h"
 #include "testing.h"
+#include "atlaspacker.h"
+#include "residency.h"
+#include "metrics.h"
+#include "telemetry.h"
+#include <chrono>
 #include <memory>
 #include <vector>
 
@@ -19,7 +24,7 @@ vector<CellSheet> make_cell_sheets(vector<string> cell_sheet_names)
     int offset = 0;
     for (int i = 0; i < cell_sheet_names.size(); i++)
     {
-        bitmap new_bitmap = bitmap_named(cell_sheet_names[i]);
+        bitmap new_bitmap = asset_bitmap(cell_sheet_names[i]);
         CellSheet new_type(new_bitmap, cell_sheet_names[i], offset);
         offset += 100;
         cell_sheets.push_back(new_type);
@@ -30,19 +35,77 @@ vector<CellSheet> make_cell_sheets(vector<string> cell_sheet_names)
 
 int main(int argc, char *argv[])
 {
-    // Load Resources
-    load_resource_bundle("player", "playerbundle.txt");
-    load_resource_bundle("game_resources", "gameresources.txt");
-    load_resource_bundle("roach", "roachbundle.txt");
-    load_resource_bundle("snake", "snakebundle.txt");
-    load_resource_bundle("rat", "ratbundle.txt");
-    load_resource_bundle("menu", "menubundle.txt");
-    load_resource_bundle("blob", "blobbundle.txt");
+    // Checks and times the AABB kernels without opening the game
+    for (int i = 1; i < argc; i++)
+        if (string(argv[i]) == "-k")
+            return run_aabb_kernel_tests();
+
+    // Writes a run length copy of every numbered level's layer files, loaded instead of the text
+    for (int i = 1; i < argc; i++)
+        if (string(argv[i]) == "-c")
+        {
+            vector<string> layer_files;
+            for (int level = 1; level <= BENCH_LEVEL; level++)
+            {
+                vector<string> level_files = get_level_files(level);
+                layer_files.insert(layer_files.end(), level_files.begin(), level_files.end());
+            }
+            return write_sparse_layers(layer_files);
+        }
+
+    // Prints where players die on a level, from the telemetry of the runs kept
+    for (int i = 1; i + 1 < argc; i++)
+        if (string(argv[i]) == "-e")
+            return print_death_heatmap(stoi(argv[i + 1]), get_level_files(stoi(argv[i + 1])));
+
+    // Bundles and the names they are loaded under. The pinned ones are used by the menus or every
+    // level and stay loaded, the enemy bundles are loaded by the levels that need them.
+    vector<string> bundle_names = {"player", "game_resources", "menu", "roach", "snake", "rat", "blob", "water_rat"};
+    vector<string> bundle_files = {"playerbundle.txt", "gameresources.txt", "menubundle.txt", "roachbundle.txt", "snakebundle.txt", "ratbundle.txt", "blobbundle.txt", "waterRatbundle.txt"};
+    vector<bool> bundle_pinned = {true, true, true, false, false, false, false, false};
+
+    for (int i = 1; i < argc; i++)
+    {
+        // Parses every bundle into one pack file, run again whenever a bundle changes
+        if (string(argv[i]) == "-p")
+            return build_asset_pack(bundle_names, bundle_files);
+        // Times starting up from the bundles against starting up from the pack
+        if (string(argv[i]) == "-s")
+            return benchmark_startup(bundle_names, bundle_files);
+    }
+
+    // Load Resources, straight from the pack when there is one
+    open_asset_pack();
+    for (int i = 0; i < bundle_names.size(); i++)
+    {
+        asset_residency().add_bundle(bundle_names[i], bundle_files[i], bundle_pinned[i]);
+        if (bundle_pinned[i])
+            asset_residency().acquire(bundle_names[i]);
+    }
+
+    // Packs the cell sheets of the bundles above into atlas pages, run again whenever an image changes
+    for (int i = 1; i < argc; i++)
+        if (string(argv[i]) == "-a")
+        {
+            for (int j = 0; j < bundle_names.size(); j++)
+                asset_residency().acquire(bundle_names[j]);
+            return build_texture_atlas(bundle_files);
+        }
+
+    load_texture_atlas();
 
     open_window("Below The Surface", SCREEN_WIDTH, SCREEN_HEIGHT);
     
     bool test_screen = false;
     bool window_border = true;
+    bool threaded = true;
+    bool split_screen = false;
+    bool benchmark_players = false;
+    bool online = false;
+    bool watch_files = false;
+    int metrics_port = 0;
+    netplay_config netplay;
+    int party_size = 2;
     int refresh_rate = 60;
 
     vector<string> cell_sheet_names;
@@ -70,12 +133,6 @@ int main(int argc, char *argv[])
 
     // Timers
     create_timer("Dying");
-    create_timer("DamageTimerP1");
-    create_timer("DamageTimerP2");
-    create_timer("DyingTimerP1");
-    create_timer("DyingTimerP2");
-    create_timer("SpawnTimerP1");
-    create_timer("SpawnTimerP2");
     create_timer("DanceTime");
     create_timer("ScreenTimer");
 
@@ -100,6 +157,51 @@ int main(int argc, char *argv[])
             {
                 window_border = false;
             }
+            // Simulate levels on the main thread as well, for machines with one core
+            if (args[i] == "-1")
+            {
+                threaded = false;
+            }
+            // How many play when more than one player is picked, up to four
+            if (args[i] == "-n")
+            {
+                party_size = std::stoi(args[i + 1]);
+            }
+            // Times the benchmark level with one to four players
+            if (args[i] == "-m")
+            {
+                benchmark_players = true;
+            }
+            // Each player gets their own part of the screen in levels with more than one player
+            if (args[i] == "-2")
+            {
+                split_screen = true;
+            }
+            // Plays two player levels online: this machine's player slot, the port to listen on and
+            // where the other machine listens
+            if (args[i] == "-o")
+            {
+                online = true;
+                netplay.slot = std::stoi(args[i + 1]) == 1 ? 1 : 0;
+                netplay.local_port = std::stoi(args[i + 2]);
+                netplay.remote_host = args[i + 3];
+                netplay.remote_port = std::stoi(args[i + 4]);
+            }
+            // Milliseconds every online packet is held back for, to test rollback on one machine
+            if (args[i] == "-d")
+            {
+                netplay.latency_ms = std::stoi(args[i + 1]);
+            }
+            // Serves frame times, level timings and counts as JSON at http://localhost:{port}/metrics
+            if (args[i] == "-w")
+            {
+                metrics_port = std::stoi(args[i + 1]);
+            }
+            // Rebuilds the tiles of the level's layer files whenever one is saved
+            if (args[i] == "-f")
+            {
+                watch_files = true;
+            }
             if(args[i] == "-r")
             {
                 refresh_rate = std::stoi(args[i + i]);
@@ -113,6 +215,9 @@ int main(int argc, char *argv[])
         exit(1);
     }
     
+    if (benchmark_players)
+        return benchmark_player_counts(cell_sheets, TILE_SIZE);
+
     if(!window_border)
         window_toggle_border("Below The Surface");
 
@@ -128,21 +233,67 @@ int main(int argc, char *argv[])
         shared_ptr<Screen> normal_screen(new Screen(new MenuScreen, TILE_SIZE, cell_sheets, files));
         screen = normal_screen;
     }
+    screen->threaded = threaded && thread::hardware_concurrency() != 1;
+    screen->split_screen = split_screen;
+    screen->party_size = max(2, min(party_size, MAX_PLAYERS));
+
+    if (watch_files)
+    {
+        shared_ptr<LayerWatcher> watcher(new LayerWatcher);
+        screen->hot_reload = watcher;
+    }
 
-    while (!key_typed(ESCAPE_KEY) && !quit_requested())
+    // Online games start straight into the first level so both machines get there together
+    if (online)
+    {
+        shared_ptr<RollbackSession> session(new RollbackSession(netplay));
+        screen->netplay = session;
+        screen->set_players(2);
+        screen->change_state(new PreLevelScreen, "Pre Level");
+    }
+
+    // Events and high scores are written to Resources/databases from here on
+    telemetry().start(TILE_SIZE);
+
+    shared_ptr<MetricsServer> metrics;
+    if (metrics_port > 0)
+    {
+        shared_ptr<MetricsServer> server(new MetricsServer(metrics_port));
+        metrics = server;
+        metrics->start();
+    }
+
+    auto frame_start = chrono::steady_clock::now();
+    while (!key_typed(ESCAPE_KEY) && !quit_requested() && !screen->quitting)
     {
         screen->update();
         process_events();
         refresh_screen(refresh_rate);
+
+        if (metrics != nullptr)
+        {
+            auto frame_end = chrono::steady_clock::now();
+            double frame_ms = chrono::duration<double, milli>(frame_end - frame_start).count();
+            frame_start = frame_end;
+
+            if (screen->get_state_type() == "Level" && screen->current_level != nullptr)
+                metrics->publish(frame_ms, "Level", screen->level_number, screen->current_level->get_level_name(), screen->level_frame, render_queue().get_last_frame().tile_commands);
+            else
+                metrics->publish(frame_ms, screen->get_state_type(), 0, "", level_metrics(), 0);
+        }
     }
 
-    free_resource_bundle("player");
-    free_resource_bundle("game_resources");
-    free_resource_bundle("roach");
-    free_resource_bundle("snake");
-    free_resource_bundle("rat");
-    free_resource_bundle("menu");
-    free_resource_bundle("blob");
+    if (metrics != nullptr)
+        metrics->stop();
+
+    telemetry().stop();
+    write_line(telemetry().report());
+
+    text_cache().clear();
+    asset_residency().release_all();
+    asset_pack().free_decoded();
+    if (has_resource_bundle("atlas"))
+        free_resource_bundle("atlas");
     free_all_timers();
     return 0;
 }
\ No newline at end of file
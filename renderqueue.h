@@ -0,0 +1,378 @@
+#include "splashkit.h"
+#include "atlas.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// Draw layers, back to front. The level's first tile layer goes behind everyone, the others in front.
+#define DRAW_LAYER_BACKGROUND 0
+#define DRAW_LAYER_BACK_TILES 10
+#define DRAW_LAYER_DOOR 20
+#define DRAW_LAYER_ACTORS 30
+#define DRAW_LAYER_FRONT_TILES 40 // + level layer number
+#define DRAW_LAYER_HUD 90
+
+enum draw_command_kind
+{
+    DRAW_COMMAND_BITMAP,
+    DRAW_COMMAND_TEXT
+};
+
+struct draw_command
+{
+    int layer;
+    int sequence;
+    draw_command_kind kind;
+    bitmap image = nullptr;
+    int cell = -1;
+    double x = 0;
+    double y = 0;
+    drawing_options opts;
+    string text;
+    color text_color;
+    string font_name;
+    int font_size = 0;
+};
+
+struct render_stats
+{
+    int commands = 0;
+    int tile_commands = 0; // Tiles drawn, once per view they show in
+    int texture_switches = 0;
+    int unsorted_switches = 0; // What the switches would have been drawing in submission order
+};
+
+// Part of the screen showing the world from its own camera
+struct render_view
+{
+    rectangle area;
+    point_2d camera;
+};
+
+// A recorded frame, sorted and ready to draw. It holds no sprites, so it can be drawn while the
+// next frame is being simulated. Without views everything in it is in screen coordinates, with
+// them world positions are kept and drawn once into each view.
+struct render_frame
+{
+    vector<draw_command> commands;
+    vector<render_view> views;
+    int unsorted_switches = 0;
+    int tile_commands = 0;
+};
+
+// Collects a frame's drawing and does it all at once. Tiles never overlap inside a tile layer, so
+// those layers are sorted by texture and cell to draw each cell sheet in one run. Everything else
+// keeps the order it was submitted in. Outside a frame, submissions are drawn straight away.
+class RenderQueue
+{
+    private:
+        vector<draw_command> commands;
+        vector<render_view> views;
+        render_frame finished;
+        bool recording = false;
+        bool world_positions = false;
+        int layer = DRAW_LAYER_ACTORS;
+        render_stats last_frame;
+
+        static bool sorted_by_texture(int layer)
+        {
+            return (layer >= DRAW_LAYER_BACK_TILES && layer < DRAW_LAYER_DOOR) || (layer >= DRAW_LAYER_FRONT_TILES && layer < DRAW_LAYER_HUD);
+        };
+
+        static bool draws_before(const draw_command &one, const draw_command &two)
+        {
+            if (one.layer != two.layer)
+                return one.layer < two.layer;
+
+            if (sorted_by_texture(one.layer))
+            {
+                if (one.image != two.image)
+                    return one.image < two.image;
+                if (one.cell != two.cell)
+                    return one.cell < two.cell;
+            }
+
+            return one.sequence < two.sequence;
+        };
+
+        // The camera may move before the frame is drawn, so world positions are fixed to the
+        // screen position they had when they were submitted
+        void pin_to_screen(draw_command &command)
+        {
+            if (command.opts.camera == DRAW_TO_SCREEN)
+                return;
+
+            command.x -= camera_x();
+            command.y -= camera_y();
+            command.opts.camera = DRAW_TO_SCREEN;
+        };
+
+        void run(const draw_command &command, double x, double y, const drawing_options &opts)
+        {
+            switch (command.kind)
+            {
+                case DRAW_COMMAND_BITMAP:
+                    draw_bitmap(command.image, x, y, opts);
+                    break;
+                case DRAW_COMMAND_TEXT:
+                    // Fonts are decoded here rather than when recorded, as only the main thread draws
+                    asset_pack().require(ASSET_FONT, command.font_name);
+                    draw_text(command.text, command.text_color, command.font_name, command.font_size, x, y, opts);
+                    break;
+            }
+        };
+
+        void run(const draw_command &command)
+        {
+            run(command, command.x, command.y, command.opts);
+        };
+
+        // Places a world position with the view's camera, screen positions are left alone
+        void run_in_view(const draw_command &command, const render_view &view)
+        {
+            if (command.opts.camera == DRAW_TO_SCREEN)
+            {
+                run(command);
+                return;
+            }
+
+            drawing_options opts = command.opts;
+            opts.camera = DRAW_TO_SCREEN;
+            run(command, command.x - view.camera.x + view.area.x, command.y - view.camera.y + view.area.y, opts);
+        };
+
+        void submit(draw_command &command)
+        {
+            if (!recording)
+            {
+                run(command);
+                return;
+            }
+
+            command.layer = layer;
+            command.sequence = commands.size();
+            commands.push_back(command);
+        };
+
+    public:
+        RenderQueue(){};
+
+        ~RenderQueue(){};
+
+        // With world_positions the frame keeps world positions for views added before it ends
+        void begin_frame(bool world_positions = false)
+        {
+            commands.clear();
+            views.clear();
+            recording = true;
+            this->world_positions = world_positions;
+            layer = DRAW_LAYER_ACTORS;
+        };
+
+        // Views are drawn left to right in the order added, everything on the HUD layer goes over them once
+        void add_view(rectangle area, point_2d camera)
+        {
+            render_view view;
+            view.area = area;
+            view.camera = camera;
+            views.push_back(view);
+        };
+
+        // Layer the next submissions go on
+        void set_layer(int layer)
+        {
+            this->layer = layer;
+        };
+
+        void bitmap_command(bitmap image, double x, double y, drawing_options opts)
+        {
+            draw_command command;
+            command.kind = DRAW_COMMAND_BITMAP;
+            command.image = image;
+            command.cell = opts.draw_cell;
+            command.x = x;
+            command.y = y;
+            command.opts = opts;
+            texture_atlas().remap(command.image, command.opts);
+            if (recording && !world_positions)
+                pin_to_screen(command);
+            submit(command);
+        };
+
+        // Sprites are recorded as their visible layers' current cells, so the frame doesn't depend
+        // on the sprite staying where it was
+        void sprite_command(sprite s)
+        {
+            point_2d position = sprite_position(s);
+            int cell = sprite_current_cell(s);
+
+            for (int i = 0; i < sprite_visible_layer_count(s); i++)
+            {
+                int layer_index = sprite_visible_layer(s, i);
+                vector_2d offset = sprite_layer_offset(s, layer_index);
+
+                drawing_options opts = option_with_bitmap_cell(cell);
+                opts.angle = sprite_rotation(s);
+                opts.scale_x = sprite_scale(s);
+                opts.scale_y = sprite_scale(s);
+                bitmap_command(sprite_layer(s, layer_index), position.x + offset.x, position.y + offset.y, opts);
+            }
+        };
+
+        void text_command(string text, color clr, string font_name, int font_size, double x, double y, drawing_options opts)
+        {
+            draw_command command;
+            command.kind = DRAW_COMMAND_TEXT;
+            command.text = text;
+            command.text_color = clr;
+            command.font_name = font_name;
+            command.font_size = font_size;
+            command.x = x;
+            command.y = y;
+            command.opts = opts;
+            if (recording && !world_positions)
+                pin_to_screen(command);
+            submit(command);
+        };
+
+        // Stops recording and hands the frame over sorted, the frame's old storage is reused for
+        // the next one
+        void end_frame(render_frame &frame)
+        {
+            frame.unsorted_switches = 0;
+            frame.tile_commands = 0;
+            bitmap previous = nullptr;
+            for (int i = 0; i < commands.size(); i++)
+            {
+                if (sorted_by_texture(commands[i].layer))
+                    frame.tile_commands += 1;
+
+                if (commands[i].image != nullptr && commands[i].image != previous)
+                {
+                    frame.unsorted_switches += 1;
+                    previous = commands[i].image;
+                }
+            }
+
+            stable_sort(commands.begin(), commands.end(), draws_before);
+
+            frame.commands.swap(commands);
+            frame.views.swap(views);
+            commands.clear();
+            views.clear();
+            recording = false;
+            world_positions = false;
+        };
+
+        // Draws a finished frame, touches nothing the recording side uses
+        void draw(const render_frame &frame)
+        {
+            render_stats stats;
+            stats.commands = frame.commands.size();
+            stats.tile_commands = frame.tile_commands * max((int)frame.views.size(), 1);
+            stats.unsorted_switches = frame.unsorted_switches;
+
+            bitmap previous = nullptr;
+            if (frame.views.empty())
+            {
+                for (int i = 0; i < frame.commands.size(); i++)
+                {
+                    if (frame.commands[i].image != nullptr && frame.commands[i].image != previous)
+                    {
+                        stats.texture_switches += 1;
+                        previous = frame.commands[i].image;
+                    }
+                    run(frame.commands[i]);
+                }
+
+                last_frame = stats;
+                return;
+            }
+
+            int hud_start = frame.commands.size();
+            for (int v = 0; v < frame.views.size(); v++)
+            {
+                push_clip(frame.views[v].area);
+                for (int i = 0; i < frame.commands.size(); i++)
+                {
+                    if (frame.commands[i].layer >= DRAW_LAYER_HUD)
+                    {
+                        hud_start = i;
+                        break;
+                    }
+
+                    if (frame.commands[i].image != nullptr && frame.commands[i].image != previous)
+                    {
+                        stats.texture_switches += 1;
+                        previous = frame.commands[i].image;
+                    }
+                    run_in_view(frame.commands[i], frame.views[v]);
+                }
+                pop_clip();
+            }
+
+            // Sorted by layer, so the HUD is everything from the first command on its layer
+            for (int i = hud_start; i < frame.commands.size(); i++)
+            {
+                if (frame.commands[i].image != nullptr && frame.commands[i].image != previous)
+                {
+                    stats.texture_switches += 1;
+                    previous = frame.commands[i].image;
+                }
+                run(frame.commands[i]);
+            }
+
+            stats.commands = frame.commands.size() + (frame.views.size() - 1) * hud_start;
+            last_frame = stats;
+        };
+
+        // Draws everything submitted this frame
+        void flush()
+        {
+            end_frame(finished);
+            draw(finished);
+        };
+
+        render_stats get_last_frame()
+        {
+            return this->last_frame;
+        };
+
+        string report()
+        {
+            return to_string(last_frame.commands) + " draw commands, " + to_string(last_frame.texture_switches) + " texture switches (" + to_string(last_frame.unsorted_switches) + " unsorted)";
+        };
+};
+
+// The queue the calling thread records its frames into. The simulation thread records into its
+// own, so nothing is shared with the main thread, which draws the finished frames on its queue and
+// keeps the draw stats there.
+RenderQueue &render_queue()
+{
+    thread_local RenderQueue queue;
+    return queue;
+}
+
+void submit_bitmap(bitmap image, double x, double y, drawing_options opts)
+{
+    render_queue().bitmap_command(image, x, y, opts);
+}
+
+void submit_bitmap(string name, double x, double y, drawing_options opts)
+{
+    render_queue().bitmap_command(asset_bitmap(name), x, y, opts);
+}
+
+void submit_sprite(sprite s)
+{
+    render_queue().sprite_command(s);
+}
+
+void submit_text(string text, color clr, string font_name, int font_size, double x, double y, drawing_options opts)
+{
+    render_queue().text_command(text, clr, font_name, font_size, x, y, opts);
+}
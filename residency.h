@@ -0,0 +1,330 @@
+#include "splashkit.h"
+#include "assetpack.h"
+#include "behaviour.h"
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// Unused bundles stay loaded until everything resident goes over this
+#define ASSET_BUDGET_BYTES (96 * 1024 * 1024)
+
+struct resident_bundle
+{
+    string name;
+    string file;
+    bool pinned = false; // Needed by the menus and every level, never freed before exit
+    bool resident = false;
+    int refs = 0;
+    int last_used = 0;
+    size_t bytes = 0;
+};
+
+// Size of a file in Resources, 0 if it isn't there
+size_t resource_file_bytes(string file, resource_kind kind)
+{
+    ifstream in(path_to_resource(file, kind), ios::binary | ios::ate);
+    return in.fail() ? 0 : (size_t)in.tellg();
+}
+
+// Rough memory a loaded bundle takes: decoded pixels for its bitmaps, file size for the rest
+size_t estimate_bundle_bytes(string bundle_file)
+{
+    ifstream bundle;
+    bundle.open(path_to_resource(bundle_file, BUNDLE_RESOURCE));
+    if (bundle.fail())
+        return 0;
+
+    size_t bytes = 0;
+    string line;
+    while (getline(bundle, line))
+    {
+        if (line.rfind("//", 0) == 0)
+            continue;
+
+        vector<string> parts = split_bundle_line(line);
+        if (parts.size() < 3)
+            continue;
+
+        if (parts[0] == "BITMAP" && has_bitmap(parts[1]))
+            bytes += (size_t)bitmap_width(parts[1]) * bitmap_height(parts[1]) * 4;
+        else if (parts[0] == "SOUND")
+            bytes += resource_file_bytes(parts[2], SOUND_RESOURCE);
+        else if (parts[0] == "MUSIC")
+            bytes += resource_file_bytes(parts[2], MUSIC_RESOURCE);
+        else if (parts[0] == "FONT")
+            bytes += resource_file_bytes(parts[2], FONT_RESOURCE);
+    }
+
+    return bytes;
+}
+
+// Keeps track of which bundles are loaded and who needs them. Levels hold a reference to each
+// bundle they use; once nothing does the bundle can be evicted, oldest first, when memory goes over
+// budget. Works on the asset pack when there is one, otherwise on the bundle files.
+class AssetResidency
+{
+    private:
+        vector<resident_bundle> bundles;
+        deque<int> prefetch_queue;
+        int clock = 0;
+        int loads = 0;
+        int evictions = 0;
+
+        int find(string name)
+        {
+            for (int i = 0; i < bundles.size(); i++)
+                if (bundles[i].name == name)
+                    return i;
+            return -1;
+        };
+
+        // From the pack, assets are only decoded straight away when prefetching, otherwise
+        // they are decoded the first time they are used
+        void load(resident_bundle &bundle, bool decode_now)
+        {
+            int group = asset_pack().is_open() ? asset_pack().find_bundle(bundle.name) : -1;
+            if (group >= 0 && decode_now)
+                asset_pack().require_bundle(group);
+
+            if (bundle.resident)
+                return;
+
+            if (!asset_pack().is_open())
+                load_resource_bundle(bundle.name, bundle.file);
+
+            bundle.resident = true;
+            loads += 1;
+        };
+
+        void evict(resident_bundle &bundle)
+        {
+            if (asset_pack().is_open())
+            {
+                int group = asset_pack().find_bundle(bundle.name);
+                if (group >= 0)
+                    asset_pack().free_bundle(group);
+            }
+            else
+                free_resource_bundle(bundle.name);
+
+            bundle.resident = false;
+            bundle.bytes = 0;
+            evictions += 1;
+        };
+
+    public:
+        AssetResidency(){};
+
+        ~AssetResidency(){};
+
+        void add_bundle(string name, string file, bool pinned)
+        {
+            if (find(name) >= 0)
+                return;
+
+            resident_bundle bundle;
+            bundle.name = name;
+            bundle.file = file;
+            bundle.pinned = pinned;
+            bundles.push_back(bundle);
+        };
+
+        // Loads the bundle now if it isn't already and keeps it until released
+        void acquire(string name)
+        {
+            int i = find(name);
+            if (i < 0)
+                return;
+
+            load(bundles[i], false);
+            bundles[i].refs += 1;
+            bundles[i].last_used = ++clock;
+        };
+
+        void release(string name)
+        {
+            int i = find(name);
+            if (i < 0 || bundles[i].refs == 0)
+                return;
+
+            bundles[i].refs -= 1;
+            bundles[i].last_used = ++clock;
+            enforce_budget();
+        };
+
+        // Queues bundles to be loaded a frame at a time before anything needs them
+        void prefetch(vector<string> names)
+        {
+            for (int i = 0; i < names.size(); i++)
+            {
+                int found = find(names[i]);
+                if (found >= 0)
+                    prefetch_queue.push_back(found);
+            }
+        };
+
+        // Loads one queued bundle, call once a frame while nothing much else is happening
+        void update()
+        {
+            if (prefetch_queue.empty())
+                return;
+
+            resident_bundle &bundle = bundles[prefetch_queue.front()];
+            prefetch_queue.pop_front();
+            load(bundle, true);
+            bundle.last_used = ++clock;
+            enforce_budget();
+        };
+
+        // Frees unused bundles, least recently used first, until memory is back under budget. Sizes
+        // are measured again first as assets from the pack may have been decoded since.
+        void enforce_budget()
+        {
+            for (int i = 0; i < bundles.size(); i++)
+                if (bundles[i].resident)
+                    bundles[i].bytes = estimate_bundle_bytes(bundles[i].file);
+
+            while (get_resident_bytes() > ASSET_BUDGET_BYTES)
+            {
+                int oldest = -1;
+                for (int i = 0; i < bundles.size(); i++)
+                {
+                    if (!bundles[i].resident || bundles[i].pinned || bundles[i].refs > 0)
+                        continue;
+                    if (oldest < 0 || bundles[i].last_used < bundles[oldest].last_used)
+                        oldest = i;
+                }
+
+                if (oldest < 0)
+                    return;
+                evict(bundles[oldest]);
+            }
+        };
+
+        // Decodes every asset of the resident bundles that the pack has left until first use, so
+        // nothing is decoded once the simulation thread is looking assets up
+        void decode_resident()
+        {
+            if (!asset_pack().is_open())
+                return;
+
+            for (int i = 0; i < bundles.size(); i++)
+                if (bundles[i].resident)
+                    load(bundles[i], true);
+        };
+
+        // Frees everything at exit
+        void release_all()
+        {
+            prefetch_queue.clear();
+            for (int i = 0; i < bundles.size(); i++)
+            {
+                if (bundles[i].resident)
+                    evict(bundles[i]);
+                bundles[i].refs = 0;
+            }
+        };
+
+        bool is_resident(string name)
+        {
+            int i = find(name);
+            return i >= 0 && bundles[i].resident;
+        };
+
+        size_t get_resident_bytes()
+        {
+            size_t bytes = 0;
+            for (int i = 0; i < bundles.size(); i++)
+                if (bundles[i].resident)
+                    bytes += bundles[i].bytes;
+            return bytes;
+        };
+
+        string report()
+        {
+            string resident;
+            for (int i = 0; i < bundles.size(); i++)
+                if (bundles[i].resident)
+                    resident += " " + bundles[i].name + "(" + to_string(bundles[i].refs) + ")";
+
+            return to_string(get_resident_bytes() / 1024) + "KB resident," + resident + ", " + to_string(loads) + " loads, " + to_string(evictions) + " evictions";
+        };
+};
+
+AssetResidency &asset_residency()
+{
+    static AssetResidency residency;
+    return residency;
+}
+
+// Bundles a level needs beyond the pinned ones, worked out from the enemies in its files
+vector<string> level_bundles(vector<string> files)
+{
+    vector<string> bundles;
+
+    for (int f = 0; f < files.size(); f++)
+    {
+        ifstream level;
+        level.open(files[f]);
+        if (level.fail())
+            continue;
+
+        int tile;
+        while (level >> tile)
+        {
+            int type = enemy_type_from_tile(tile);
+            if (type < 0)
+                continue;
+
+            string bundle = get_enemy_kind(type).bundle_name;
+            if (find(bundles.begin(), bundles.end(), bundle) == bundles.end())
+                bundles.push_back(bundle);
+        }
+    }
+
+    return bundles;
+}
+
+// The bundles one owner is using, given back when the owner goes
+class BundleHold
+{
+    private:
+        vector<string> names;
+
+    public:
+        BundleHold(){};
+
+        ~BundleHold()
+        {
+            release();
+        };
+
+        BundleHold(const BundleHold &) = delete;
+        BundleHold &operator=(const BundleHold &) = delete;
+
+        void hold(vector<string> names)
+        {
+            for (int i = 0; i < names.size(); i++)
+                asset_residency().acquire(names[i]);
+            this->names.insert(this->names.end(), names.begin(), names.end());
+        };
+
+        void release()
+        {
+            for (int i = 0; i < names.size(); i++)
+                asset_residency().release(names[i]);
+            names.clear();
+        };
+
+        vector<string> get_names()
+        {
+            return this->names;
+        };
+};
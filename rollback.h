@@ -0,0 +1,338 @@
+#include "splashkit.h"
+#include "level.h"
+#include "playerinput.h"
+#include "renderqueue.h"
+#include "snapshot.h"
+#include "telemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#pragma once
+
+using namespace std;
+
+// Frames the game may run ahead of the last input it has from the other player
+#define NET_ROLLBACK_WINDOW 8
+// Frames local input is held back before it is used, hides a little latency without rolling back
+#define NET_INPUT_DELAY 2
+// Frames of input kept each way, well over the window and delay on both machines
+#define NET_INPUT_FRAMES 64
+// Frames between the rollback lines written to the console
+#define NET_REPORT_FRAMES 120
+
+// Who plays on this machine and where the other player is
+struct netplay_config
+{
+    int slot = 0;
+    unsigned short local_port = 0;
+    string remote_host = "127.0.0.1";
+    unsigned short remote_port = 0;
+    // Held onto every packet before it is sent, to try rollback out on one machine
+    int latency_ms = 0;
+};
+
+// Rollback and stall counts over a run of frames
+struct rollback_stats
+{
+    int frames = 0;
+    int rollbacks = 0;
+    int max_depth = 0;
+    long total_depth = 0;
+    double resim_ms = 0;
+    double max_resim_ms = 0;
+    int stalls = 0;
+
+    void add_rollback(int depth, double ms)
+    {
+        rollbacks += 1;
+        total_depth += depth;
+        max_depth = max(max_depth, depth);
+        resim_ms += ms;
+        max_resim_ms = max(max_resim_ms, ms);
+    };
+
+    string report() const
+    {
+        double frame_count = max(frames, 1);
+        return to_string(frames) + " frames, " + to_string(rollbacks) + " rollbacks, " + to_string(total_depth / frame_count) + " frames simulated again per frame (most " + to_string(max_depth) + "), " + to_string(resim_ms / frame_count) + "ms simulating again per frame (most " + to_string(max_resim_ms) + "ms), " + to_string(stalls) + " stalls";
+    };
+};
+
+// Two player online play over UDP. Both machines simulate every frame straight away, guessing
+// the other player keeps holding what they last held. When the real input for a frame turns out
+// different, the level goes back to that frame's snapshot and the frames since are simulated
+// again. Each packet carries all the input the other machine hasn't confirmed, so a lost packet
+// is made up by the next one.
+class RollbackSession
+{
+    private:
+        netplay_config config;
+        server_socket server = nullptr;
+        connection peer = nullptr;
+        shared_ptr<Level> level;
+        // Levels started, both machines go through the same ones so packets from another are dropped
+        int round = 0;
+        // The next frame to simulate
+        int frame = 0;
+
+        input_frame local_inputs[NET_INPUT_FRAMES];
+        input_frame remote_inputs[NET_INPUT_FRAMES];
+        int remote_frame_of[NET_INPUT_FRAMES]; // Which frame each remote input is for, -1 if none yet
+        input_frame remote_used[NET_INPUT_FRAMES]; // What each frame was simulated with, guessed or not
+        // The first frame the other machine's input hasn't arrived for, and the first of ours it lacks
+        int remote_next = 0;
+        int remote_ack = 0;
+        // The earliest frame simulated with a wrong guess, -1 when none has been
+        int rollback_to = -1;
+        // Presses and releases made while stalled, used on the next frame that runs
+        input_frame held_keys;
+
+        level_snapshot snapshots[NET_ROLLBACK_WINDOW + 1];
+        render_frame drawn;
+        render_frame discarded;
+        // Status after each frame, and as of the last frame both inputs are known for so a
+        // wrong guess can't end the level
+        level_status statuses[NET_INPUT_FRAMES];
+        level_status confirmed_status;
+        deque<pair<chrono::steady_clock::time_point, string>> outgoing;
+
+        rollback_stats total;
+        rollback_stats recent;
+
+        int remote_slot()
+        {
+            return 1 - config.slot;
+        };
+
+        // A slot's own keys and the shared ones, everything else in a packet is dropped
+        uint32_t slot_keys(int slot)
+        {
+            return (((1u << KEYS_PER_PLAYER) - 1) << (slot * KEYS_PER_PLAYER)) | shared_key_bits();
+        };
+
+        static bool same_input(const input_frame &one, const input_frame &other)
+        {
+            return one.down == other.down && one.typed == other.typed && one.released == other.released;
+        };
+
+        // The other player's input for the frame, or a guess that they still hold the same keys
+        input_frame remote_input(int at)
+        {
+            if (remote_frame_of[at % NET_INPUT_FRAMES] == at)
+                return remote_inputs[at % NET_INPUT_FRAMES];
+
+            input_frame guess;
+            if (remote_next > 0)
+                guess.down = remote_inputs[(remote_next - 1) % NET_INPUT_FRAMES].down;
+            return guess;
+        };
+
+        // Packets are "round ack first down typed released down typed released ..."
+        void read_packet(const string &data)
+        {
+            istringstream packet(data);
+            int packet_round, ack, first;
+            if (!(packet >> packet_round >> ack >> first) || packet_round != round)
+                return;
+
+            remote_ack = max(remote_ack, ack);
+
+            input_frame input;
+            for (int at = first; packet >> input.down >> input.typed >> input.released; at++)
+            {
+                if (at < remote_next || at >= remote_next + NET_INPUT_FRAMES || remote_frame_of[at % NET_INPUT_FRAMES] == at)
+                    continue;
+
+                uint32_t keys = slot_keys(remote_slot());
+                input.down &= keys;
+                input.typed &= keys;
+                input.released &= keys;
+
+                remote_inputs[at % NET_INPUT_FRAMES] = input;
+                remote_frame_of[at % NET_INPUT_FRAMES] = at;
+
+                if (at < frame && !same_input(input, remote_used[at % NET_INPUT_FRAMES]))
+                    rollback_to = rollback_to < 0 ? at : min(rollback_to, at);
+            }
+
+            while (remote_frame_of[remote_next % NET_INPUT_FRAMES] == remote_next)
+                remote_next += 1;
+        };
+
+        void poll()
+        {
+            check_network_activity();
+            while (has_messages(server))
+            {
+                message msg = read_message(server);
+                read_packet(message_data(msg));
+                close_message(msg);
+            }
+        };
+
+        // Everything of ours the other machine hasn't confirmed, queued behind the latency
+        void send_inputs(int local_next)
+        {
+            int first = max(remote_ack, local_next - NET_INPUT_FRAMES + 1);
+            string packet = to_string(round) + " " + to_string(remote_next) + " " + to_string(first);
+            for (int at = first; at < local_next; at++)
+            {
+                input_frame &input = local_inputs[at % NET_INPUT_FRAMES];
+                packet += " " + to_string(input.down) + " " + to_string(input.typed) + " " + to_string(input.released);
+            }
+
+            outgoing.push_back(make_pair(chrono::steady_clock::now() + chrono::milliseconds(config.latency_ms), packet));
+            while (!outgoing.empty() && outgoing.front().first <= chrono::steady_clock::now())
+            {
+                send_message_to(outgoing.front().second, peer);
+                outgoing.pop_front();
+            }
+        };
+
+        void simulate_frame(render_frame &recorded)
+        {
+            level->save_frame(snapshots[frame % (NET_ROLLBACK_WINDOW + 1)]);
+
+            input_frame remote = remote_input(frame);
+            input_frame &local = local_inputs[frame % NET_INPUT_FRAMES];
+            remote_used[frame % NET_INPUT_FRAMES] = remote;
+
+            current_input().down = local.down | remote.down;
+            current_input().typed = local.typed | remote.typed;
+            current_input().released = local.released | remote.released;
+            level->simulate();
+            render_queue().end_frame(recorded);
+
+            statuses[frame % NET_INPUT_FRAMES] = level->get_status();
+            frame += 1;
+        };
+
+        // Back to the first wrongly guessed frame and forward again to where the game was
+        void roll_back()
+        {
+            auto start = chrono::steady_clock::now();
+            int depth = frame - rollback_to;
+            int end = frame;
+
+            frame = rollback_to;
+            rollback_to = -1;
+            level->load_frame(snapshots[frame % (NET_ROLLBACK_WINDOW + 1)]);
+            // What happened in these frames was recorded and heard the first time they were simulated
+            telemetry().set_muted(true);
+            sound_effects_muted() = true;
+            while (frame < end)
+                simulate_frame(frame + 1 < end ? discarded : drawn);
+            sound_effects_muted() = false;
+            telemetry().set_muted(false);
+
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            total.add_rollback(depth, ms);
+            recent.add_rollback(depth, ms);
+        };
+
+        void count_frame()
+        {
+            total.frames += 1;
+            recent.frames += 1;
+            if (recent.frames < NET_REPORT_FRAMES)
+                return;
+
+            write_line("Rollback: " + recent.report());
+            recent = rollback_stats();
+        };
+
+    public:
+        RollbackSession(netplay_config config)
+        {
+            this->config = config;
+            this->server = create_server("NetplayServer", config.local_port, UDP);
+            this->peer = open_connection("NetplayPeer", config.remote_host, config.remote_port, UDP);
+        };
+
+        ~RollbackSession()
+        {
+            close_all_connections();
+            close_all_servers();
+        };
+
+        RollbackSession(const RollbackSession &) = delete;
+        RollbackSession &operator=(const RollbackSession &) = delete;
+
+        // Starts a level from its first frame, both machines call this as they reach the level
+        void start(shared_ptr<Level> level)
+        {
+            this->level = level;
+            this->level->set_lockstep(true);
+            this->round += 1;
+            this->frame = 0;
+            this->rollback_to = -1;
+            this->remote_ack = 0;
+            this->held_keys = input_frame();
+            this->confirmed_status = level->get_status();
+            this->outgoing.clear();
+
+            // Nobody has input for the frames the delay holds back, both sides know them already
+            for (int i = 0; i < NET_INPUT_FRAMES; i++)
+            {
+                local_inputs[i] = input_frame();
+                remote_inputs[i] = input_frame();
+                remote_frame_of[i] = i < NET_INPUT_DELAY ? i : -1;
+            }
+            this->remote_next = NET_INPUT_DELAY;
+        };
+
+        // One displayed frame: take in the other player's input, roll back if a guess was wrong,
+        // then simulate and draw the next frame unless the other player is too far behind
+        void update()
+        {
+            poll();
+            if (rollback_to >= 0)
+                roll_back();
+
+            input_frame keys = keys_for_slot(capture_input(), config.slot);
+            held_keys.typed |= keys.typed;
+            held_keys.released |= keys.released;
+
+            if (frame - remote_next >= NET_ROLLBACK_WINDOW)
+            {
+                total.stalls += 1;
+                recent.stalls += 1;
+                send_inputs(frame + NET_INPUT_DELAY);
+                level->present(drawn, level->get_hud_values());
+                return;
+            }
+
+            keys.typed = held_keys.typed;
+            keys.released = held_keys.released;
+            held_keys = input_frame();
+            local_inputs[(frame + NET_INPUT_DELAY) % NET_INPUT_FRAMES] = keys;
+            send_inputs(frame + NET_INPUT_DELAY + 1);
+
+            simulate_frame(drawn);
+            level->present(drawn, level->get_hud_values());
+            count_frame();
+
+            int confirmed = min(remote_next, frame) - 1;
+            if (confirmed >= 0)
+                confirmed_status = statuses[confirmed % NET_INPUT_FRAMES];
+        };
+
+        shared_ptr<Level> get_level()
+        {
+            return this->level;
+        };
+
+        level_status get_status()
+        {
+            return this->confirmed_status;
+        };
+
+        string report()
+        {
+            return "Rollback: " + total.report();
+        };
+};
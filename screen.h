@@ -1,10 +1,16 @@
 #include "splashkit.h"
+#include "textcache.h"
+#include "assetpack.h"
 #include "level.h"
 #include "cellsheet.h"
 #include "get_level.h"
 #include "texteffect.h"
 #include "button.h"
 #include "password.h"
+#include "simthread.h"
+#include "rollback.h"
+#include "telemetry.h"
+#include "hotreload.h"
 #include <memory>
 #include <vector>
 
@@ -42,12 +48,29 @@ class Screen
         int players = 1;
         vector<CellSheet> cell_sheets;
         vector<string> files;
+        // Which level current_level was built as and for how many players, 0 when it is a custom level
+        int built_level = 0;
+        int built_players = 0;
 
     public:
         key_code input_key = F_KEY;
+        // Levels simulate on their own thread and this one only draws
+        bool threaded = true;
+        // Levels with more than one player give each their own part of the screen
+        bool split_screen = false;
+        // How many play when the menu's multiplayer option is picked
+        int party_size = 2;
+        // Set when the second player is on another machine, two player levels are then played online
+        shared_ptr<RollbackSession> netplay;
+        // Set to rebuild the tiles of the level's layer files as they are saved
+        shared_ptr<LayerWatcher> hot_reload;
+        // The level tick behind the frame last drawn, for the metrics endpoint
+        level_metrics level_frame;
         int level_number = 1;
         int max_levels = 5;
         shared_ptr<Level> current_level;
+        // Set by the menu's quit option, the game then shuts down the same way as on escape
+        bool quitting = false;
 
         Screen(ScreenState *state, int tile_size, vector<CellSheet> cell_sheets, vector<string> files) : state(nullptr)
         {
@@ -80,6 +103,11 @@ class Screen
             return this->tile_size;
         };
 
+        string get_state_type()
+        {
+            return this->state->get_type();
+        };
+
         int get_players()
         {
             return this->players;
@@ -99,6 +127,34 @@ class Screen
         {
             return this->files;
         };
+
+        // Builds the level for level_number, or restores the one already built if it is the same
+        void load_level()
+        {
+            telemetry().set_level(this->level_number, this->players);
+            telemetry().record_level(TELEMETRY_LEVEL_START);
+
+            if (this->current_level != nullptr && this->built_level == this->level_number && this->built_players == this->players)
+            {
+                this->current_level->restart();
+                return;
+            }
+
+            this->current_level = get_next_level(this->level_number, this->cell_sheets, this->tile_size, this->players);
+            this->current_level->set_split_screen(this->split_screen && this->netplay == nullptr);
+            this->built_level = this->level_number;
+            this->built_players = this->players;
+        };
+
+        void set_custom_level(shared_ptr<Level> level)
+        {
+            this->current_level = level;
+            this->current_level->set_split_screen(this->split_screen && this->netplay == nullptr);
+            this->built_level = 0;
+
+            telemetry().set_level(0, this->players);
+            telemetry().record_level(TELEMETRY_LEVEL_START);
+        };
 };
 
 class CompanyIntroScreen : public ScreenState
@@ -183,6 +239,9 @@ class LevelScreen : public ScreenState
         bool run_once = false;
         bool pause = false;
         bool pause_run_once;
+        // Stopped whenever the level is used from here, it starts again on the next frame
+        SimulationThread simulation;
+        bool netplay_started = false;
 
     public:
         LevelScreen(){};
@@ -197,29 +256,54 @@ class LevelScreen : public ScreenState
             if (key_typed(M_KEY))
             {
                 this->screen->level_number = 1;
-                this->screen->current_level = get_next_level(this->screen->level_number, this->screen->get_cell_sheets(), this->screen->get_tile_size(), this->screen->get_players());
                 this->screen->change_state(new MenuScreen, "Menu");
             }
         
+            if (key_typed(NUM_0_KEY))
+            {
+                simulation.stop();
+                write_line(this->screen->current_level->get_memory_report());
+                write_line(this->screen->current_level->get_collision_report());
+                write_line(render_queue().report());
+                write_line(asset_residency().report());
+                write_line(text_cache().report());
+                if (this->screen->netplay != nullptr)
+                    write_line(this->screen->netplay->report());
+            }
+
             if (!pause)
             {
                 if (key_typed(NUM_1_KEY))
                 {
+                    simulation.stop();
                     if (this->screen->level_number < this->screen->max_levels)
                     {
                         this->screen->level_number += 1;
-                        this->screen->current_level = get_next_level(this->screen->level_number, this->screen->get_cell_sheets(), this->screen->get_tile_size(), this->screen->get_players());
+                        this->screen->load_level();
                     }
                 }
 
                 if (key_typed(NUM_2_KEY))
                 {
+                    simulation.stop();
                     if (this->screen->level_number > 1)
                     {
                         this->screen->level_number -= 1;
-                        this->screen->current_level = get_next_level(this->screen->level_number, this->screen->get_cell_sheets(), this->screen->get_tile_size(), this->screen->get_players());
+                        this->screen->load_level();
                     }
                 }
+
+                if (key_typed(NUM_3_KEY))
+                {
+                    simulation.stop();
+                    this->screen->current_level->save_checkpoint();
+                }
+
+                if (key_typed(NUM_4_KEY))
+                {
+                    simulation.stop();
+                    this->screen->current_level->load_checkpoint();
+                }
             }
 
             if (key_typed(RETURN_KEY))
@@ -332,9 +416,9 @@ void CompanyIntroScreen::update()
     point_2d pt = screen_center();
     clear_screen(COLOR_BLACK);
     
-    bitmap title = bitmap_named("Company1");
-    bitmap title2 = bitmap_named("Company2");
-    font screen_font = font_named("DefaultFont");
+    bitmap title = asset_bitmap("Company1");
+    bitmap title2 = asset_bitmap("Company2");
+    string screen_font = "DefaultFont";
     int font_size = 80;
     color font_color = COLOR_WHITE;
     string text = "Games";
@@ -342,8 +426,8 @@ void CompanyIntroScreen::update()
     draw_bitmap(title2, pt.x - bitmap_width(title2)/2 + 5, pt.y - bitmap_height(title2)/2 - 5, option_to_screen());
     draw_bitmap(title, pt.x - bitmap_width(title)/2, pt.y - bitmap_height(title)/2, option_to_screen());
 
-    draw_text(text, COLOR_BROWN, screen_font, font_size, pt.x- text_width(text, screen_font, font_size)/2 + 5, (pt.y - text_height(text, screen_font, font_size)/2) + 200 - 5, option_to_screen());
-    draw_text(text, font_color, screen_font, font_size, pt.x- text_width(text, screen_font, font_size)/2, (pt.y - text_height(text, screen_font, font_size)/2) + 200, option_to_screen());
+    draw_cached_text(text, COLOR_BROWN, screen_font, font_size, pt.x- cached_text_width(text, screen_font, font_size)/2 + 5, (pt.y - cached_text_height(text, screen_font, font_size)/2) + 200 - 5, option_to_screen());
+    draw_cached_text(text, font_color, screen_font, font_size, pt.x- cached_text_width(text, screen_font, font_size)/2, (pt.y - cached_text_height(text, screen_font, font_size)/2) + 200, option_to_screen());
 
     bool time_up = screen_timer(screen_time, "ScreenTimer");
 
@@ -365,8 +449,8 @@ void TeamIntroScreen::update()
     point_2d pt = screen_center();
     clear_screen(COLOR_BLACK);
 
-    bitmap logo = bitmap_named("TeamLogo");
-    font screen_font = font_named("DefaultFont");
+    bitmap logo = asset_bitmap("TeamLogo");
+    string screen_font = "DefaultFont";
     int font_size = 30;
     color font_color = COLOR_WHITE;
     string text = "Morgaine Barter";
@@ -378,12 +462,12 @@ void TeamIntroScreen::update()
 
     draw_bitmap(logo, pt.x - bitmap_width(logo)/2, pt.y - bitmap_height(logo)/2 - 150, option_to_screen());
 
-    draw_text(text, font_color, screen_font, font_size, pt.x- text_width(text, screen_font, font_size)/2, (pt.y - text_height(text, screen_font, font_size)/2) + 150, option_to_screen());
-    draw_text(text2, font_color, screen_font, font_size, pt.x- text_width(text2, screen_font, font_size)/2, (pt.y - text_height(text2, screen_font, font_size)/2) + 150 + text_height(text2, screen_font, font_size) * 1, option_to_screen());
-    draw_text(text3, font_color, screen_font, font_size, pt.x- text_width(text3, screen_font, font_size)/2, (pt.y - text_height(text3, screen_font, font_size)/2) + 150 + text_height(text3, screen_font, font_size) * 2, option_to_screen());
-    draw_text(text4, font_color, screen_font, font_size, pt.x- text_width(text4, screen_font, font_size)/2, (pt.y - text_height(text4, screen_font, font_size)/2) + 150 + text_height(text4, screen_font, font_size) * 3, option_to_screen());
-    draw_text(text5, font_color, screen_font, font_size, pt.x- text_width(text5, screen_font, font_size)/2, (pt.y - text_height(text5, screen_font, font_size)/2) + 150 + text_height(text5, screen_font, font_size) * 4, option_to_screen());
-    draw_text(text6, font_color, screen_font, font_size, pt.x- text_width(text6, screen_font, font_size)/2, (pt.y - text_height(text6, screen_font, font_size)/2) + 150 + text_height(text6, screen_font, font_size) * 6, option_to_screen());
+    draw_cached_text(text, font_color, screen_font, font_size, pt.x- cached_text_width(text, screen_font, font_size)/2, (pt.y - cached_text_height(text, screen_font, font_size)/2) + 150, option_to_screen());
+    draw_cached_text(text2, font_color, screen_font, font_size, pt.x- cached_text_width(text2, screen_font, font_size)/2, (pt.y - cached_text_height(text2, screen_font, font_size)/2) + 150 + cached_text_height(text2, screen_font, font_size) * 1, option_to_screen());
+    draw_cached_text(text3, font_color, screen_font, font_size, pt.x- cached_text_width(text3, screen_font, font_size)/2, (pt.y - cached_text_height(text3, screen_font, font_size)/2) + 150 + cached_text_height(text3, screen_font, font_size) * 2, option_to_screen());
+    draw_cached_text(text4, font_color, screen_font, font_size, pt.x- cached_text_width(text4, screen_font, font_size)/2, (pt.y - cached_text_height(text4, screen_font, font_size)/2) + 150 + cached_text_height(text4, screen_font, font_size) * 3, option_to_screen());
+    draw_cached_text(text5, font_color, screen_font, font_size, pt.x- cached_text_width(text5, screen_font, font_size)/2, (pt.y - cached_text_height(text5, screen_font, font_size)/2) + 150 + cached_text_height(text5, screen_font, font_size) * 4, option_to_screen());
+    draw_cached_text(text6, font_color, screen_font, font_size, pt.x- cached_text_width(text6, screen_font, font_size)/2, (pt.y - cached_text_height(text6, screen_font, font_size)/2) + 150 + cached_text_height(text6, screen_font, font_size) * 6, option_to_screen());
 
     bool time_up = screen_timer(5, "ScreenTimer");
 
@@ -438,7 +522,7 @@ void MenuScreen::update()
         for(int i = 0; i < num_buttons; i++)
         {
             string text = get_button_text(i + 1);
-            shared_ptr<Button> test(new Button(bitmap_named("Button"), offset, i, text));
+            shared_ptr<Button> test(new Button(asset_bitmap("Button"), offset, i, text));
             offset += 100;
             menu_buttons.push_back(test);
         }
@@ -455,7 +539,7 @@ void MenuScreen::update()
     clear_screen(COLOR_BLACK);
     draw_bitmap("MenuBg", 0, 0, option_to_screen());
 
-    bitmap title = bitmap_named("Title");
+    bitmap title = asset_bitmap("Title");
     drawing_options scale = option_scale_bmp(2, 2);
     draw_bitmap(title, pt.x - bitmap_width(title)/2, 100, scale);
 
@@ -489,7 +573,7 @@ void MenuScreen::update()
         {
             case 0:
                 {
-                    play_sound_effect("Select");
+                    play_asset_sound("Select");
                     this->screen->set_players(1);
                     stop_music();
                     this->screen->change_state(new PreLevelScreen, "Pre Level");
@@ -497,21 +581,21 @@ void MenuScreen::update()
                 break;
             case 1:
                 {
-                    play_sound_effect("Select");
-                    this->screen->set_players(2);
+                    play_asset_sound("Select");
+                    this->screen->set_players(this->screen->party_size);
                     stop_music();
                     this->screen->change_state(new PreLevelScreen, "Pre Level");
                 }
                 break;
             case 2:
                 {
-                    play_sound_effect("Select");
+                    play_asset_sound("Select");
                     this->screen->change_state(new PasswordScreen, "Password");
                 }
             break;
                 case 4:
                 {
-                    exit(0);
+                    this->screen->quitting = true;
                 }
                 break;
             default:
@@ -522,7 +606,7 @@ void MenuScreen::update()
 
 void PreLevelScreen::update()
 {
-    font screen_font = font_named("DefaultFont");
+    string screen_font = "DefaultFont";
     point_2d pt = screen_center();
     int font_size = 40;
     int font_size_password = 15;
@@ -534,12 +618,16 @@ void PreLevelScreen::update()
         if(this->screen->get_files().size() != 0)
         {
             shared_ptr<Level> custom_level(new BlankLevel(this->screen->get_cell_sheets(),this->screen->get_tile_size(),this->screen->get_players(),this->screen->get_files().size(),this->screen->get_files()));
-            this->screen->current_level = custom_level;
+            this->screen->set_custom_level(custom_level);
             this->screen->max_levels = 1;
         }
         else
         {
-            this->screen->current_level = get_next_level(this->screen->level_number, this->screen->get_cell_sheets(), this->screen->get_tile_size(), this->screen->get_players());
+            this->screen->load_level();
+
+            // Start loading what the level after this one needs while this screen is up
+            if (this->screen->level_number < this->screen->max_levels)
+                asset_residency().prefetch(level_bundles(get_level_files(this->screen->level_number + 1)));
         }
 
         image = this->screen->current_level->get_pre_level_image();
@@ -556,13 +644,14 @@ void PreLevelScreen::update()
     string password = "Password: " + this->screen->current_level->get_level_password();
 
     clear_screen(COLOR_BLACK);
-    draw_text(chapter_text, COLOR_WHITE, screen_font, font_size, pt.x - text_width(chapter_text, screen_font, font_size)/2, 20);
-    draw_text(level_text, COLOR_WHITE, screen_font, font_size, pt.x - text_width(level_text, screen_font, font_size)/2, 80);
-    draw_text(password, COLOR_WHITE, screen_font, font_size_password, pt.x - text_width(password, screen_font, font_size_password)/2, screen_height() - 30);
+    draw_cached_text(chapter_text, COLOR_WHITE, screen_font, font_size, pt.x - cached_text_width(chapter_text, screen_font, font_size)/2, 20);
+    draw_cached_text(level_text, COLOR_WHITE, screen_font, font_size, pt.x - cached_text_width(level_text, screen_font, font_size)/2, 80);
+    draw_cached_text(password, COLOR_WHITE, screen_font, font_size_password, pt.x - cached_text_width(password, screen_font, font_size_password)/2, screen_height() - 30);
 
     draw_bitmap(image, pt.x - bitmap_width(image)/2, pt.y - bitmap_height(image)/2 - 30, option_to_screen());
 
     text_effect->update();
+    asset_residency().update();
 
     bool time_up = screen_timer(5, "ScreenTimer");
 
@@ -581,12 +670,55 @@ void LevelScreen::update()
 {
     if(!pause)
     {
-        this->screen->current_level->update();
+        // Online both machines have to play the same level, so files are only watched offline
+        if(this->screen->hot_reload != nullptr && this->screen->netplay == nullptr)
+        {
+            if(this->screen->hot_reload->get_level() != this->screen->current_level)
+                this->screen->hot_reload->watch(this->screen->current_level);
+
+            if(this->screen->hot_reload->poll())
+            {
+                simulation.stop();
+                this->screen->hot_reload->apply();
+            }
+        }
+
+        level_status status;
+        if(this->screen->netplay != nullptr && this->screen->get_players() == 2)
+        {
+            // Simulated here, a rollback has to go back and simulate again within the frame
+            if(!netplay_started || this->screen->netplay->get_level() != this->screen->current_level)
+            {
+                this->screen->netplay->start(this->screen->current_level);
+                netplay_started = true;
+            }
+            this->screen->netplay->update();
+            status = this->screen->netplay->get_status();
+            this->screen->level_frame = this->screen->current_level->get_metrics();
+        }
+        else if(this->screen->threaded)
+        {
+            if(!simulation.is_running())
+                simulation.start(this->screen->current_level);
+            simulation.post_input(capture_input());
+            simulation.present();
+            status = simulation.get_status();
+            this->screen->level_frame = simulation.get_metrics();
+        }
+        else
+        {
+            this->screen->current_level->update();
+            status = this->screen->current_level->get_status();
+            this->screen->level_frame = this->screen->current_level->get_metrics();
+        }
 
-        if(this->screen->current_level->player1_complete && this->screen->current_level->player2_complete)
+        if(status.all_complete())
         {
             if(!timer_started("DanceTime"))
+            {
                 start_timer("DanceTime");
+                telemetry().record_level(TELEMETRY_LEVEL_COMPLETE);
+            }
             int time = timer_ticks("DanceTime")/1000; // Changed to int, was u_int
             if(time > 2)
             {
@@ -604,10 +736,11 @@ void LevelScreen::update()
         }
         else
         {
-            if(this->screen->current_level->is_player1_out_of_lives || this->screen->current_level->is_player2_out_of_lives)
+            if(status.anyone_out_of_lives())
             {
+                telemetry().record_level(TELEMETRY_LEVEL_FAILED);
+                // Chapter one is restored from its snapshot rather than built again when it comes round
                 this->screen->level_number = 1;
-                this->screen->current_level = get_next_level(this->screen->level_number,this->screen->get_cell_sheets(),this->screen->get_tile_size(),this->screen->get_players());
                 this->screen->change_state(new GameOverScreen, "GameOver");
             }
         }
@@ -634,20 +767,20 @@ void GameOverScreen::update()
    if (!run_once)
     {
         if (!sound_effect_playing("GameOver"))
-            play_sound_effect("GameOver");    
+            play_asset_sound("GameOver");    
         stop_music();
         run_once = true;
     }
 
     point_2d pt = screen_center();
     string game_over_text = "Game Over";
-    font screen_font = font_named("DefaultFont");
+    string screen_font = "DefaultFont";
     int font_size = 80;
     color font_color = COLOR_WHITE_SMOKE;
 
-    draw_text(game_over_text, font_color, screen_font, font_size, pt.x - text_width(game_over_text, screen_font, font_size)/2, (pt.y - text_height(game_over_text, screen_font, font_size)/2) - 300, option_to_screen());
+    draw_cached_text(game_over_text, font_color, screen_font, font_size, pt.x - cached_text_width(game_over_text, screen_font, font_size)/2, (pt.y - cached_text_height(game_over_text, screen_font, font_size)/2) - 300, option_to_screen());
 
-    bitmap game_over = bitmap_named("GameOver");
+    bitmap game_over = asset_bitmap("GameOver");
     fill_rectangle(COLOR_WHITE_SMOKE, pt.x - bitmap_width(game_over)/2 - 10, pt.y - bitmap_height(game_over)/2 - 10, bitmap_width(game_over) + 20, bitmap_height(game_over) + 20);
     draw_bitmap(game_over, pt.x - bitmap_width(game_over)/2, pt.y - bitmap_height(game_over)/2, option_to_screen());
 
@@ -662,24 +795,23 @@ void WinScreen::update()
     if (!run_once)
     {
         if (!sound_effect_playing("GameWin"))
-            play_sound_effect("GameWin");    
+            play_asset_sound("GameWin");    
         stop_music();
         run_once = true;
     }
     string game_over_text = "Game Over";
-    font screen_font = font_named("DefaultFont");
+    string screen_font = "DefaultFont";
     int font_size = 15;
     color font_color = COLOR_WHITE_SMOKE;
 
     clear_screen(COLOR_BLACK);
-    draw_text("You Won", font_color, screen_font, font_size, 800, 400, option_to_screen());
-    draw_text("Good Job", font_color, screen_font, font_size, 800, 410, option_to_screen());
-    draw_text("Press Enter to go to Menu", font_color, screen_font, font_size, 740, 420, option_to_screen());
+    draw_cached_text("You Won", font_color, screen_font, font_size, 800, 400, option_to_screen());
+    draw_cached_text("Good Job", font_color, screen_font, font_size, 800, 410, option_to_screen());
+    draw_cached_text("Press Enter to go to Menu", font_color, screen_font, font_size, 740, 420, option_to_screen());
     
     if(key_typed(RETURN_KEY) || key_typed(screen->input_key))
     {
         this->screen->level_number = 1;
-        this->screen->current_level = get_next_level(this->screen->level_number,this->screen->get_cell_sheets(),this->screen->get_tile_size(),this->screen->get_players());
         this->screen->change_state(new MenuScreen, "Menu");
     }
 }
@@ -688,17 +820,16 @@ void CreditsScreen::update()
 {
     // point_2d pt = screen_center();
     string game_over_text = "Game Over";
-    font screen_font = font_named("DefaultFont");
+    string screen_font = "DefaultFont";
     int font_size = 80;
     color font_color = COLOR_WHITE_SMOKE;
 
     clear_screen(COLOR_BLACK);
-    draw_text("Test", font_color, screen_font, font_size, 800, 400, option_to_screen());
+    draw_cached_text("Test", font_color, screen_font, font_size, 800, 400, option_to_screen());
 
     if(key_typed(RETURN_KEY) || key_typed(screen->input_key))
     {
         this->screen->level_number = 1;
-        this->screen->current_level = get_next_level(this->screen->level_number,this->screen->get_cell_sheets(),this->screen->get_tile_size(),this->screen->get_players());
         this->screen->change_state(new MenuScreen, "Menu");
     }
 }
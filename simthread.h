@@ -0,0 +1,149 @@
+#include "splashkit.h"
+#include "level.h"
+#include "playerinput.h"
+#include "renderqueue.h"
+#include "residency.h"
+#include "triplebuffer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#pragma once
+
+using namespace std;
+
+// What one simulation tick hands to the main thread
+struct sim_frame
+{
+    render_frame render;
+    hud_values hud;
+    level_status status;
+    level_metrics metrics;
+    int tick = 0;
+};
+
+// Runs a level's simulation on its own thread. The main thread keeps everything SplashKit needs
+// there (events, input, drawing, the HUD bitmap) and draws the newest finished frame while the
+// next one is simulated. One tick is simulated per frame the main thread posts.
+class SimulationThread
+{
+    private:
+        thread worker;
+        shared_ptr<Level> level;
+        TripleBuffer<sim_frame> frames;
+        atomic<bool> running{false};
+        atomic<int> frames_posted{0};
+        // Keys held are replaced every frame, presses and releases build up until a tick takes them
+        atomic<uint32_t> keys_down{0};
+        atomic<uint32_t> keys_typed{0};
+        atomic<uint32_t> keys_released{0};
+        int ticks = 0;
+        level_status status;
+        level_metrics metrics;
+
+        void run()
+        {
+            while (running)
+            {
+                if (ticks >= frames_posted)
+                {
+                    this_thread::sleep_for(chrono::microseconds(200));
+                    continue;
+                }
+
+                current_input().down = keys_down.load();
+                current_input().typed = keys_typed.exchange(0);
+                current_input().released = keys_released.exchange(0);
+
+                level->simulate();
+
+                sim_frame &frame = frames.write_buffer();
+                render_queue().end_frame(frame.render);
+                frame.hud = level->get_hud_values();
+                frame.status = level->get_status();
+                frame.metrics = level->get_metrics();
+                frame.tick = ++ticks;
+                frames.publish();
+            }
+        };
+
+    public:
+        SimulationThread(){};
+
+        ~SimulationThread()
+        {
+            stop();
+        };
+
+        SimulationThread(const SimulationThread &) = delete;
+        SimulationThread &operator=(const SimulationThread &) = delete;
+
+        void start(shared_ptr<Level> level)
+        {
+            if (running)
+                return;
+
+            // Anything still waiting to be decoded is done now, the pack is not shared between threads
+            asset_residency().decode_resident();
+
+            this->level = level;
+            this->ticks = 0;
+            this->frames_posted = 0;
+            this->keys_typed = 0;
+            this->keys_released = 0;
+            this->status = level->get_status();
+            this->running = true;
+            this->worker = thread(&SimulationThread::run, this);
+        };
+
+        // Waits for the tick in progress, after this the level is safe to use from the main thread
+        void stop()
+        {
+            if (!running)
+                return;
+
+            running = false;
+            worker.join();
+            frames.acquire(); // So a frame from before the stop is never taken as new
+            this->status = level->get_status();
+            this->level = nullptr;
+        };
+
+        bool is_running()
+        {
+            return this->running;
+        };
+
+        // Hands this frame's input over and lets the simulation run another tick
+        void post_input(input_frame input)
+        {
+            keys_down = input.down;
+            keys_typed.fetch_or(input.typed);
+            keys_released.fetch_or(input.released);
+            frames_posted += 1;
+        };
+
+        // Draws the newest finished frame, or the one before again if the simulation is behind
+        void present()
+        {
+            if (frames.acquire())
+            {
+                status = frames.read_buffer().status;
+                metrics = frames.read_buffer().metrics;
+            }
+            level->present(frames.read_buffer().render, frames.read_buffer().hud);
+        };
+
+        level_status get_status()
+        {
+            return this->status;
+        };
+
+        // Of the frame last presented
+        level_metrics get_metrics()
+        {
+            return this->metrics;
+        };
+};
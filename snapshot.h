@@ -0,0 +1,153 @@
+#include "splashkit.h"
+#include "block.h"
+#include "player.h"
+#include "enemy.h"
+#include "navigation.h"
+#include "aischeduler.h"
+#include "levelclock.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// How the level is going, all the screens need to know after a tick
+struct level_status
+{
+    int players = 1;
+    bool out_of_lives[MAX_PLAYERS] = {};
+    bool complete[MAX_PLAYERS] = {};
+
+    bool all_complete() const
+    {
+        for (int i = 0; i < players; i++)
+            if (!complete[i])
+                return false;
+        return true;
+    };
+
+    bool anyone_out_of_lives() const
+    {
+        for (int i = 0; i < players; i++)
+            if (out_of_lives[i])
+                return true;
+        return false;
+    };
+};
+
+// Every piece of a level that changes while it is played. Taken once the level is built so a
+// restart copies this back into the objects that are already there instead of loading the level
+// again, and can be taken again at any point as a checkpoint.
+struct level_snapshot
+{
+    bool taken = false;
+    int frame = 0;
+    point_2d camera;
+    level_status progress;
+    block_state door;
+    vector<block_state> blocks; // Every changeable block layer after layer, in the order saved
+    vector<unsigned char> collected;
+    vector<player_snapshot> players;
+    enemy_snapshot enemies;
+    // Only put back when a frame is resumed exactly, a restart starts these over
+    int far_enemy_cursor = 0;
+    level_clock_snapshot clock;
+    navigation_snapshot navigation;
+    ai_schedule_snapshot ai;
+};
+
+// Stops the timers the level runs, they would carry on counting through a restore
+void reset_level_timers()
+{
+    level_clock().stop_all();
+    if (has_timer("DanceTime"))
+    {
+        stop_timer("DanceTime");
+        reset_timer("DanceTime");
+    }
+}
+
+template <typename T>
+void save_block_layers(vector<vector<shared_ptr<T>>> &layers, vector<block_state> &states)
+{
+    for (int j = 0; j < layers.size(); j++)
+        for (int i = 0; i < layers[j].size(); i++)
+            states.push_back(layers[j][i]->save_state());
+}
+
+// Restores the layers from states[next] on, next is left after the last state used
+template <typename T>
+void restore_block_layers(vector<vector<shared_ptr<T>>> &layers, const vector<block_state> &states, int &next)
+{
+    for (int j = 0; j < layers.size(); j++)
+        for (int i = 0; i < layers[j].size() && next < states.size(); i++)
+            layers[j][i]->restore_state(states[next++]);
+}
+
+template <typename T>
+void save_collected(vector<vector<shared_ptr<T>>> &layers, vector<unsigned char> &collected)
+{
+    for (int j = 0; j < layers.size(); j++)
+        for (int i = 0; i < layers[j].size(); i++)
+            collected.push_back(layers[j][i]->get_collected());
+}
+
+template <typename T>
+void restore_collected(vector<vector<shared_ptr<T>>> &layers, const vector<unsigned char> &collected)
+{
+    int next = 0;
+    for (int j = 0; j < layers.size(); j++)
+        for (int i = 0; i < layers[j].size() && next < collected.size(); i++)
+            layers[j][i]->set_collected(collected[next++]);
+}
+
+// A snapshot's block states and collected flags by the object they belong to, so the snapshot
+// can be laid out again after blocks have been added or taken out of the level
+struct snapshot_index
+{
+    unordered_map<const void *, block_state> blocks;
+    unordered_map<const void *, unsigned char> collected;
+};
+
+template <typename T>
+void index_block_layers(vector<vector<shared_ptr<T>>> &layers, const vector<block_state> &states, int &next, snapshot_index &index)
+{
+    for (int j = 0; j < layers.size(); j++)
+        for (int i = 0; i < layers[j].size() && next < states.size(); i++)
+            index.blocks[layers[j][i].get()] = states[next++];
+}
+
+// Blocks the snapshot never saw are saved as they are now
+template <typename T>
+void reindex_block_layers(vector<vector<shared_ptr<T>>> &layers, snapshot_index &index, vector<block_state> &states)
+{
+    for (int j = 0; j < layers.size(); j++)
+        for (int i = 0; i < layers[j].size(); i++)
+        {
+            auto saved = index.blocks.find(layers[j][i].get());
+            states.push_back(saved != index.blocks.end() ? saved->second : layers[j][i]->save_state());
+        }
+}
+
+template <typename T>
+void index_collected(vector<vector<shared_ptr<T>>> &layers, const vector<unsigned char> &collected, snapshot_index &index)
+{
+    int next = 0;
+    for (int j = 0; j < layers.size(); j++)
+        for (int i = 0; i < layers[j].size() && next < collected.size(); i++)
+            index.collected[layers[j][i].get()] = collected[next++];
+}
+
+template <typename T>
+void reindex_collected(vector<vector<shared_ptr<T>>> &layers, snapshot_index &index, vector<unsigned char> &collected)
+{
+    for (int j = 0; j < layers.size(); j++)
+        for (int i = 0; i < layers[j].size(); i++)
+        {
+            auto saved = index.collected.find(layers[j][i].get());
+            collected.push_back(saved != index.collected.end() ? saved->second : layers[j][i]->get_collected());
+        }
+}
@@ -0,0 +1,113 @@
+#include "splashkit.h"
+#include "block.h"
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// Counts from merging a level's solid tiles
+struct solid_merge_stats
+{
+    int tiles = 0;
+    int rectangles = 0;
+    int largest = 0; // Most tiles in one rectangle
+};
+
+// Collision rectangles for the level's solid tiles. Tiles with the same hitbox shape inside their
+// tile are merged greedily: each free tile grows right as far as it can, then the whole run grows
+// down while every tile under it matches. Half blocks only fill their tile across, so they only
+// ever merge sideways.
+vector<rectangle> merge_solid_tiles(vector<vector<shared_ptr<Block>>> &solid_blocks, int tile_size, solid_merge_stats &stats)
+{
+    stats = solid_merge_stats();
+    vector<rectangle> merged;
+
+    // Group the tiles by their hitbox shape
+    typedef tuple<double, double, double, double> tile_shape;
+    map<tile_shape, map<pair<int, int>, bool>> shapes;
+    for (int j = 0; j < solid_blocks.size(); j++)
+        for (int i = 0; i < solid_blocks[j].size(); i++)
+        {
+            rectangle hitbox = solid_blocks[j][i]->get_block_hitbox();
+            int col = (int)floor(hitbox.x / tile_size);
+            int row = (int)floor(hitbox.y / tile_size);
+            tile_shape shape = make_tuple(hitbox.x - col * tile_size, hitbox.y - row * tile_size, hitbox.width, hitbox.height);
+
+            if (shapes[shape].count(make_pair(row, col)) == 0)
+                stats.tiles += 1;
+            shapes[shape][make_pair(row, col)] = false;
+        }
+
+    for (auto &group : shapes)
+    {
+        double offset_x = get<0>(group.first);
+        double offset_y = get<1>(group.first);
+        double width = get<2>(group.first);
+        double height = get<3>(group.first);
+        bool spans_across = offset_x == 0 && width == tile_size;
+        bool spans_down = offset_y == 0 && height == tile_size;
+        map<pair<int, int>, bool> &tiles = group.second;
+
+        // Tiles are visited top to bottom, left to right, the bool marks them as used
+        for (auto &tile : tiles)
+        {
+            if (tile.second)
+                continue;
+
+            int row = tile.first.first;
+            int col = tile.first.second;
+
+            int across = 1;
+            while (spans_across)
+            {
+                auto next = tiles.find(make_pair(row, col + across));
+                if (next == tiles.end() || next->second)
+                    break;
+                across += 1;
+            }
+
+            int down = 1;
+            while (spans_down)
+            {
+                bool full_row = true;
+                for (int k = 0; k < across && full_row; k++)
+                {
+                    auto below = tiles.find(make_pair(row + down, col + k));
+                    full_row = below != tiles.end() && !below->second;
+                }
+                if (!full_row)
+                    break;
+                down += 1;
+            }
+
+            for (int r = 0; r < down; r++)
+                for (int k = 0; k < across; k++)
+                    tiles[make_pair(row + r, col + k)] = true;
+
+            rectangle area;
+            area.x = col * tile_size + offset_x;
+            area.y = row * tile_size + offset_y;
+            area.width = (across - 1) * tile_size + width;
+            area.height = (down - 1) * tile_size + height;
+            merged.push_back(area);
+
+            if (across * down > stats.largest)
+                stats.largest = across * down;
+        }
+    }
+
+    stats.rectangles = merged.size();
+    return merged;
+}
+
+string solid_merge_report(solid_merge_stats stats)
+{
+    string ratio = stats.rectangles == 0 ? "0" : to_string(stats.tiles / stats.rectangles);
+    return to_string(stats.tiles) + " solid tiles merged into " + to_string(stats.rectangles) + " rectangles (" + ratio + "x), largest " + to_string(stats.largest) + " tiles";
+}
@@ -0,0 +1,313 @@
+#include "splashkit.h"
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// Ids one cell sheet covers, the sheet at offset 100 has ids 101 to 200
+#define SPARSE_IDS_PER_SHEET 100
+// First line of a run length layer file
+#define SPARSE_FILE_HEADER "rle"
+
+// A stretch of one tile id along a row
+struct tile_run
+{
+    int row;
+    int col;
+    int length;
+    int id;
+};
+
+// One layer of a level as its runs of tiles that aren't empty, in row then column order, with a
+// bit per tile saying whether it has anything on it. The runs are also listed by the cell sheet
+// their ids belong to, so going through one sheet's tiles only visits those runs and a layer that
+// is mostly empty costs what is on it rather than its size.
+class SparseLayer
+{
+    private:
+        int width = 0;
+        int height = 0;
+        vector<tile_run> runs;
+        vector<uint64_t> occupied;
+        // Places in runs, by (id - 1) / SPARSE_IDS_PER_SHEET
+        vector<vector<int>> runs_by_sheet;
+
+    public:
+        SparseLayer(){};
+
+        SparseLayer(int width, int height)
+        {
+            this->width = width;
+            this->height = height;
+            this->occupied.assign(((size_t)width * height + 63) / 64, 0);
+        };
+
+        ~SparseLayer(){};
+
+        // Runs go in row then column order, one carrying straight on from the last with the same
+        // id joins it. Empty tiles are never added.
+        void add_run(int row, int col, int length, int id)
+        {
+            if (id <= 0 || row < 0 || row >= height || col < 0)
+                return;
+            length = min(length, width - col);
+            if (length <= 0)
+                return;
+
+            for (int k = 0; k < length; k++)
+            {
+                size_t tile = (size_t)row * width + col + k;
+                occupied[tile >> 6] |= 1ull << (tile & 63);
+            }
+
+            if (!runs.empty())
+            {
+                tile_run &last = runs.back();
+                if (last.row == row && last.id == id && last.col + last.length == col)
+                {
+                    last.length += length;
+                    return;
+                }
+            }
+
+            runs.push_back({row, col, length, id});
+            int sheet = (id - 1) / SPARSE_IDS_PER_SHEET;
+            if (sheet >= runs_by_sheet.size())
+                runs_by_sheet.resize(sheet + 1);
+            runs_by_sheet[sheet].push_back(runs.size() - 1);
+        };
+
+        // Drops the room left over from adding runs, once the layer is read
+        void compact()
+        {
+            runs.shrink_to_fit();
+            for (int i = 0; i < runs_by_sheet.size(); i++)
+                runs_by_sheet[i].shrink_to_fit();
+        };
+
+        bool is_occupied(int col, int row)
+        {
+            if (col < 0 || row < 0 || col >= width || row >= height)
+                return false;
+
+            size_t tile = (size_t)row * width + col;
+            return (occupied[tile >> 6] >> (tile & 63)) & 1;
+        };
+
+        // The id on a tile, 0 when it is empty
+        int at(int col, int row)
+        {
+            if (!is_occupied(col, row))
+                return 0;
+
+            // The last run starting at or before the tile
+            auto after = upper_bound(runs.begin(), runs.end(), make_pair(row, col), [](const pair<int, int> &tile, const tile_run &run) {
+                return tile.first < run.row || (tile.first == run.row && tile.second < run.col);
+            });
+            return (after - 1)->id;
+        };
+
+        // Calls visit(col, row, id) for every tile with an id from first_id to last_id, a sheet's
+        // tiles in row then column order
+        template <typename Visit>
+        void for_each_tile(int first_id, int last_id, Visit visit)
+        {
+            int first_sheet = (max(first_id, 1) - 1) / SPARSE_IDS_PER_SHEET;
+            int last_sheet = min((last_id - 1) / SPARSE_IDS_PER_SHEET, (int)runs_by_sheet.size() - 1);
+
+            for (int sheet = first_sheet; sheet <= last_sheet; sheet++)
+                for (int i = 0; i < runs_by_sheet[sheet].size(); i++)
+                {
+                    const tile_run &run = runs[runs_by_sheet[sheet][i]];
+                    if (run.id < first_id || run.id > last_id)
+                        continue;
+
+                    for (int k = 0; k < run.length; k++)
+                        visit(run.col + k, run.row, run.id);
+                }
+        };
+
+        int get_width()
+        {
+            return this->width;
+        };
+
+        int get_height()
+        {
+            return this->height;
+        };
+
+        int run_count()
+        {
+            return this->runs.size();
+        };
+
+        size_t bytes()
+        {
+            size_t indexes = 0;
+            for (int i = 0; i < runs_by_sheet.size(); i++)
+                indexes += runs_by_sheet[i].capacity() * sizeof(int);
+            return runs.capacity() * sizeof(tile_run) + occupied.capacity() * sizeof(uint64_t) + indexes;
+        };
+
+        // "rle width height", then a line per row of "length id" pairs, the empty runs included
+        bool save(const string &file)
+        {
+            ofstream out(file);
+            if (out.fail())
+                return false;
+
+            out << SPARSE_FILE_HEADER << " " << width << " " << height << "\n";
+            int next = 0;
+            for (int row = 0; row < height; row++)
+            {
+                int col = 0;
+                for (; next < runs.size() && runs[next].row == row; next++)
+                {
+                    if (runs[next].col > col)
+                        out << runs[next].col - col << " 0 ";
+                    out << runs[next].length << " " << runs[next].id << " ";
+                    col = runs[next].col + runs[next].length;
+                }
+                if (col < width)
+                    out << width - col << " 0";
+                out << "\n";
+            }
+            return !out.fail();
+        };
+};
+
+// Reads a layer file of whitespace separated ids a row at a time, keeping only the runs
+bool read_sparse_text(const string &file, SparseLayer &layer)
+{
+    ifstream map_level(file);
+    if (map_level.fail())
+        return false;
+
+    vector<tile_run> runs;
+    int width = 0;
+    int height = 0;
+    string line;
+    while (getline(map_level, line))
+    {
+        istringstream row(line);
+        int col = 0;
+        int id;
+        while (row >> id)
+        {
+            if (id != 0)
+            {
+                if (!runs.empty() && runs.back().row == height && runs.back().id == id && runs.back().col + runs.back().length == col)
+                    runs.back().length += 1;
+                else
+                    runs.push_back({height, col, 1, id});
+            }
+            col += 1;
+        }
+
+        if (col == 0)
+            continue;
+        width = max(width, col);
+        height += 1;
+    }
+
+    layer = SparseLayer(width, height);
+    for (int i = 0; i < runs.size(); i++)
+        layer.add_run(runs[i].row, runs[i].col, runs[i].length, runs[i].id);
+    layer.compact();
+    return height > 0;
+}
+
+// Reads a layer saved by SparseLayer::save
+bool read_sparse_runs(const string &file, SparseLayer &layer)
+{
+    ifstream map_level(file);
+    string header;
+    int width, height;
+    if (map_level.fail() || !(map_level >> header >> width >> height) || header != SPARSE_FILE_HEADER)
+        return false;
+
+    layer = SparseLayer(width, height);
+    for (int row = 0; row < height; row++)
+    {
+        int col = 0;
+        int length, id;
+        while (col < width && map_level >> length >> id)
+        {
+            layer.add_run(row, col, length, id);
+            col += length;
+        }
+        if (col < width)
+            return false;
+    }
+    layer.compact();
+    return true;
+}
+
+// levels/4c_2.txt is kept run length encoded as levels/4c_2.rle
+string sparse_file_name(const string &file)
+{
+    size_t dot = file.find_last_of('.');
+    size_t slash = file.find_last_of('/');
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        return file + ".rle";
+    return file.substr(0, dot) + ".rle";
+}
+
+// From the run length copy when there is one no older than the text file, so a layer edited
+// since it was encoded is read from the text. False when neither can be read.
+bool read_sparse_layer(const string &file, SparseLayer &layer)
+{
+    string runs_file = sparse_file_name(file);
+    error_code text_error, runs_error;
+    auto text_time = filesystem::last_write_time(file, text_error);
+    auto runs_time = filesystem::last_write_time(runs_file, runs_error);
+
+    if (!runs_error && (text_error || runs_time >= text_time) && read_sparse_runs(runs_file, layer))
+        return true;
+    return read_sparse_text(file, layer);
+}
+
+// Same, stopping the game as the level loader always has when a layer file is missing
+SparseLayer load_sparse_layer(const string &file)
+{
+    SparseLayer layer;
+    if (!read_sparse_layer(file, layer))
+    {
+        write_line("Error");
+        cerr << "Error Opening File" << endl;
+        exit(1);
+    }
+    return layer;
+}
+
+// Writes the run length copy of every layer file, run again whenever a layer is edited
+int write_sparse_layers(vector<string> files)
+{
+    sort(files.begin(), files.end());
+    files.erase(unique(files.begin(), files.end()), files.end());
+
+    for (int i = 0; i < files.size(); i++)
+    {
+        SparseLayer layer;
+        if (!read_sparse_text(files[i], layer) || !layer.save(sparse_file_name(files[i])))
+        {
+            write_line("Could not encode " + files[i]);
+            return 1;
+        }
+
+        error_code text_error, runs_error;
+        uintmax_t text_bytes = filesystem::file_size(files[i], text_error);
+        uintmax_t runs_bytes = filesystem::file_size(sparse_file_name(files[i]), runs_error);
+        write_line(files[i] + ": " + to_string(layer.get_width()) + "x" + to_string(layer.get_height()) + " tiles in " + to_string(layer.run_count()) + " runs, " + to_string(text_bytes) + " bytes of text to " + to_string(runs_bytes) + " encoded, " + to_string(layer.bytes()) + " bytes in memory");
+    }
+    return 0;
+}
@@ -0,0 +1,303 @@
+#include "splashkit.h"
+#include <unordered_map>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+#pragma once
+
+using namespace std;
+
+// Uniform grid of buckets for things that move around the level.
+// Items are inserted with a rectangle and get back a handle, moving an item only
+// touches the buckets it enters or leaves.
+template <typename T>
+class SpatialHash
+{
+    private:
+        struct spatial_entry
+        {
+            T item;
+            rectangle area;
+            int min_x, min_y, max_x, max_y;
+            int query_stamp = 0;
+            bool active = false;
+        };
+
+        double cell_size;
+        unordered_map<long long, vector<int>> buckets;
+        vector<spatial_entry> entries;
+        int query_counter = 0;
+
+        long long bucket_key(int x, int y) const
+        {
+            return ((long long)x << 32) ^ (unsigned int)y;
+        };
+
+        int to_cell(double value) const
+        {
+            return (int)floor(value / cell_size);
+        };
+
+        void add_to_buckets(int handle)
+        {
+            spatial_entry &entry = entries[handle];
+            for (int y = entry.min_y; y <= entry.max_y; y++)
+                for (int x = entry.min_x; x <= entry.max_x; x++)
+                    buckets[bucket_key(x, y)].push_back(handle);
+        };
+
+        void remove_from_buckets(int handle)
+        {
+            spatial_entry &entry = entries[handle];
+            for (int y = entry.min_y; y <= entry.max_y; y++)
+                for (int x = entry.min_x; x <= entry.max_x; x++)
+                {
+                    auto bucket = buckets.find(bucket_key(x, y));
+                    if (bucket == buckets.end())
+                        continue;
+
+                    vector<int> &handles = bucket->second;
+                    for (int i = 0; i < handles.size(); i++)
+                    {
+                        if (handles[i] == handle)
+                        {
+                            handles[i] = handles.back();
+                            handles.pop_back();
+                            break;
+                        }
+                    }
+                }
+        };
+
+        // Touching counts as overlapping, the block collision tests treat it the same way
+        bool overlaps(const rectangle &one, const rectangle &two) const
+        {
+            return one.x <= two.x + two.width && one.x + one.width >= two.x && one.y <= two.y + two.height && one.y + one.height >= two.y;
+        };
+
+        template <typename Filter>
+        vector<T> collect(rectangle area, Filter filter)
+        {
+            vector<int> found;
+            query_counter += 1;
+
+            int min_x = to_cell(area.x);
+            int min_y = to_cell(area.y);
+            int max_x = to_cell(area.x + area.width);
+            int max_y = to_cell(area.y + area.height);
+
+            for (int y = min_y; y <= max_y; y++)
+                for (int x = min_x; x <= max_x; x++)
+                {
+                    auto bucket = buckets.find(bucket_key(x, y));
+                    if (bucket == buckets.end())
+                        continue;
+
+                    for (int handle : bucket->second)
+                    {
+                        spatial_entry &entry = entries[handle];
+                        if (entry.query_stamp == query_counter)
+                            continue;
+                        entry.query_stamp = query_counter;
+
+                        if (filter(entry.area))
+                            found.push_back(handle);
+                    }
+                }
+
+            // Keep insertion order so callers that stop at the first hit behave like a linear scan
+            sort(found.begin(), found.end());
+
+            vector<T> result;
+            result.reserve(found.size());
+            for (int handle : found)
+                result.push_back(entries[handle].item);
+
+            return result;
+        };
+
+    public:
+        SpatialHash(double cell_size = 128)
+        {
+            this->cell_size = cell_size;
+        };
+
+        ~SpatialHash(){};
+
+        int insert(T item, rectangle area)
+        {
+            spatial_entry entry;
+            entry.item = item;
+            entry.area = area;
+            entry.min_x = to_cell(area.x);
+            entry.min_y = to_cell(area.y);
+            entry.max_x = to_cell(area.x + area.width);
+            entry.max_y = to_cell(area.y + area.height);
+            entry.active = true;
+            entries.push_back(entry);
+
+            int handle = entries.size() - 1;
+            add_to_buckets(handle);
+            return handle;
+        };
+
+        // Moves an item, buckets are only rewritten when the covered cells change
+        void update(int handle, rectangle area)
+        {
+            if (handle < 0 || handle >= entries.size() || !entries[handle].active)
+                return;
+
+            spatial_entry &entry = entries[handle];
+            entry.area = area;
+
+            int min_x = to_cell(area.x);
+            int min_y = to_cell(area.y);
+            int max_x = to_cell(area.x + area.width);
+            int max_y = to_cell(area.y + area.height);
+
+            if (min_x == entry.min_x && min_y == entry.min_y && max_x == entry.max_x && max_y == entry.max_y)
+                return;
+
+            remove_from_buckets(handle);
+            entry.min_x = min_x;
+            entry.min_y = min_y;
+            entry.max_x = max_x;
+            entry.max_y = max_y;
+            add_to_buckets(handle);
+        };
+
+        void remove(int handle)
+        {
+            if (handle < 0 || handle >= entries.size() || !entries[handle].active)
+                return;
+
+            remove_from_buckets(handle);
+            entries[handle].active = false;
+        };
+
+        // Takes out everything reaching inside the area, rectangles only touching its edge stay.
+        // Match picks which of those go, what was taken out is returned in insertion order.
+        template <typename Match>
+        vector<T> remove_inside(rectangle area, Match match)
+        {
+            vector<int> found;
+            query_counter += 1;
+
+            for (int y = to_cell(area.y); y <= to_cell(area.y + area.height); y++)
+                for (int x = to_cell(area.x); x <= to_cell(area.x + area.width); x++)
+                {
+                    auto bucket = buckets.find(bucket_key(x, y));
+                    if (bucket == buckets.end())
+                        continue;
+
+                    for (int handle : bucket->second)
+                    {
+                        spatial_entry &entry = entries[handle];
+                        if (entry.query_stamp == query_counter)
+                            continue;
+                        entry.query_stamp = query_counter;
+
+                        bool inside = entry.area.x < area.x + area.width && entry.area.x + entry.area.width > area.x && entry.area.y < area.y + area.height && entry.area.y + entry.area.height > area.y;
+                        if (inside && match(entry.item))
+                            found.push_back(handle);
+                    }
+                }
+
+            sort(found.begin(), found.end());
+
+            vector<T> removed;
+            for (int handle : found)
+            {
+                removed.push_back(entries[handle].item);
+                remove(handle);
+            }
+            return removed;
+        };
+
+        bool contains(int handle)
+        {
+            return handle >= 0 && handle < entries.size() && entries[handle].active;
+        };
+
+        void clear()
+        {
+            buckets.clear();
+            entries.clear();
+            query_counter = 0;
+        };
+
+        // Everything whose rectangle overlaps the area
+        vector<T> query_rect(rectangle area)
+        {
+            return collect(area, [&](const rectangle &item_area) { return overlaps(item_area, area); });
+        };
+
+        // Same as query_rect but safe to call from several threads at once, as long as nothing is
+        // moved meanwhile. Duplicates are sorted out instead of stamped on the entries.
+        vector<T> query_rect_shared(rectangle area) const
+        {
+            vector<int> found;
+
+            int min_x = to_cell(area.x);
+            int min_y = to_cell(area.y);
+            int max_x = to_cell(area.x + area.width);
+            int max_y = to_cell(area.y + area.height);
+
+            for (int y = min_y; y <= max_y; y++)
+                for (int x = min_x; x <= max_x; x++)
+                {
+                    auto bucket = buckets.find(bucket_key(x, y));
+                    if (bucket == buckets.end())
+                        continue;
+
+                    for (int handle : bucket->second)
+                        if (overlaps(entries[handle].area, area))
+                            found.push_back(handle);
+                }
+
+            sort(found.begin(), found.end());
+            found.erase(unique(found.begin(), found.end()), found.end());
+
+            vector<T> result;
+            result.reserve(found.size());
+            for (int handle : found)
+                result.push_back(entries[handle].item);
+
+            return result;
+        };
+
+        // Everything whose rectangle comes within radius of the center point
+        vector<T> query_radius(point_2d center, double radius)
+        {
+            rectangle area;
+            area.x = center.x - radius;
+            area.y = center.y - radius;
+            area.width = radius * 2;
+            area.height = radius * 2;
+
+            return collect(area, [&](const rectangle &item_area) {
+                double closest_x = max(item_area.x, min(center.x, item_area.x + item_area.width));
+                double closest_y = max(item_area.y, min(center.y, item_area.y + item_area.height));
+                double dx = center.x - closest_x;
+                double dy = center.y - closest_y;
+                return dx * dx + dy * dy <= radius * radius;
+            });
+        };
+
+        int size()
+        {
+            return this->entries.size();
+        };
+};
+
+// The part of the level the camera can currently see, in world coordinates
+rectangle camera_world_rectangle()
+{
+    rectangle area;
+    area.x = camera_x();
+    area.y = camera_y();
+    area.width = screen_width();
+    area.height = screen_height();
+    return area;
+}
@@ -0,0 +1,116 @@
+#include "splashkit.h"
+#include "spatialhash.h"
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// How close two edges have to be to count as touching
+#define SWEEP_EPSILON 0.01
+#define SWEEP_MISS 2
+
+// Where a box ended up after a move and what it ran into on the way
+struct sweep_result
+{
+    rectangle box;
+    bool hit_floor = false;
+    bool hit_ceiling = false;
+    bool hit_left = false;  // Stopped by something on its left while moving left
+    bool hit_right = false; // Stopped by something on its right while moving right
+    bool on_floor = false;  // Standing on something once the move is done
+};
+
+bool sweep_ranges_overlap(double min_a, double max_a, double min_b, double max_b)
+{
+    return min_a < max_b - SWEEP_EPSILON && max_a > min_b + SWEEP_EPSILON;
+}
+
+// Fraction of the move along one axis the box makes before it touches the block, or SWEEP_MISS
+// if the block isn't in the way. Blocks the box already overlaps are ignored so it can get out.
+double sweep_time_of_impact(double box_min, double box_max, double block_min, double block_max, double delta)
+{
+    double gap;
+
+    if (delta > 0 && box_max <= block_min + SWEEP_EPSILON)
+        gap = block_min - box_max;
+    else if (delta < 0 && box_min >= block_max - SWEEP_EPSILON)
+        gap = box_min - block_max;
+    else
+        return SWEEP_MISS;
+
+    double time = max(gap, 0.0) / abs(delta);
+    if (time > 1)
+        return SWEEP_MISS;
+
+    return time;
+}
+
+// Moves a box by (dx, dy) through the level's solid rectangles, one axis at a time. Every block the whole
+// move could touch is fetched once, the box stops at the earliest block in its way on each
+// axis so it can't skip over thin blocks however far it moves in one frame.
+sweep_result sweep_box(rectangle box, double dx, double dy, SpatialHash<rectangle> &solid_grid)
+{
+    sweep_result result;
+
+    rectangle area = box;
+    area.x = min(box.x, box.x + dx);
+    area.y = min(box.y, box.y + dy);
+    area.width = box.width + abs(dx);
+    area.height = box.height + abs(dy) + 1; // and a pixel under the feet for the floor check
+
+    vector<rectangle> solids = solid_grid.query_rect(area);
+
+    // Sideways first, so running along the floor never catches on the seam between two blocks
+    if (dx != 0)
+    {
+        double first = SWEEP_MISS;
+        for (int i = 0; i < solids.size(); i++)
+        {
+            if (!sweep_ranges_overlap(box.y, box.y + box.height, solids[i].y, solids[i].y + solids[i].height))
+                continue;
+
+            double time = sweep_time_of_impact(box.x, box.x + box.width, solids[i].x, solids[i].x + solids[i].width, dx);
+            if (time < first)
+                first = time;
+        }
+
+        bool hit = first != SWEEP_MISS;
+        box.x += hit ? dx * first : dx;
+        result.hit_right = hit && dx > 0;
+        result.hit_left = hit && dx < 0;
+    }
+
+    if (dy != 0)
+    {
+        double first = SWEEP_MISS;
+        for (int i = 0; i < solids.size(); i++)
+        {
+            if (!sweep_ranges_overlap(box.x, box.x + box.width, solids[i].x, solids[i].x + solids[i].width))
+                continue;
+
+            double time = sweep_time_of_impact(box.y, box.y + box.height, solids[i].y, solids[i].y + solids[i].height, dy);
+            if (time < first)
+                first = time;
+        }
+
+        bool hit = first != SWEEP_MISS;
+        box.y += hit ? dy * first : dy;
+        result.hit_floor = hit && dy > 0;
+        result.hit_ceiling = hit && dy < 0;
+    }
+
+    // Resting on a block counts as being on the floor even without falling into it
+    result.on_floor = result.hit_floor;
+    for (int i = 0; i < solids.size() && !result.on_floor; i++)
+    {
+        if (!sweep_ranges_overlap(box.x, box.x + box.width, solids[i].x, solids[i].x + solids[i].width))
+            continue;
+
+        if (abs((box.y + box.height) - solids[i].y) <= SWEEP_EPSILON)
+            result.on_floor = true;
+    }
+
+    result.box = box;
+    return result;
+}
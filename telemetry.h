@@ -0,0 +1,445 @@
+#include "splashkit.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// Events that can wait to be written, more are dropped rather than making the game wait
+#define TELEMETRY_QUEUE_SIZE 4096
+// How often the waiting events are written, all of them in one transaction
+#define TELEMETRY_FLUSH_MS 500
+// Runs whose events are kept, older ones are deleted when the game starts
+#define TELEMETRY_KEEP_RUNS 50
+// High scores kept, the best ones
+#define TELEMETRY_KEEP_SCORES 100
+#define TELEMETRY_DATABASE "telemetry.db"
+
+enum telemetry_kind
+{
+    TELEMETRY_LEVEL_START,
+    TELEMETRY_LEVEL_COMPLETE,
+    TELEMETRY_LEVEL_FAILED,
+    TELEMETRY_DEATH,
+    TELEMETRY_ENEMY_KILL,
+    TELEMETRY_PIPE_PICKUP,
+    TELEMETRY_PIPE_PLACE,
+    TELEMETRY_PIPE_TURN,
+    TELEMETRY_KIND_COUNT
+};
+
+// How each kind is written in the events table
+const char *TELEMETRY_KIND_NAMES[TELEMETRY_KIND_COUNT] = {"level_start", "level_complete", "level_failed", "death", "enemy_kill", "pipe_pickup", "pipe_place", "pipe_turn"};
+
+// One thing that happened. Level events have no player or tile, value is the milliseconds the
+// level took when it ends, the lives left on a death and the players on a level start.
+struct telemetry_event
+{
+    telemetry_kind kind;
+    int level;
+    int player;
+    int tile_x;
+    int tile_y;
+    int value;
+    long ms; // Since the game started
+};
+
+// Bounded queue any number of threads can push to and pop from without locking. Each cell's
+// sequence number says whether it is waiting to be written or to be read, a push or pop claims
+// its cell by moving the shared position on.
+template <typename T, int CAPACITY>
+class EventQueue
+{
+    private:
+        struct cell
+        {
+            atomic<size_t> sequence;
+            T value;
+        };
+
+        cell cells[CAPACITY];
+        atomic<size_t> push_position{0};
+        atomic<size_t> pop_position{0};
+
+    public:
+        EventQueue()
+        {
+            for (int i = 0; i < CAPACITY; i++)
+                cells[i].sequence.store(i, memory_order_relaxed);
+        };
+
+        ~EventQueue(){};
+
+        EventQueue(const EventQueue &) = delete;
+        EventQueue &operator=(const EventQueue &) = delete;
+
+        // False when the queue is full
+        bool push(const T &value)
+        {
+            size_t position = push_position.load(memory_order_relaxed);
+            while (true)
+            {
+                cell &slot = cells[position % CAPACITY];
+                intptr_t difference = (intptr_t)slot.sequence.load(memory_order_acquire) - (intptr_t)position;
+                if (difference == 0)
+                {
+                    if (push_position.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+                    {
+                        slot.value = value;
+                        slot.sequence.store(position + 1, memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                    return false;
+                else
+                    position = push_position.load(memory_order_relaxed);
+            }
+        };
+
+        // False when the queue is empty
+        bool pop(T &value)
+        {
+            size_t position = pop_position.load(memory_order_relaxed);
+            while (true)
+            {
+                cell &slot = cells[position % CAPACITY];
+                intptr_t difference = (intptr_t)slot.sequence.load(memory_order_acquire) - (intptr_t)(position + 1);
+                if (difference == 0)
+                {
+                    if (pop_position.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+                    {
+                        value = slot.value;
+                        slot.sequence.store(position + CAPACITY, memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                    return false;
+                else
+                    position = pop_position.load(memory_order_relaxed);
+            }
+        };
+};
+
+// Statements run with nothing to read back
+void run_telemetry_sql(database db, const string &sql)
+{
+    query_result result = run_sql(db, sql);
+    if (!query_success(result))
+        write_line("Telemetry: " + error_message(result));
+    free_query_result(result);
+}
+
+// The first column of the first row, or fallback when there isn't one
+int telemetry_sql_int(database db, const string &sql, int fallback)
+{
+    query_result result = run_sql(db, sql);
+    int value = fallback;
+    if (query_success(result) && has_row(result) && query_type_of_col(result, 0) == "INTEGER")
+        value = query_column_for_int(result, 0);
+    free_query_result(result);
+    return value;
+}
+
+// Creates the tables the first time, and drops events of runs older than the ones kept
+void prepare_telemetry_database(database db)
+{
+    run_telemetry_sql(db, "CREATE TABLE IF NOT EXISTS runs (id INTEGER PRIMARY KEY AUTOINCREMENT, started TEXT DEFAULT CURRENT_TIMESTAMP);");
+    run_telemetry_sql(db, "CREATE TABLE IF NOT EXISTS events (run INTEGER, kind TEXT, level INTEGER, player INTEGER, tile_x INTEGER, tile_y INTEGER, value INTEGER, ms INTEGER);");
+    run_telemetry_sql(db, "CREATE INDEX IF NOT EXISTS events_by_kind ON events (kind, level);");
+    run_telemetry_sql(db, "CREATE TABLE IF NOT EXISTS high_scores (run INTEGER PRIMARY KEY, score INTEGER, players INTEGER);");
+
+    run_telemetry_sql(db, "DELETE FROM events WHERE run <= (SELECT MAX(id) FROM runs) - " + to_string(TELEMETRY_KEEP_RUNS) + ";");
+    run_telemetry_sql(db, "DELETE FROM runs WHERE id <= (SELECT MAX(id) FROM runs) - " + to_string(TELEMETRY_KEEP_RUNS) + ";");
+    run_telemetry_sql(db, "DELETE FROM high_scores WHERE run NOT IN (SELECT run FROM high_scores ORDER BY score DESC LIMIT " + to_string(TELEMETRY_KEEP_SCORES) + ");");
+}
+
+// Records what happens in the levels played into Resources/databases/telemetry.db and keeps the
+// high score table. Recording only pushes onto a lock free queue, the database is opened,
+// written and closed on a thread of its own, so no frame ever waits for the disk.
+class Telemetry
+{
+    private:
+        EventQueue<telemetry_event, TELEMETRY_QUEUE_SIZE> queue;
+        thread worker;
+        atomic<bool> running{false};
+        chrono::steady_clock::time_point started = chrono::steady_clock::now();
+        int tile_size = 64;
+
+        // Set by the game, read by whichever thread records
+        atomic<int> level{0};
+        atomic<int> players{1};
+        atomic<long> level_started_ms{0};
+        atomic<bool> muted{false};
+        atomic<int> dropped{0};
+        atomic<int> best_score{0};
+        atomic<int> run_score{0};
+
+        // Only the writer thread touches these
+        database db = nullptr;
+        int run = 0;
+        int score_written = 0;
+        long written = 0;
+
+        long now_ms()
+        {
+            return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+        };
+
+        void push(telemetry_event event)
+        {
+            if (muted)
+                return;
+            if (!queue.push(event))
+                dropped += 1;
+        };
+
+        void open()
+        {
+            db = open_database("Telemetry", TELEMETRY_DATABASE);
+            prepare_telemetry_database(db);
+            run_telemetry_sql(db, "INSERT INTO runs DEFAULT VALUES;");
+            run = telemetry_sql_int(db, "SELECT MAX(id) FROM runs;", 0);
+
+            best_score = max(best_score.load(), telemetry_sql_int(db, "SELECT MAX(score) FROM high_scores;", 0));
+        };
+
+        // Everything waiting, and the run's score if it went up, in one transaction
+        void flush()
+        {
+            telemetry_event event;
+            bool writing = false;
+            while (queue.pop(event))
+            {
+                if (!writing)
+                    run_telemetry_sql(db, "BEGIN TRANSACTION;");
+                writing = true;
+
+                run_telemetry_sql(db, "INSERT INTO events VALUES (" + to_string(run) + ", '" + TELEMETRY_KIND_NAMES[event.kind] + "', " + to_string(event.level) + ", " + to_string(event.player) + ", " + to_string(event.tile_x) + ", " + to_string(event.tile_y) + ", " + to_string(event.value) + ", " + to_string(event.ms) + ");");
+                written += 1;
+            }
+
+            int score = run_score;
+            if (score > score_written)
+            {
+                if (!writing)
+                    run_telemetry_sql(db, "BEGIN TRANSACTION;");
+                writing = true;
+
+                run_telemetry_sql(db, "INSERT OR REPLACE INTO high_scores VALUES (" + to_string(run) + ", " + to_string(score) + ", " + to_string(players) + ");");
+                score_written = score;
+            }
+
+            if (writing)
+                run_telemetry_sql(db, "COMMIT;");
+        };
+
+        void write()
+        {
+            open();
+            while (running)
+            {
+                // Short sleeps so stopping doesn't wait out a whole flush period
+                for (int waited = 0; waited < TELEMETRY_FLUSH_MS && running; waited += 50)
+                    this_thread::sleep_for(chrono::milliseconds(50));
+                flush();
+            }
+            flush();
+            free_database(db);
+            db = nullptr;
+        };
+
+    public:
+        Telemetry(){};
+
+        ~Telemetry()
+        {
+            stop();
+        };
+
+        Telemetry(const Telemetry &) = delete;
+        Telemetry &operator=(const Telemetry &) = delete;
+
+        void start(int tile_size)
+        {
+            if (running)
+                return;
+
+            this->tile_size = tile_size;
+            running = true;
+            worker = thread(&Telemetry::write, this);
+        };
+
+        // Writes whatever is still waiting, then closes the database
+        void stop()
+        {
+            if (!running)
+                return;
+
+            running = false;
+            worker.join();
+        };
+
+        // The level and players the next events belong to, 0 for a custom level
+        void set_level(int level, int players)
+        {
+            this->level = level;
+            this->players = players;
+        };
+
+        // Set while frames are simulated again after a rollback, so nothing is counted twice
+        void set_muted(bool muted)
+        {
+            this->muted = muted;
+        };
+
+        // Something a player did somewhere in the level
+        void record(telemetry_kind kind, int player, point_2d position, int value = 0)
+        {
+            telemetry_event event;
+            event.kind = kind;
+            event.level = level;
+            event.player = player;
+            event.tile_x = (int)floor(position.x / tile_size);
+            event.tile_y = (int)floor(position.y / tile_size);
+            event.value = value;
+            event.ms = now_ms();
+            push(event);
+        };
+
+        // A level starting or ending, an ending says how long the level took
+        void record_level(telemetry_kind kind)
+        {
+            long ms = now_ms();
+            if (kind == TELEMETRY_LEVEL_START)
+                level_started_ms = ms;
+
+            telemetry_event event;
+            event.kind = kind;
+            event.level = level;
+            event.player = -1;
+            event.tile_x = 0;
+            event.tile_y = 0;
+            event.value = kind == TELEMETRY_LEVEL_START ? players.load() : (int)(ms - level_started_ms);
+            event.ms = ms;
+            push(event);
+        };
+
+        // Keeps the best score of this run for the high score table
+        void offer_score(int score)
+        {
+            int best = run_score;
+            while (score > best && !run_score.compare_exchange_weak(best, score))
+                ;
+        };
+
+        // Best score of any run, 0 until the database has been read
+        int get_best_score()
+        {
+            return max(best_score.load(), run_score.load());
+        };
+
+        string report()
+        {
+            return "Telemetry: " + to_string(written) + " events written, " + to_string(dropped) + " dropped";
+        };
+};
+
+Telemetry &telemetry()
+{
+    static Telemetry recorder;
+    return recorder;
+}
+
+// Prints where players died on a level over the runs kept, drawn over the level's first layer.
+// Solid tiles are #, a tile with deaths shows how many, + for ten or more.
+int print_death_heatmap(int level, vector<string> files)
+{
+    database db = open_database("TelemetryQuery", TELEMETRY_DATABASE);
+    prepare_telemetry_database(db);
+
+    vector<vector<int>> layout;
+    if (!files.empty())
+    {
+        ifstream map_level(files[0]);
+        string line;
+        while (getline(map_level, line))
+        {
+            istringstream row(line);
+            vector<int> ids;
+            int id;
+            while (row >> id)
+                ids.push_back(id);
+            layout.push_back(ids);
+        }
+    }
+
+    vector<vector<int>> deaths(layout.size());
+    for (int i = 0; i < layout.size(); i++)
+        deaths[i].assign(layout[i].size(), 0);
+
+    query_result result = run_sql(db, "SELECT tile_x, tile_y, COUNT(*) FROM events WHERE kind = 'death' AND level = " + to_string(level) + " GROUP BY tile_x, tile_y;");
+    int total = 0;
+    for (bool more = query_success(result) && has_row(result); more; more = get_next_row(result))
+    {
+        int x = query_column_for_int(result, 0);
+        int y = query_column_for_int(result, 1);
+        int count = query_column_for_int(result, 2);
+        total += count;
+
+        // Falls off the level are drawn on its edge
+        if (!layout.empty())
+        {
+            y = max(0, min(y, (int)layout.size() - 1));
+            x = max(0, min(x, (int)layout[y].size() - 1));
+        }
+        if (y < 0 || x < 0)
+            continue;
+        if (y >= deaths.size())
+            deaths.resize(y + 1);
+        if (x >= deaths[y].size())
+            deaths[y].resize(x + 1, 0);
+        deaths[y][x] += count;
+    }
+    free_query_result(result);
+
+    write_line("Level " + to_string(level) + ": " + to_string(total) + " deaths over the last " + to_string(TELEMETRY_KEEP_RUNS) + " runs");
+    for (int y = 0; y < deaths.size(); y++)
+    {
+        string row;
+        int width = max(deaths[y].size(), y < layout.size() ? layout[y].size() : 0);
+        for (int x = 0; x < width; x++)
+        {
+            int count = x < deaths[y].size() ? deaths[y][x] : 0;
+            int id = y < layout.size() && x < layout[y].size() ? layout[y][x] : 0;
+            if (count >= 10)
+                row += '+';
+            else if (count > 0)
+                row += (char)('0' + count);
+            else if (id > 0 && id < 100)
+                row += '#';
+            else
+                row += ' ';
+        }
+        write_line(row);
+    }
+
+    int finished = telemetry_sql_int(db, "SELECT COUNT(*) FROM events WHERE kind = 'level_complete' AND level = " + to_string(level) + ";", 0);
+    int average_ms = telemetry_sql_int(db, "SELECT CAST(AVG(value) AS INTEGER) FROM events WHERE kind = 'level_complete' AND level = " + to_string(level) + ";", 0);
+    int kills = telemetry_sql_int(db, "SELECT COUNT(*) FROM events WHERE kind = 'enemy_kill' AND level = " + to_string(level) + ";", 0);
+    int pipes = telemetry_sql_int(db, "SELECT COUNT(*) FROM events WHERE kind LIKE 'pipe_%' AND level = " + to_string(level) + ";", 0);
+    write_line(to_string(finished) + " times finished, " + to_string(average_ms / 1000.0) + "s on average, " + to_string(kills) + " enemies killed, " + to_string(pipes) + " pipe interactions");
+
+    free_database(db);
+    return 0;
+}
@@ -1,5 +1,8 @@
 #include "splashkit.h"
 #include "player.h"
+#include "aabbbatch.h"
+#include "assetpack.h"
+#include <chrono>
 #include <memory>
 
 #pragma once
@@ -12,4 +15,225 @@ void draw_hitbox(rectangle hitbox)
 void test_camera_on(shared_ptr<Player> player)
 {
     center_camera_on(player->get_player_sprite(), 0, 0);
-};
\ No newline at end of file
+};
+// Random rectangles roughly the size of tiles scattered over a big level
+RectBatch random_rect_batch(int count, double level_size)
+{
+    RectBatch batch;
+    for (int i = 0; i < count; i++)
+        batch.push(rectangle_from(rnd() * level_size, rnd() * level_size, 16 + rnd() * 112, 16 + rnd() * 112));
+    return batch;
+}
+
+// Worked out straight from the rectangle, nothing shared with the kernels. Top, bottom, left then
+// right, the first of equal penetrations wins.
+overlap_side reference_overlap_side(rectangle box, rectangle area)
+{
+    if (!(box.x < area.x + area.width && box.x + box.width > area.x && box.y < area.y + area.height && box.y + box.height > area.y))
+        return SIDE_NONE;
+
+    double into[] = {box.y + box.height - area.y, area.y + area.height - box.y, box.x + box.width - area.x, area.x + area.width - box.x};
+    overlap_side names[] = {SIDE_TOP, SIDE_BOTTOM, SIDE_LEFT, SIDE_RIGHT};
+    int least = 0;
+    for (int i = 1; i < 4; i++)
+        if (into[i] < into[least])
+            least = i;
+    return names[least];
+}
+
+// Every kernel against the reference for one box, padding lanes must come back empty
+bool check_aabb_kernels(rectangle box, vector<rectangle> &areas, RectBatch &batch, const string &name)
+{
+    vector<uint64_t> mask;
+    vector<unsigned char> sides;
+
+    for (int kernel = AABB_SCALAR; kernel <= aabb_best_kernel(); kernel++)
+    {
+        int hits = aabb_overlap_sides(box, batch, mask, sides, (aabb_kernel)kernel);
+        int expected_hits = 0;
+        bool same = sides.size() == batch.lanes();
+
+        for (int i = 0; i < batch.lanes() && same; i++)
+        {
+            overlap_side expected = i < areas.size() ? reference_overlap_side(box, areas[i]) : SIDE_NONE;
+            expected_hits += expected != SIDE_NONE;
+            same = sides[i] == expected && aabb_mask_test(mask, i) == (expected != SIDE_NONE);
+        }
+
+        if (!same || hits != expected_hits || aabb_overlap(box, batch, mask, (aabb_kernel)kernel) != hits)
+        {
+            write_line("AABB kernel " + to_string(kernel) + " disagrees with the reference: " + name);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Checks every AABB kernel this machine has gives the same overlaps and sides as a plain
+// rectangle test. Whole number edges, as tiles have, so equal penetrations come up often.
+bool test_aabb_kernels(int count)
+{
+    vector<rectangle> areas;
+    RectBatch batch;
+    for (int i = 0; i < count; i++)
+    {
+        areas.push_back(rectangle_from((int)(rnd() * 4096), (int)(rnd() * 4096), 16 + (int)(rnd() * 112), 16 + (int)(rnd() * 112)));
+        batch.push(areas.back());
+    }
+
+    for (int trial = 0; trial < 200; trial++)
+    {
+        rectangle box = rectangle_from((int)(rnd() * 4096), (int)(rnd() * 4096), 16 + (int)(rnd() * 240), 16 + (int)(rnd() * 240));
+        if (!check_aabb_kernels(box, areas, batch, to_string(count) + " random rectangles"))
+            return false;
+    }
+
+    return true;
+}
+
+// Boxes where the answer is known
+bool test_aabb_fixed_cases()
+{
+    vector<rectangle> areas = {rectangle_from(0, 0, 64, 64)};
+    RectBatch batch;
+    batch.push(areas[0]);
+
+    struct fixed_case
+    {
+        string name;
+        rectangle box;
+        overlap_side side;
+    };
+    vector<fixed_case> cases = {
+        {"touching the right edge", rectangle_from(64, 0, 64, 64), SIDE_NONE},
+        {"touching the left edge", rectangle_from(-64, 0, 64, 64), SIDE_NONE},
+        {"touching the bottom edge", rectangle_from(0, 64, 64, 64), SIDE_NONE},
+        {"touching the top edge", rectangle_from(0, -64, 64, 64), SIDE_NONE},
+        {"touching a corner", rectangle_from(64, 64, 16, 16), SIDE_NONE},
+        {"standing on top", rectangle_from(10, -19, 20, 20), SIDE_TOP},
+        {"head in the bottom", rectangle_from(10, 60, 20, 20), SIDE_BOTTOM},
+        {"into the left side", rectangle_from(-18, 20, 20, 20), SIDE_LEFT},
+        {"into the right side", rectangle_from(61, 20, 20, 20), SIDE_RIGHT},
+        {"top and left equally", rectangle_from(-10, -10, 12, 12), SIDE_TOP},
+    };
+
+    for (int i = 0; i < cases.size(); i++)
+    {
+        vector<uint64_t> mask;
+        vector<unsigned char> sides;
+        for (int kernel = AABB_SCALAR; kernel <= aabb_best_kernel(); kernel++)
+        {
+            aabb_overlap_sides(cases[i].box, batch, mask, sides, (aabb_kernel)kernel);
+            if (sides[0] != cases[i].side)
+            {
+                write_line("AABB kernel " + to_string(kernel) + " is wrong " + cases[i].name);
+                return false;
+            }
+        }
+        if (reference_overlap_side(cases[i].box, areas[0]) != cases[i].side || !check_aabb_kernels(cases[i].box, areas, batch, cases[i].name))
+            return false;
+    }
+
+    // A box over everything, the lanes padding each batch out must never overlap
+    for (int count = 1; count <= 2 * AABB_BATCH_LANES + 1; count++)
+    {
+        vector<rectangle> tail;
+        RectBatch padded;
+        for (int i = 0; i < count; i++)
+        {
+            tail.push_back(rectangle_from(i * 32, 0, 32, 32));
+            padded.push(tail.back());
+        }
+        if (!check_aabb_kernels(rectangle_from(-1000, -1000, 4000, 4000), tail, padded, to_string(count) + " rectangles and their padding"))
+            return false;
+    }
+
+    return true;
+}
+
+// Microseconds per query for each kernel against a batch of count rectangles
+void benchmark_aabb_kernels(int count)
+{
+    RectBatch batch = random_rect_batch(count, 4096);
+    vector<uint64_t> mask;
+    rectangle box = rectangle_from(2000, 2000, 48, 59);
+    int repeats = max(10, 10000000 / count);
+    string line = to_string(count) + " rectangles:";
+
+    for (int kernel = AABB_SCALAR; kernel <= aabb_best_kernel(); kernel++)
+    {
+        int hits = 0;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < repeats; i++)
+        {
+            box.x = 2000 + (i & 7);
+            hits += aabb_overlap(box, batch, mask, (aabb_kernel)kernel);
+        }
+        double us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / repeats;
+
+        string names[] = {"scalar", "sse2", "avx2"};
+        line += " " + names[kernel] + " " + to_string(us) + "us";
+        if (hits < 0)
+            line += "!";
+    }
+
+    write_line(line);
+}
+
+// Run with -k: checks the AABB kernels agree, then times them
+int run_aabb_kernel_tests()
+{
+    bool passed = test_aabb_fixed_cases();
+    for (int count = 1; count <= 100000; count *= 10)
+        passed = passed && test_aabb_kernels(count);
+    write_line(passed ? "AABB kernels match the scalar version" : "AABB kernels do NOT match the scalar version");
+
+    for (int count = 1000; count <= 100000; count *= 10)
+        benchmark_aabb_kernels(count);
+
+    return passed ? 0 : 1;
+}
+
+// Times loading every bundle against opening the asset pack and decoding from it. The first pass
+// is the first load in this process, drop the OS file cache beforehand for a true cold boot.
+int benchmark_startup(vector<string> bundle_names, vector<string> bundle_files)
+{
+    string passes[] = {"cold", "warm"};
+    for (int pass = 0; pass < 2; pass++)
+    {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < bundle_names.size(); i++)
+            load_resource_bundle(bundle_names[i], bundle_files[i]);
+        double bundle_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        for (int i = 0; i < bundle_names.size(); i++)
+            free_resource_bundle(bundle_names[i]);
+
+        start = chrono::steady_clock::now();
+        if (!open_asset_pack())
+        {
+            write_line("No asset pack to time, build it with -p");
+            return 1;
+        }
+        double open_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        // What the menu needs before it can show, then the rest
+        start = chrono::steady_clock::now();
+        AssetPack &pack = asset_pack();
+        for (int i = 0; i < pack.get_entries(); i++)
+            if (pack.get_text(pack.get_entry(pack.get_entry(i).bundle).name) == "menu")
+                pack.require(i);
+        double menu_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        for (int i = 0; i < pack.get_entries(); i++)
+            pack.require(i);
+        double all_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        pack.free_decoded();
+        pack.close();
+
+        write_line(passes[pass] + ": bundles " + to_string(bundle_ms) + "ms, pack open " + to_string(open_ms) + "ms, menu ready " + to_string(open_ms + menu_ms) + "ms, everything decoded " + to_string(open_ms + all_ms) + "ms");
+    }
+
+    return 0;
+}
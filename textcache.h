@@ -0,0 +1,164 @@
+#include "splashkit.h"
+#include "assetpack.h"
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#pragma once
+
+using namespace std;
+
+// Most pre-rendered strings kept at once, the least recently drawn go first
+#define TEXT_CACHE_ENTRIES 64
+// Measurements are tiny, the table is just emptied when it gets this big
+#define TEXT_LAYOUT_LIMIT 1024
+
+struct text_layout
+{
+    int width = 0;
+    int height = 0;
+};
+
+// Measured and pre-rendered text for the screens. Each distinct string, font, size and colour is
+// rasterised into a bitmap once and blitted from then on.
+class TextCache
+{
+    private:
+        struct cached_text
+        {
+            bitmap image;
+            text_layout layout;
+            list<string>::iterator recent;
+        };
+
+        unordered_map<string, cached_text> entries;
+        list<string> recent; // Most recently drawn at the front
+        unordered_map<string, text_layout> layouts;
+        int hits = 0;
+        int misses = 0;
+        int evictions = 0;
+        int created = 0;
+
+        // By the font's name, as asset residency can free a font and decode it again at another
+        // address, one a different font may since have been given
+        static string layout_key(const string &text, const string &font_name, int size)
+        {
+            return font_name + "|" + to_string(size) + "|" + text;
+        };
+
+        void evict_oldest()
+        {
+            auto oldest = entries.find(recent.back());
+            free_bitmap(oldest->second.image);
+            entries.erase(oldest);
+            recent.pop_back();
+            evictions += 1;
+        };
+
+    public:
+        TextCache(){};
+
+        // Cleared at the end of main, SplashKit may be gone by the time statics are destroyed
+        ~TextCache(){};
+
+        TextCache(const TextCache &) = delete;
+        TextCache &operator=(const TextCache &) = delete;
+
+        text_layout measure(const string &text, const string &font_name, int size)
+        {
+            string key = layout_key(text, font_name, size);
+            auto found = layouts.find(key);
+            if (found != layouts.end())
+                return found->second;
+
+            if (layouts.size() >= TEXT_LAYOUT_LIMIT)
+                layouts.clear();
+
+            font fnt = asset_font(font_name);
+            text_layout layout;
+            layout.width = text_width(text, fnt, size);
+            layout.height = text_height(text, fnt, size);
+            layouts[key] = layout;
+            return layout;
+        };
+
+        // The text rendered into its own bitmap, made the first time it is asked for
+        bitmap render(const string &text, color clr, const string &font_name, int size)
+        {
+            string key = layout_key(text, font_name, size) + "|" + color_to_string(clr);
+            auto found = entries.find(key);
+            if (found != entries.end())
+            {
+                recent.splice(recent.begin(), recent, found->second.recent);
+                hits += 1;
+                return found->second.image;
+            }
+
+            misses += 1;
+            text_layout layout = measure(text, font_name, size);
+            if (layout.width <= 0 || layout.height <= 0)
+                return nullptr;
+
+            if (entries.size() >= TEXT_CACHE_ENTRIES)
+                evict_oldest();
+
+            cached_text entry;
+            entry.layout = layout;
+            entry.image = create_bitmap("Text" + to_string(created++), layout.width, layout.height);
+            clear_bitmap(entry.image, COLOR_TRANSPARENT);
+            draw_text_on_bitmap(entry.image, text, clr, asset_font(font_name), size, 0, 0);
+
+            recent.push_front(key);
+            entry.recent = recent.begin();
+            entries[key] = entry;
+            return entry.image;
+        };
+
+        void draw(const string &text, color clr, const string &font_name, int size, double x, double y, drawing_options opts)
+        {
+            bitmap image = render(text, clr, font_name, size);
+            if (image != nullptr)
+                draw_bitmap(image, x, y, opts);
+        };
+
+        void clear()
+        {
+            for (auto &entry : entries)
+                free_bitmap(entry.second.image);
+            entries.clear();
+            recent.clear();
+            layouts.clear();
+        };
+
+        string report()
+        {
+            return to_string(entries.size()) + " cached strings, " + to_string(hits) + " hits, " + to_string(misses) + " misses, " + to_string(evictions) + " evictions";
+        };
+};
+
+TextCache &text_cache()
+{
+    static TextCache cache;
+    return cache;
+}
+
+int cached_text_width(const string &text, const string &font_name, int size)
+{
+    return text_cache().measure(text, font_name, size).width;
+}
+
+int cached_text_height(const string &text, const string &font_name, int size)
+{
+    return text_cache().measure(text, font_name, size).height;
+}
+
+// Same as draw_text, drawn from the text cache
+void draw_cached_text(const string &text, color clr, const string &font_name, int size, double x, double y, drawing_options opts)
+{
+    text_cache().draw(text, clr, font_name, size, x, y, opts);
+}
+
+void draw_cached_text(const string &text, color clr, const string &font_name, int size, double x, double y)
+{
+    text_cache().draw(text, clr, font_name, size, x, y, option_defaults());
+}
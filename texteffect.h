@@ -1,4 +1,5 @@
 #include "splashkit.h"
+#include "textcache.h"
 #include <stdio.h> 
 #include <stdlib.h>
 #include <vector>
@@ -14,11 +15,11 @@ class TextEffect
         int x_position;
         double x_min;
         double x_max;
-        font text_font;
+        string text_font;
         int font_size;
 
     public:
-        TextEffect(vector<string> text, int x_position, int y_position, font text_font, int font_size)
+        TextEffect(vector<string> text, int x_position, int y_position, string text_font, int font_size)
         {
             this->text = text;
             this->x_position = x_position;
@@ -36,8 +37,8 @@ class TextEffect
             srand(time(NULL));
             for(int i = 0; i < text.size(); i++)
             {
-                if(max < text_width(text[i], text_font, font_size))
-                    max = text_width(text[i], text_font, font_size)/4;
+                if(max < cached_text_width(text[i], text_font, font_size))
+                    max = cached_text_width(text[i], text_font, font_size)/4;
                     
                 int random_pos = (rand() % 200 + 1) - 100;
                 random_pos = x_position + random_pos;
@@ -73,7 +74,7 @@ class TextEffect
                         forward[i] = true;
                 }
 
-                draw_text(text[i], COLOR_WHITE, text_font, font_size, positions[i], y_position + (i * text_height(text[i], text_font, font_size)));
+                draw_cached_text(text[i], COLOR_WHITE, text_font, font_size, positions[i], y_position + (i * cached_text_height(text[i], text_font, font_size)));
             }
         };
 };
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "splashkit.h"
+#include "block.h"
+#include "camera.h"
+#include "renderqueue.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+// World pixels along each side of a chunk
+#define TILE_CHUNK_SIZE 512
+
+// The level's tiles that never change drawn once into chunk sized bitmaps, so a frame draws a few
+// chunks per layer instead of every tile on screen. Each split screen view samples the same chunks.
+class TileChunkCache
+{
+    private:
+        struct tile_chunk
+        {
+            int col;
+            int row;
+            rectangle area;
+            bitmap image = nullptr;
+            bool redrawing = false;
+        };
+
+        vector<vector<tile_chunk>> layers;
+        int tiles = 0;
+        // Set between start_redraw and finish_redraw, when only the chunks being redrawn are drawn into
+        bool redrawing = false;
+
+        static string chunk_name()
+        {
+            static int created = 0;
+            return "TileChunk" + to_string(created++);
+        };
+
+        // The chunk covering the point on the layer, made the first time a tile lands in it
+        tile_chunk &chunk_at(int layer, double x, double y)
+        {
+            int col = (int)floor(x / TILE_CHUNK_SIZE);
+            int row = (int)floor(y / TILE_CHUNK_SIZE);
+
+            for (int i = 0; i < layers[layer].size(); i++)
+                if (layers[layer][i].col == col && layers[layer][i].row == row)
+                    return layers[layer][i];
+
+            tile_chunk chunk;
+            chunk.col = col;
+            chunk.row = row;
+            chunk.area.x = col * TILE_CHUNK_SIZE;
+            chunk.area.y = row * TILE_CHUNK_SIZE;
+            chunk.area.width = TILE_CHUNK_SIZE;
+            chunk.area.height = TILE_CHUNK_SIZE;
+            chunk.image = create_bitmap(chunk_name(), TILE_CHUNK_SIZE, TILE_CHUNK_SIZE);
+            chunk.redrawing = redrawing;
+            clear_bitmap(chunk.image, COLOR_TRANSPARENT);
+            layers[layer].push_back(chunk);
+            return layers[layer].back();
+        };
+
+    public:
+        TileChunkCache(){};
+
+        ~TileChunkCache()
+        {
+            clear();
+        };
+
+        TileChunkCache(const TileChunkCache &) = delete;
+        TileChunkCache &operator=(const TileChunkCache &) = delete;
+
+        // Draws the blocks into the layer's chunks, a tile on a chunk edge goes into each it covers.
+        // Needs the main thread, the chunks are bitmaps.
+        template <typename T>
+        void add(int layer, vector<shared_ptr<T>> &blocks)
+        {
+            if (layer >= layers.size())
+                layers.resize(layer + 1);
+
+            for (int i = 0; i < blocks.size(); i++)
+            {
+                block_state state = blocks[i]->save_state();
+                point_2d position = blocks[i]->get_pos();
+                drawing_options opts = state.opts;
+                opts.camera = DRAW_TO_SCREEN;
+
+                double corners_x[2] = {position.x, position.x + bitmap_cell_width(state.image) - 1};
+                double corners_y[2] = {position.y, position.y + bitmap_cell_height(state.image) - 1};
+                vector<bitmap> drawn;
+                for (int cy = 0; cy < 2; cy++)
+                    for (int cx = 0; cx < 2; cx++)
+                    {
+                        tile_chunk &chunk = chunk_at(layer, corners_x[cx], corners_y[cy]);
+                        if (redrawing && !chunk.redrawing)
+                            continue;
+                        if (find(drawn.begin(), drawn.end(), chunk.image) != drawn.end())
+                            continue;
+
+                        drawn.push_back(chunk.image);
+                        draw_bitmap_on_bitmap(chunk.image, state.image, position.x - chunk.area.x, position.y - chunk.area.y, opts);
+                    }
+
+                if (!redrawing)
+                    tiles += 1;
+            }
+        };
+
+        // Blanks the layer's chunks the area reaches into. Until finish_redraw, add only draws into
+        // those, so adding every block of the layer again draws them back the way they now are.
+        void start_redraw(int layer, rectangle area)
+        {
+            if (layer >= layers.size())
+                return;
+
+            redrawing = true;
+            for (int i = 0; i < layers[layer].size(); i++)
+            {
+                tile_chunk &chunk = layers[layer][i];
+                if (chunk.redrawing || !rectangles_intersect(chunk.area, area))
+                    continue;
+
+                chunk.redrawing = true;
+                clear_bitmap(chunk.image, COLOR_TRANSPARENT);
+            }
+        };
+
+        void finish_redraw()
+        {
+            redrawing = false;
+            for (int j = 0; j < layers.size(); j++)
+                for (int i = 0; i < layers[j].size(); i++)
+                    layers[j][i].redrawing = false;
+        };
+
+        // Records the layer's chunks that any view can see
+        void submit(int layer)
+        {
+            if (layer >= layers.size())
+                return;
+
+            for (int i = 0; i < layers[layer].size(); i++)
+                if (rect_in_view(layers[layer][i].area))
+                    submit_bitmap(layers[layer][i].image, layers[layer][i].area.x, layers[layer][i].area.y, option_defaults());
+        };
+
+        bool empty()
+        {
+            return this->layers.empty();
+        };
+
+        void clear()
+        {
+            for (int j = 0; j < layers.size(); j++)
+                for (int i = 0; i < layers[j].size(); i++)
+                    free_bitmap(layers[j][i].image);
+            layers.clear();
+            tiles = 0;
+        };
+
+        string report()
+        {
+            int chunks = 0;
+            for (int j = 0; j < layers.size(); j++)
+                chunks += layers[j].size();
+            return to_string(tiles) + " static tiles in " + to_string(chunks) + " chunks";
+        };
+};
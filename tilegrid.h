@@ -0,0 +1,105 @@
+#include "splashkit.h"
+#include <vector>
+#include <cmath>
+
+#pragma once
+
+using namespace std;
+
+// Tile flags, a tile can be more than one
+#define TILE_EMPTY 0
+#define TILE_SOLID 1
+#define TILE_EDGE 2
+#define TILE_LADDER 4
+
+// Coarse per-tile view of the level used by anything that needs to know what is
+// in a tile without testing blocks one by one.
+class TileGrid
+{
+    private:
+        int map_width = 0;
+        int map_height = 0;
+        int tile_size = 64;
+        vector<unsigned char> flags;
+
+    public:
+        TileGrid(){};
+
+        TileGrid(int map_width, int map_height, int tile_size)
+        {
+            this->map_width = map_width;
+            this->map_height = map_height;
+            this->tile_size = tile_size;
+            this->flags.assign(map_width * map_height, TILE_EMPTY);
+        };
+
+        ~TileGrid(){};
+
+        // Flags every tile the area covers
+        void mark(rectangle area, unsigned char flag)
+        {
+            int min_col = column_of(area.x);
+            int max_col = column_of(area.x + area.width - 1);
+            int min_row = row_of(area.y);
+            int max_row = row_of(area.y + area.height - 1);
+
+            for (int row = min_row; row <= max_row; row++)
+                for (int col = min_col; col <= max_col; col++)
+                    if (in_bounds(col, row))
+                        flags[row * map_width + col] |= flag;
+        };
+
+        // Back to empty, for a tile whose blocks are about to be marked again
+        void clear(int col, int row)
+        {
+            if (in_bounds(col, row))
+                flags[row * map_width + col] = TILE_EMPTY;
+        };
+
+        bool in_bounds(int col, int row)
+        {
+            return col >= 0 && row >= 0 && col < map_width && row < map_height;
+        };
+
+        // Outside the map counts as solid so nothing walks off the level
+        bool has(int col, int row, unsigned char flag)
+        {
+            if (!in_bounds(col, row))
+                return (flag & TILE_SOLID) != 0;
+
+            return (flags[row * map_width + col] & flag) != 0;
+        };
+
+        unsigned char get(int col, int row)
+        {
+            if (!in_bounds(col, row))
+                return TILE_SOLID;
+
+            return flags[row * map_width + col];
+        };
+
+        int column_of(double x)
+        {
+            return (int)floor(x / tile_size);
+        };
+
+        int row_of(double y)
+        {
+            return (int)floor(y / tile_size);
+        };
+
+        int get_tile_size()
+        {
+            return this->tile_size;
+        };
+
+        int get_map_width()
+        {
+            return this->map_width;
+        };
+
+        int get_map_height()
+        {
+            return this->map_height;
+        };
+};
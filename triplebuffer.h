@@ -0,0 +1,51 @@
+#include <atomic>
+
+#pragma once
+
+using namespace std;
+
+// Lock free hand over of whole values between one writer and one reader. The writer fills the
+// back buffer and publishes it, the reader takes the newest published one. Neither ever waits
+// and the writer never touches the buffer being read.
+template <typename T>
+class TripleBuffer
+{
+    private:
+        static const int FRESH = 4; // Set on the ready index when it hasn't been read yet
+        static const int INDEX = 3;
+
+        T buffers[3];
+        atomic<int> ready{2};
+        int back = 0;
+        int front = 1;
+
+    public:
+        TripleBuffer(){};
+
+        ~TripleBuffer(){};
+
+        T &write_buffer()
+        {
+            return buffers[back];
+        };
+
+        void publish()
+        {
+            back = ready.exchange(back | FRESH) & INDEX;
+        };
+
+        // Swaps in the newest published buffer, false if nothing new has been published
+        bool acquire()
+        {
+            if ((ready.load() & FRESH) == 0)
+                return false;
+
+            front = ready.exchange(front) & INDEX;
+            return true;
+        };
+
+        T &read_buffer()
+        {
+            return buffers[front];
+        };
+};